@@ -0,0 +1,111 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+// Measures the host-side cost of dispatching messages to an OpenCL actor by
+// counting heap allocations and the time per message. The kernel writes to a
+// mem_ref, i.e., the actor replies without waiting for the device and the
+// numbers are dominated by the argument processing of the actor facade. The
+// counters of `manager::metrics()` show how many `clSetKernelArg` calls the
+// facade issued and skipped, because uniform arguments such as `priv` and
+// `local` keep their value between messages.
+
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include <nil/actor/all.hpp>
+#include <nil/actor/cuda/all.hpp>
+
+using namespace std;
+using namespace nil::actor;
+using namespace nil::actor::opencl;
+
+namespace {
+
+    std::atomic<size_t> allocations {0};
+
+    using ivec = std::vector<int>;
+
+    constexpr size_t problem_size = 1024;
+    constexpr size_t num_messages = 10000;
+    constexpr size_t group_size = 64;
+
+    constexpr const char *kernel_source = R"__(
+  kernel void add_one(global const int* input, global int* output) {
+    size_t idx = get_global_id(0);
+    output[idx] = input[idx] + 1;
+  }
+
+  kernel void add_value(global const int* input, global int* output,
+                        local int* scratch, int value) {
+    size_t idx = get_global_id(0);
+    scratch[get_local_id(0)] = input[idx];
+    output[idx] = scratch[get_local_id(0)] + value;
+  }
+)__";
+
+}    // namespace
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto ptr = std::malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc {};
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+template<class Out, class... Ts>
+void run(spawner &sys, const char *title, const char *kernel_name, Out out_arg, Ts... xs) {
+    auto &mngr = sys.opencl_manager();
+    auto worker = mngr.spawn(kernel_source, kernel_name, nd_range {dim_vec {problem_size}, {}, dim_vec {group_size}},
+                             in<int, mref> {}, std::move(out_arg), std::move(xs)...);
+    scoped_actor self {sys};
+    auto input = mngr.find_device(0).value()->global_argument(ivec(problem_size, 1));
+    // warm up caches and lazily initialized state
+    self->send(worker, input);
+    self->receive([](mem_ref<int> &) {});
+    auto before = allocations.load();
+    auto counters_before = mngr.metrics().devices.front();
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < num_messages; ++i) {
+        self->send(worker, input);
+        self->receive([](mem_ref<int> &) {});
+    }
+    auto stop = chrono::steady_clock::now();
+    auto total = allocations.load() - before;
+    auto counters_after = mngr.metrics().devices.front();
+    auto ns = chrono::duration_cast<chrono::nanoseconds>(stop - start).count();
+    auto arg_sets = counters_after.arg_sets - counters_before.arg_sets;
+    auto arg_sets_skipped = counters_after.arg_sets_skipped - counters_before.arg_sets_skipped;
+    cout << setw(24) << left << title << fixed << setprecision(2)
+         << static_cast<double>(total) / num_messages << " allocations/msg, "
+         << static_cast<double>(ns) / num_messages / 1000.0 << " us/msg, "
+         << static_cast<double>(arg_sets) / num_messages << " clSetKernelArg/msg, "
+         << static_cast<double>(arg_sets_skipped) / num_messages << " skipped/msg" << endl;
+    anon_send_exit(worker, exit_reason::user_shutdown);
+}
+
+int main() {
+    spawner_config cfg;
+    cfg.load<opencl::manager>();
+    spawner system {cfg};
+    auto size_of = [](const mem_ref<int> &x) { return x.size(); };
+    run(system, "type-erased size:", "add_one", out<int, mref> {size_of});
+    run(system, "concrete size:", "add_one", make_out<int, mref>(size_of));
+    run(system, "priv and local:", "add_value", make_out<int, mref>(size_of), local<int> {group_size},
+        priv<int, hidden> {1});
+    return 0;
+}
@@ -156,11 +156,6 @@ kernel void phase_3(global uint* restrict data,
 
 }    // namespace
 
-template<class T, class E = nil::actor::detail::enable_if_t<is_integral<T>::value>>
-T round_up(T numToRound, T multiple) {
-    return ((numToRound + multiple - 1) / multiple) * multiple;
-}
-
 int main() {
     spawner_config cfg;
     cfg.load<opencl::manager>().add_message_type<uvec>("uint_vector");
@@ -198,13 +193,13 @@ int main() {
         scoped_actor self {system};
         // ---- config parameters ----
         auto half_block = dev->max_work_group_size() / 2;
-        auto get_size = [half_block](size_t n) -> size_t { return round_up((n + 1) / 2, half_block); };
-        auto nd_conf = [half_block, get_size](size_t dim) {
-            return nd_range {dim_vec {get_size(dim)}, {}, dim_vec {half_block}};
+        // each work item handles two values, the kernels check against the length
+        auto nd_conf = [half_block](size_t dim) {
+            return nd_range::padded(dim_vec {(dim + 1) / 2}, dim_vec {half_block});
         };
         auto reduced_ref = [&](const uref &, uval n) {
             // calculate number of groups from the group size from the values size
-            return size_t {get_size(n) / half_block};
+            return size_t {nd_conf(n).dimensions()[0] / half_block};
         };
         // default nd-range
         auto ndr = nd_range {dim_vec {half_block}, {}, dim_vec {half_block}};
@@ -9,6 +9,8 @@
 
 #pragma once
 
+#include <array>
+#include <mutex>
 #include <ostream>
 #include <iostream>
 #include <algorithm>
@@ -20,6 +22,7 @@
 #include <nil/actor/raise_error.hpp>
 
 #include <nil/actor/detail/raw_ptr.hpp>
+#include <nil/actor/detail/static_vector.hpp>
 #include <nil/actor/detail/command_helper.hpp>
 
 #include <nil/actor/cuda/global.hpp>
@@ -29,6 +32,7 @@
 #include <nil/actor/cuda/nd_range.hpp>
 #include <nil/actor/cuda/arguments.hpp>
 #include <nil/actor/cuda/opencl_error.hpp>
+#include <nil/actor/cuda/binding_cache.hpp>
 
 namespace nil {
     namespace actor {
@@ -58,9 +62,13 @@ namespace nil {
 
                 typename detail::il_indices<arg_types>::type indices;
 
-                using evnt_vec = std::vector<cl_event>;
-                using mem_vec = std::vector<detail::raw_mem_ptr>;
-                using len_vec = std::vector<size_t>;
+                // each argument contributes at most one element to these containers, hence
+                // the bookkeeping for a message does not allocate
+                static constexpr size_t num_args = detail::tl_size<processing_list>::value;
+
+                using evnt_vec = detail::static_vector<cl_event, num_args>;
+                using mem_vec = detail::static_vector<detail::raw_mem_ptr, num_args>;
+                using len_vec = detail::static_vector<size_t, num_args>;
                 using out_tup = typename detail::tuple_type_of<output_types>::type;
 
                 const char *name() const override {
@@ -79,22 +87,34 @@ namespace nil {
                     check_vec(range.offsets());
                     check_vec(range.local_dimensions());
                     auto &sys = actor_conf.host->system();
-                    auto itr = prog->available_kernels_.find(kernel_name);
-                    if (itr == prog->available_kernels_.end()) {
-                        detail::raw_kernel_ptr kernel;
-                        kernel.reset(v2get(ACTOR_CLF(clCreateKernel), prog->program_.get(), kernel_name), false);
-                        return make_actor<actor_facade, actor>(
-                            sys.next_actor_id(), sys.node(), &sys, std::move(actor_conf), prog, kernel, range,
-                            std::move(map_args), std::move(map_result), std::forward_as_tuple(xs...));
+                    // poor work-group sizes otherwise only show up as enqueue failures, a
+                    // split range launches its remainders with smaller work-groups
+                    auto launches = range.launches();
+                    auto info = prog->info(kernel_name);
+                    if (info && !launches.empty()) {
+                        check_occupancy(kernel_name, *info, *prog->device_, launches.front());
                     }
+                    // each facade owns its kernel object, because arguments stay bound
+                    // between launches and the facade skips setting unchanged ones
+                    detail::raw_kernel_ptr kernel;
+                    kernel.reset(v2get(ACTOR_CLF(clCreateKernel), prog->program_.get(), kernel_name), false);
                     return make_actor<actor_facade, actor>(sys.next_actor_id(), sys.node(), &sys, std::move(actor_conf),
-                                                           prog, itr->second, range, std::move(map_args),
+                                                           prog, kernel, kernel_name, range, std::move(map_args),
                                                            std::move(map_result), std::forward_as_tuple(xs...));
                 }
 
                 void enqueue(strong_actor_ptr sender, message_id mid, message content, response_promise promise) {
                     ACTOR_PUSH_AID(id());
                     ACTOR_LOG_TRACE("");
+                    auto trace = device_->trace();
+                    auto received = trace != nullptr ? trace->now() : 0;
+                    ++*messages_;
+                    // senders enqueue concurrently, but neither the range written by the
+                    // mapping nor the arguments of the kernel may change until the command
+                    // copied the range and clEnqueueNDRangeKernel captured the arguments;
+                    // recursive because an implementation may run the completion
+                    // callback, and hence the next stage, right away
+                    std::lock_guard<std::recursive_mutex> guard {launch_mtx_};
                     if (!map_arguments(content)) {
                         return;
                     }
@@ -120,7 +140,7 @@ namespace nil {
                     auto cmd = make_counted<command_type>(
                         std::move(promise), actor_cast<strong_actor_ptr>(this), std::move(events),
                         std::move(input_buffers), std::move(output_buffers), std::move(scratch_buffers),
-                        std::move(result_lengths), std::move(content), std::move(result), range_);
+                        std::move(result_lengths), std::move(content), std::move(result), range_, received);
                     cmd->enqueue();
                 }
 
@@ -137,14 +157,42 @@ namespace nil {
                 }
 
                 actor_facade(actor_config actor_conf, const program_ptr prog, detail::raw_kernel_ptr kernel,
-                             nd_range range, input_mapping map_args, output_mapping map_result, std::tuple<Ts...> xs) :
+                             const char *kernel_name, nd_range range, input_mapping map_args, output_mapping map_result,
+                             std::tuple<Ts...> xs) :
                     local_actor(actor_conf),
-                    kernel_(std::move(kernel)), program_(prog->program_), context_(prog->context_),
-                    queue_(prog->queue_), range_(std::move(range)), map_args_(std::move(map_args)),
-                    map_results_(std::move(map_result)), kernel_signature_(std::move(xs)) {
+                    kernel_(std::move(kernel)), kernel_name_(kernel_name), program_(prog->program_),
+                    device_(prog->device_), messages_(prog->device_->counters().add_kernel(id(), kernel_name)),
+                    bindings_(num_args, prog->device_->counters()),
+                    context_(prog->context_), queue_(prog->queue_), executor_(prog->executor_),
+                    range_(std::move(range)), map_args_(std::move(map_args)), map_results_(std::move(map_result)),
+                    kernel_signature_(std::move(xs)) {
                     ACTOR_LOG_TRACE(ACTOR_ARG(this->id()));
-                    default_length_ = std::accumulate(std::begin(range_.dimensions()), std::end(range_.dimensions()),
-                                                      size_t {1}, std::multiplies<size_t> {});
+                    auto &real_dims = range_.real_dimensions();
+                    default_length_ = std::accumulate(std::begin(real_dims), std::end(real_dims), size_t {1},
+                                                      std::multiplies<size_t> {});
+                    init_samplers(indices);
+                }
+
+                void init_samplers(detail::int_list<>) {
+                    // nop
+                }
+
+                template<long I, long... Is>
+                void init_samplers(detail::int_list<I, Is...>) {
+                    init_sampler<I>(std::get<I>(kernel_signature_));
+                    init_samplers(detail::int_list<Is...> {});
+                }
+
+                template<long I, class T>
+                void init_sampler(const T &) {
+                    // nop
+                }
+
+                template<long I>
+                void init_sampler(const sampler &x) {
+                    samplers_[I].reset(v2get(ACTOR_CLF(clCreateSampler), context_.get(), x.normalized_coords_,
+                                             x.addressing_, x.filter_),
+                                       false);
                 }
 
                 void add_kernel_arguments(evnt_vec &, mem_vec &, mem_vec &, mem_vec &, out_tup &, len_vec &, message &,
@@ -165,7 +213,7 @@ namespace nil {
                                          detail::int_list<Is...> {});
                 }
 
-                // Two functions to handle `in` arguments: val and mref
+                // Three functions to handle `in` arguments: val, mref and cached
 
                 template<long I, int InPos, int OutPos, class T>
                 void create_buffer(const in<T, val> &, evnt_vec &events, len_vec &, mem_vec &inputs, mem_vec &,
@@ -175,13 +223,12 @@ namespace nil {
                     auto &container = msg.get_as<container_type>(InPos);
                     auto len = container.size();
                     size_t num_bytes = sizeof(value_type) * len;
-                    auto buffer = v2get(ACTOR_CLF(clCreateBuffer), context_.get(), size_t {CL_MEM_READ_WRITE},
-                                        num_bytes, nullptr);
+                    auto buffer = device_->memory().create_buffer(size_t {CL_MEM_READ_WRITE}, num_bytes);
                     auto event = v1get<cl_event>(ACTOR_CLF(clEnqueueWriteBuffer), queue_.get(), buffer,
                                                  0u,    // --> CL_FALSE,
                                                  0u, num_bytes, container.data());
-                    v1callcl(ACTOR_CLF(clSetKernelArg), kernel_.get(), static_cast<unsigned>(I), sizeof(cl_mem),
-                             static_cast<const void *>(&buffer));
+                    device_->counters().bytes_uploaded += num_bytes;
+                    bindings_.set_mem(kernel_.get(), I, buffer);
                     events.push_back(event);
                     inputs.emplace_back(buffer, false);
                 }
@@ -192,14 +239,30 @@ namespace nil {
                     using value_type = typename detail::tl_at<unpacked_types, I>::type;
                     using container_type = mem_ref<value_type>;
                     auto container = msg.get_as<container_type>(InPos);
-                    v1callcl(ACTOR_CLF(clSetKernelArg), kernel_.get(), static_cast<unsigned>(I), sizeof(cl_mem),
-                             static_cast<const void *>(&container.get()));
+                    bindings_.set_mem(kernel_.get(), I, container.get());
                     auto event = container.take_event();
                     if (event) {
                         events.push_back(event);
                     }
                 }
 
+                template<long I, int InPos, int OutPos, class T>
+                void create_buffer(const in<T, cached> &, evnt_vec &events, len_vec &, mem_vec &inputs, mem_vec &,
+                                   mem_vec &, out_tup &, message &msg) {
+                    using value_type = typename detail::tl_at<unpacked_types, I>::type;
+                    using container_type = std::vector<value_type>;
+                    auto &container = msg.get_as<container_type>(InPos);
+                    size_t num_bytes = sizeof(value_type) * container.size();
+                    auto entry = device_->input_cache().lookup_or_upload(device_->memory(), queue_, container.data(),
+                                                                         num_bytes);
+                    auto buffer = entry.memory.get();
+                    bindings_.set_mem(kernel_.get(), I, buffer);
+                    if (entry.event) {
+                        events.push_back(entry.event.detach());
+                    }
+                    inputs.push_back(std::move(entry.memory));
+                }
+
                 // Four functions to handle `in_out` arguments:
                 //    val->val, val->mref, mref->val, mref->mref
 
@@ -211,13 +274,12 @@ namespace nil {
                     auto &container = msg.get_as<container_type>(InPos);
                     auto len = container.size();
                     size_t num_bytes = sizeof(value_type) * len;
-                    auto buffer = v2get(ACTOR_CLF(clCreateBuffer), context_.get(), size_t {CL_MEM_READ_WRITE},
-                                        num_bytes, nullptr);
+                    auto buffer = device_->memory().create_buffer(size_t {CL_MEM_READ_WRITE}, num_bytes);
                     auto event = v1get<cl_event>(ACTOR_CLF(clEnqueueWriteBuffer), queue_.get(), buffer,
                                                  0u,    // --> CL_FALSE,
                                                  0u, num_bytes, container.data());
-                    v1callcl(ACTOR_CLF(clSetKernelArg), kernel_.get(), static_cast<unsigned>(I), sizeof(cl_mem),
-                             static_cast<const void *>(&buffer));
+                    device_->counters().bytes_uploaded += num_bytes;
+                    bindings_.set_mem(kernel_.get(), I, buffer);
                     lengths.push_back(len);
                     events.push_back(event);
                     outputs.emplace_back(buffer, false);
@@ -231,13 +293,12 @@ namespace nil {
                     auto &container = msg.get_as<container_type>(InPos);
                     auto len = container.size();
                     size_t num_bytes = sizeof(value_type) * len;
-                    auto buffer = v2get(ACTOR_CLF(clCreateBuffer), context_.get(), size_t {CL_MEM_READ_WRITE},
-                                        num_bytes, nullptr);
+                    auto buffer = device_->memory().create_buffer(size_t {CL_MEM_READ_WRITE}, num_bytes);
                     auto event = v1get<cl_event>(ACTOR_CLF(clEnqueueWriteBuffer), queue_.get(), buffer,
                                                  0u,    // --> CL_FALSE,
                                                  0u, num_bytes, container.data());
-                    v1callcl(ACTOR_CLF(clSetKernelArg), kernel_.get(), static_cast<unsigned>(I), sizeof(cl_mem),
-                             static_cast<const void *>(&buffer));
+                    device_->counters().bytes_uploaded += num_bytes;
+                    bindings_.set_mem(kernel_.get(), I, buffer);
                     events.push_back(event);
                     std::get<OutPos>(result) =
                         mem_ref<value_type> {len, queue_, detail::raw_mem_ptr {buffer, false},
@@ -250,8 +311,7 @@ namespace nil {
                     using value_type = typename detail::tl_at<unpacked_types, I>::type;
                     using container_type = mem_ref<value_type>;
                     auto container = msg.get_as<container_type>(InPos);
-                    v1callcl(ACTOR_CLF(clSetKernelArg), kernel_.get(), static_cast<unsigned>(I), sizeof(cl_mem),
-                             static_cast<const void *>(&container.get()));
+                    bindings_.set_mem(kernel_.get(), I, container.get());
                     auto event = container.take_event();
                     if (event) {
                         events.push_back(event);
@@ -266,8 +326,7 @@ namespace nil {
                     using value_type = typename detail::tl_at<unpacked_types, I>::type;
                     using container_type = mem_ref<value_type>;
                     auto container = msg.get_as<container_type>(InPos);
-                    v1callcl(ACTOR_CLF(clSetKernelArg), kernel_.get(), static_cast<unsigned>(I), sizeof(cl_mem),
-                             static_cast<const void *>(&container.get()));
+                    bindings_.set_mem(kernel_.get(), I, container.get());
                     auto event = container.take_event();
                     if (event) {
                         events.push_back(event);
@@ -277,79 +336,204 @@ namespace nil {
 
                 // Two functions to handle `out` arguments: val and mref
 
-                template<long I, int InPos, int OutPos, class T>
-                void create_buffer(const out<T, val> &wrapper, evnt_vec &, len_vec &lengths, mem_vec &,
+                template<long I, int InPos, int OutPos, class T, class F>
+                void create_buffer(const out<T, val, F> &wrapper, evnt_vec &, len_vec &lengths, mem_vec &,
                                    mem_vec &outputs, mem_vec &, out_tup &, message &msg) {
                     using value_type = typename detail::tl_at<unpacked_types, I>::type;
                     auto len = argument_length(wrapper, msg, default_length_);
                     auto num_bytes = sizeof(value_type) * len;
-                    auto buffer = v2get(ACTOR_CLF(clCreateBuffer), context_.get(),
-                                        size_t {CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY}, num_bytes, nullptr);
-                    v1callcl(ACTOR_CLF(clSetKernelArg), kernel_.get(), static_cast<unsigned>(I), sizeof(cl_mem),
-                             static_cast<const void *>(&buffer));
+                    auto buffer =
+                        device_->memory().create_buffer(size_t {CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY}, num_bytes);
+                    bindings_.set_mem(kernel_.get(), I, buffer);
                     outputs.emplace_back(buffer, false);
                     lengths.push_back(len);
                 }
 
-                template<long I, int InPos, int OutPos, class T>
-                void create_buffer(const out<T, mref> &wrapper, evnt_vec &, len_vec &, mem_vec &, mem_vec &, mem_vec &,
-                                   out_tup &result, message &msg) {
+                template<long I, int InPos, int OutPos, class T, class F>
+                void create_buffer(const out<T, mref, F> &wrapper, evnt_vec &, len_vec &, mem_vec &, mem_vec &,
+                                   mem_vec &, out_tup &result, message &msg) {
                     using value_type = typename detail::tl_at<unpacked_types, I>::type;
                     auto len = argument_length(wrapper, msg, default_length_);
                     auto num_bytes = sizeof(value_type) * len;
-                    auto buffer = v2get(ACTOR_CLF(clCreateBuffer), context_.get(),
-                                        size_t {CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY}, num_bytes, nullptr);
-                    v1callcl(ACTOR_CLF(clSetKernelArg), kernel_.get(), static_cast<unsigned>(I), sizeof(cl_mem),
-                             static_cast<const void *>(&buffer));
+                    auto buffer =
+                        device_->memory().create_buffer(size_t {CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY}, num_bytes);
+                    bindings_.set_mem(kernel_.get(), I, buffer);
                     std::get<OutPos>(result) = mem_ref<value_type> {
                         len, queue_, {buffer, false}, size_t {CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY}, nullptr};
                 }
 
                 // One function to handle `scratch` buffers
 
-                template<long I, int InPos, int OutPos, class T>
-                void create_buffer(const scratch<T> &wrapper, evnt_vec &, len_vec &, mem_vec &, mem_vec &,
+                template<long I, int InPos, int OutPos, class T, class F>
+                void create_buffer(const scratch<T, F> &wrapper, evnt_vec &, len_vec &, mem_vec &, mem_vec &,
                                    mem_vec &scratch, out_tup &, message &msg) {
                     using value_type = typename detail::tl_at<unpacked_types, I>::type;
                     auto len = argument_length(wrapper, msg, default_length_);
                     auto num_bytes = sizeof(value_type) * len;
-                    auto buffer = v2get(ACTOR_CLF(clCreateBuffer), context_.get(),
-                                        size_t {CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS}, num_bytes, nullptr);
-                    v1callcl(ACTOR_CLF(clSetKernelArg), kernel_.get(), static_cast<unsigned>(I), sizeof(cl_mem),
-                             static_cast<const void *>(&buffer));
+                    auto buffer =
+                        device_->memory().create_buffer(size_t {CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS}, num_bytes);
+                    bindings_.set_mem(kernel_.get(), I, buffer);
                     scratch.emplace_back(buffer, false);
                 }
 
                 // One functions to handle `local` arguments
 
-                template<long I, int InPos, int OutPos, class T>
-                void create_buffer(const local<T> &wrapper, evnt_vec &, len_vec &, mem_vec &, mem_vec &, mem_vec &,
+                template<long I, int InPos, int OutPos, class T, class F>
+                void create_buffer(const local<T, F> &wrapper, evnt_vec &, len_vec &, mem_vec &, mem_vec &, mem_vec &,
                                    out_tup &, message &msg) {
                     using value_type = typename detail::tl_at<unpacked_types, I>::type;
                     auto len = wrapper(msg);
                     auto num_bytes = sizeof(value_type) * len;
-                    v1callcl(ACTOR_CLF(clSetKernelArg), kernel_.get(), static_cast<unsigned>(I), num_bytes, nullptr);
+                    bindings_.set(kernel_.get(), I, num_bytes, nullptr);
                 }
 
                 // Two functions to handle `priv` arguments: val and hidden
 
-                template<long I, int InPos, int OutPos, class T>
-                void create_buffer(const priv<T, val> &, evnt_vec &, len_vec &, mem_vec &, mem_vec &, mem_vec &,
+                template<long I, int InPos, int OutPos, class T, class F>
+                void create_buffer(const priv<T, val, F> &, evnt_vec &, len_vec &, mem_vec &, mem_vec &, mem_vec &,
                                    out_tup &, message &msg) {
                     using value_type = typename detail::tl_at<unpacked_types, I>::type;
                     auto value_size = sizeof(value_type);
                     auto &value = msg.get_as<value_type>(InPos);
-                    v1callcl(ACTOR_CLF(clSetKernelArg), kernel_.get(), static_cast<unsigned>(I), value_size,
-                             static_cast<const void *>(&value));
+                    bindings_.set(kernel_.get(), I, value_size, &value);
                 }
 
-                template<long I, int InPos, int OutPos, class T>
-                void create_buffer(const priv<T, hidden> &wrapper, evnt_vec &, len_vec &, mem_vec &, mem_vec &,
+                template<long I, int InPos, int OutPos, class T, class F>
+                void create_buffer(const priv<T, hidden, F> &wrapper, evnt_vec &, len_vec &, mem_vec &, mem_vec &,
                                    mem_vec &, out_tup &, message &msg) {
                     auto value_size = sizeof(T);
                     auto value = wrapper(msg);
-                    v1callcl(ACTOR_CLF(clSetKernelArg), kernel_.get(), static_cast<unsigned>(I), value_size,
-                             static_cast<const void *>(&value));
+                    bindings_.set(kernel_.get(), I, value_size, &value);
+                }
+
+                template<long I, int InPos, int OutPos, class T, size_t Dim>
+                void create_buffer(const real_size<T, Dim> &, evnt_vec &, len_vec &, mem_vec &, mem_vec &, mem_vec &,
+                                   out_tup &, message &) {
+                    auto &dims = range_.real_dimensions();
+                    auto value = static_cast<T>(Dim < dims.size() ? dims[Dim] : 1);
+                    bindings_.set(kernel_.get(), I, sizeof(T), &value);
+                }
+
+                // Two functions to handle rectangular transfers
+
+                template<long I, int InPos, int OutPos, class T>
+                void create_buffer(const in_rect<T> &wrapper, evnt_vec &events, len_vec &, mem_vec &inputs, mem_vec &,
+                                   mem_vec &, out_tup &, message &msg) {
+                    using value_type = typename detail::tl_at<unpacked_types, I>::type;
+                    using container_type = std::vector<value_type>;
+                    auto &container = msg.get_as<container_type>(InPos);
+                    auto &rect = wrapper.rect_;
+                    if (rect.extent() > container.size()) {
+                        ACTOR_RAISE_ERROR("rect exceeds the input vector");
+                    }
+                    auto packed = rect.packed();
+                    size_t num_bytes = sizeof(value_type) * rect.num_elements();
+                    auto buffer = device_->memory().create_buffer(size_t {CL_MEM_READ_WRITE}, num_bytes);
+                    auto event = v1get<cl_event>(
+                        ACTOR_CLF(clEnqueueWriteBufferRect), queue_.get(), buffer, cl_bool {CL_FALSE},
+                        packed.origin_bytes<value_type>().data(), rect.origin_bytes<value_type>().data(),
+                        rect.region_bytes<value_type>().data(), packed.row_size() * sizeof(value_type),
+                        packed.slice_size() * sizeof(value_type), rect.row_size() * sizeof(value_type),
+                        rect.slice_size() * sizeof(value_type), container.data());
+                    device_->counters().bytes_uploaded += num_bytes;
+                    bindings_.set_mem(kernel_.get(), I, buffer);
+                    events.push_back(event);
+                    inputs.emplace_back(buffer, false);
+                }
+
+                template<long I, int InPos, int OutPos, class T>
+                void create_buffer(const out_rect<T> &wrapper, evnt_vec &, len_vec &lengths, mem_vec &,
+                                   mem_vec &outputs, mem_vec &, out_tup &, message &) {
+                    using value_type = typename detail::tl_at<unpacked_types, I>::type;
+                    // the kernel writes the whole matrix, the command only reads the box
+                    auto num_bytes = sizeof(value_type) * wrapper.rect_.extent();
+                    auto buffer =
+                        device_->memory().create_buffer(size_t {CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY}, num_bytes);
+                    bindings_.set_mem(kernel_.get(), I, buffer);
+                    outputs.emplace_back(buffer, false);
+                    lengths.push_back(wrapper.rect_.num_elements());
+                }
+
+                // Two functions to handle structs in planar layout
+
+                template<long I, int InPos, int OutPos, class T>
+                void create_buffer(const in_soa<T> &wrapper, evnt_vec &, len_vec &, mem_vec &inputs, mem_vec &,
+                                   mem_vec &, out_tup &, message &msg) {
+                    using value_type = typename detail::tl_at<unpacked_types, I>::type;
+                    using container_type = std::vector<value_type>;
+                    auto &container = msg.get_as<container_type>(InPos);
+                    auto len = container.size();
+                    auto num_bytes = wrapper.layout_.num_bytes(len);
+                    // the buffer copies the staged planes when it is created, hence the
+                    // sender neither waits for the queue nor keeps the staging alive
+                    std::vector<char> planes(num_bytes);
+                    wrapper.layout_.scatter(container.data(), len, planes.data());
+                    auto buffer = device_->memory().create_buffer(size_t {CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR},
+                                                                  num_bytes, planes.data());
+                    device_->counters().bytes_uploaded += num_bytes;
+                    bindings_.set_mem(kernel_.get(), I, buffer);
+                    inputs.emplace_back(buffer, false);
+                }
+
+                template<long I, int InPos, int OutPos, class T, class F>
+                void create_buffer(const out_soa<T, F> &wrapper, evnt_vec &, len_vec &lengths, mem_vec &,
+                                   mem_vec &outputs, mem_vec &, out_tup &, message &msg) {
+                    auto len = argument_length(wrapper, msg, default_length_);
+                    auto num_bytes = wrapper.layout_.num_bytes(len);
+                    auto buffer =
+                        device_->memory().create_buffer(size_t {CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY}, num_bytes);
+                    bindings_.set_mem(kernel_.get(), I, buffer);
+                    outputs.emplace_back(buffer, false);
+                    lengths.push_back(len);
+                }
+
+                // Four functions to handle images and samplers
+
+                template<long I, int InPos, int OutPos, class T, size_t Dims>
+                void create_buffer(const in_image<T, Dims, val> &wrapper, evnt_vec &events, len_vec &,
+                                   mem_vec &inputs, mem_vec &, mem_vec &, out_tup &, message &msg) {
+                    using value_type = typename detail::tl_at<unpacked_types, I>::type;
+                    using container_type = std::vector<value_type>;
+                    auto &container = msg.get_as<container_type>(InPos);
+                    auto image = device_->image_argument<value_type, Dims>(
+                        container, wrapper.extent_, wrapper.format_,
+                        cl_mem_flags {CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY});
+                    bindings_.set_mem(kernel_.get(), I, image.get());
+                    auto event = image.take_event();
+                    if (event) {
+                        events.push_back(event);
+                    }
+                    inputs.push_back(image.get());
+                }
+
+                template<long I, int InPos, int OutPos, class T, size_t Dims>
+                void create_buffer(const in_image<T, Dims, mref> &, evnt_vec &events, len_vec &, mem_vec &, mem_vec &,
+                                   mem_vec &, out_tup &, message &msg) {
+                    using value_type = typename detail::tl_at<unpacked_types, I>::type;
+                    using container_type = image_ref<value_type, Dims>;
+                    auto container = msg.get_as<container_type>(InPos);
+                    bindings_.set_mem(kernel_.get(), I, container.get());
+                    auto event = container.take_event();
+                    if (event) {
+                        events.push_back(event);
+                    }
+                }
+
+                template<long I, int InPos, int OutPos, class T, size_t Dims>
+                void create_buffer(const out_image<T, Dims> &wrapper, evnt_vec &, len_vec &, mem_vec &, mem_vec &,
+                                   mem_vec &, out_tup &result, message &) {
+                    using value_type = typename detail::tl_at<unpacked_types, I>::type;
+                    auto image = device_->scratch_image<value_type, Dims>(
+                        wrapper.extent_, wrapper.format_, cl_mem_flags {CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY});
+                    bindings_.set_mem(kernel_.get(), I, image.get());
+                    std::get<OutPos>(result) = std::move(image);
+                }
+
+                template<long I, int InPos, int OutPos>
+                void create_buffer(const sampler &, evnt_vec &, len_vec &, mem_vec &, mem_vec &, mem_vec &, out_tup &,
+                                   message &) {
+                    auto handle = samplers_[I].get();
+                    bindings_.set(kernel_.get(), I, sizeof(cl_sampler), &handle);
                 }
 
                 /// Helper function to calculate the elements in a buffer from in and out
@@ -393,13 +577,20 @@ namespace nil {
                 }
 
                 detail::raw_kernel_ptr kernel_;
+                std::string kernel_name_;
                 detail::raw_program_ptr program_;
+                device_ptr device_;
+                std::shared_ptr<device_counters::kernel_counter> messages_;
+                binding_cache bindings_;
+                std::recursive_mutex launch_mtx_;
                 detail::raw_context_ptr context_;
                 detail::raw_command_queue_ptr queue_;
+                completion_executor *executor_;
                 nd_range range_;
                 input_mapping map_args_;
                 output_mapping map_results_;
                 std::tuple<Ts...> kernel_signature_;
+                std::array<detail::raw_sampler_ptr, num_args> samplers_;
                 size_t default_length_;
             };
         }    // namespace cuda
@@ -10,3 +10,5 @@
 #pragma once
 
 #include <nil/actor/cuda/manager.hpp>
+#include <nil/actor/cuda/remote_ref.hpp>
+#include <nil/actor/cuda/stream_stage.hpp>
@@ -14,8 +14,16 @@
 
 #include <nil/actor/message.hpp>
 #include <nil/actor/optional.hpp>
+#include <nil/actor/raise_error.hpp>
 
+#include <nil/actor/detail/int_list.hpp>
+#include <nil/actor/detail/type_list.hpp>
+#include <nil/actor/detail/type_traits.hpp>
+
+#include <nil/actor/cuda/soa.hpp>
 #include <nil/actor/cuda/mem_ref.hpp>
+#include <nil/actor/cuda/image_ref.hpp>
+#include <nil/actor/cuda/buffer_rect.hpp>
 
 namespace nil {
     namespace actor {
@@ -36,15 +44,60 @@ namespace nil {
 
             template<class F, class T>
             T try_apply_fun(F &fun, message &msg, const T &fallback) {
-                if (fun) {
-                    auto res = fun(msg);
-                    if (res) {
-                        return *res;
-                    }
+                auto res = fun(msg);
+                if (res) {
+                    return *res;
                 }
                 return fallback;
             }
 
+            template<class T, class F, class... Us, long... Is>
+            optional<T> apply_arg_fun(const F &fun, message &msg, type_list<Us...>, int_list<Is...>) {
+                if (!msg.match_elements<Us...>()) {
+                    return none;
+                }
+                return static_cast<T>(fun(msg.get_as<Us>(Is)...));
+            }
+
+            /// Computes the size or value of an argument from the content of a message.
+            /// Stores the function by its concrete type `F`, which is called directly
+            /// on the elements of the message and can be inlined.
+            template<class T, class F>
+            struct arg_fun {
+                using arg_types = typename tl_map<typename get_callable_trait<F>::arg_types, std::decay>::type;
+
+                arg_fun(F fun) : fun_(std::move(fun)) {
+                    // nop
+                }
+
+                optional<T> operator()(message &msg) const {
+                    return apply_arg_fun<T>(fun_, msg, arg_types {}, typename il_indices<arg_types>::type {});
+                }
+
+                F fun_;
+            };
+
+            /// Type-erased variant for wrappers that do not specify the type of their
+            /// function. Returns `none` if no function was set.
+            template<class T>
+            struct arg_fun<T, void> {
+                arg_fun() = default;
+
+                template<class F>
+                arg_fun(F fun) : fun_ {res_or_none<T>(std::move(fun))} {
+                    // nop
+                }
+
+                optional<T> operator()(message &msg) const {
+                    if (fun_) {
+                        return fun_(msg);
+                    }
+                    return none;
+                }
+
+                std::function<optional<T>(message &)> fun_;
+            };
+
         }    // namespace detail
 
         namespace cuda {
@@ -62,6 +115,12 @@ namespace nil {
             /// passed in the argument wrapper. Only available for local and priv arguments.
             struct hidden {};
 
+            /// Arguments tagged as `cached` are expected as a vector, but are kept in a
+            /// read-only buffer on the device after the first transfer. Later messages
+            /// carrying identical data reuse this buffer without copying it again.
+            /// Only available for input arguments that are not modified by the kernel.
+            struct cached {};
+
             /// Use as a default way to calculate output size. 0 will be set to the number
             /// of work items at runtime.
             struct dummy_size_calculator {
@@ -92,8 +151,9 @@ namespace nil {
             /// Mark a spawn argument as input only
             template<class Arg, class Tag = val>
             struct in : arg_tag, input_tag {
-                static_assert(std::is_same<Tag, val>::value || std::is_same<Tag, mref>::value,
-                              "Argument of type `in` must be passed as value or mem_ref.");
+                static_assert(std::is_same<Tag, val>::value || std::is_same<Tag, mref>::value ||
+                                  std::is_same<Tag, cached>::value,
+                              "Argument of type `in` must be passed as value, mem_ref or cached value.");
                 using tag_type = Tag;
                 using arg_type = detail::decay_t<Arg>;
             };
@@ -110,8 +170,9 @@ namespace nil {
                 using arg_type = detail::decay_t<Arg>;
             };
 
-            /// Mark a spawn argument as output only
-            template<class Arg, class Tag = val>
+            /// Mark a spawn argument as output only. The size of the buffer is
+            /// calculated by a function of type `Fun`, which is type-erased if `void`.
+            template<class Arg, class Tag = val, class Fun = void>
             struct out : arg_tag, output_tag, requires_size_tag {
                 static_assert(std::is_same<Tag, val>::value || std::is_same<Tag, mref>::value,
                               "Argument of type `out` must be returned as value or mem_ref.");
@@ -120,8 +181,9 @@ namespace nil {
 
                 out() = default;
 
-                template<class F>
-                out(F fun) : fun_ {detail::res_or_none<size_t>(fun)} {
+                template<class F,
+                         class = typename std::enable_if<!std::is_base_of<arg_tag, detail::decay_t<F>>::value>::type>
+                out(F fun) : fun_ {std::move(fun)} {
                     // nop
                 }
 
@@ -129,18 +191,19 @@ namespace nil {
                     return detail::try_apply_fun(fun_, msg, 0UL);
                 }
 
-                std::function<optional<size_t>(message &)> fun_;
+                detail::arg_fun<size_t, Fun> fun_;
             };
 
             /// Mark a spawn argument as on-device scratch space
-            template<class Arg>
+            template<class Arg, class Fun = void>
             struct scratch : arg_tag, requires_size_tag {
                 using arg_type = detail::decay_t<Arg>;
 
                 scratch() = default;
 
-                template<class F>
-                scratch(F fun) : fun_ {detail::res_or_none<size_t>(fun)} {
+                template<class F,
+                         class = typename std::enable_if<!std::is_base_of<arg_tag, detail::decay_t<F>>::value>::type>
+                scratch(F fun) : fun_ {std::move(fun)} {
                     // nop
                 }
 
@@ -148,14 +211,14 @@ namespace nil {
                     return detail::try_apply_fun(fun_, msg, 0UL);
                 }
 
-                std::function<optional<size_t>(message &)> fun_;
+                detail::arg_fun<size_t, Fun> fun_;
             };
 
             /// Mark a spawn argument as a local memory argument. This argument cannot be
             /// initalized from the CPU, but requires specification of its size. An
             /// optional function allows calculation of the size depeding on the input
             /// message.
-            template<class Arg>
+            template<class Arg, class Fun = void>
             struct local : arg_tag, requires_size_tag {
                 using arg_type = detail::decay_t<Arg>;
 
@@ -165,7 +228,7 @@ namespace nil {
                 }
 
                 template<class F>
-                local(size_t size, F fun) : size_(size), fun_ {detail::res_or_none<size_t>(fun)} {
+                local(size_t size, F fun) : size_(size), fun_ {std::move(fun)} {
                     // nop
                 }
 
@@ -174,13 +237,13 @@ namespace nil {
                 }
 
                 size_t size_;
-                std::function<optional<size_t>(message &)> fun_;
+                detail::arg_fun<size_t, Fun> fun_;
             };
 
             /// Mark a spawn argument as a private argument. Requires a default value but
             /// can optionally be calculated depending on the input through a passed
             /// function.
-            template<class Arg, class Tag = hidden>
+            template<class Arg, class Tag = hidden, class Fun = void>
             struct priv : arg_tag, std::conditional<std::is_same<Tag, val>::value, input_tag, empty_tag>::type {
                 static_assert(std::is_same<Tag, val>::value || std::is_same<Tag, hidden>::value,
                               "Argument of type `priv` must be either a value or hidden.");
@@ -196,7 +259,7 @@ namespace nil {
                 }
 
                 template<class F>
-                priv(Arg val, F fun) : value_(val), fun_ {detail::res_or_none<Arg>(fun)} {
+                priv(Arg val, F fun) : value_(val), fun_ {std::move(fun)} {
                     static_assert(std::is_same<Tag, hidden>::value,
                                   "Argument of type `priv` can only be initialized with a value"
                                   " if it is tagged as hidden.");
@@ -207,9 +270,185 @@ namespace nil {
                 }
 
                 Arg value_;
-                std::function<optional<Arg>(message &)> fun_;
+                detail::arg_fun<Arg, Fun> fun_;
+            };
+
+            /// Mark a spawn argument as a private argument holding global dimension
+            /// `Dim` before padding, see `nd_range::padded`. The value is taken from
+            /// the range of each launch, which lets kernels skip the padding.
+            template<class Arg = cl_uint, size_t Dim = 0>
+            struct real_size : arg_tag, empty_tag {
+                using tag_type = hidden;
+                using arg_type = detail::decay_t<Arg>;
             };
 
+            /// Mark a spawn argument as an input image with `Dims` dimensions. Images
+            /// tagged as `mref` are expected as image_ref. Images tagged as `val` are
+            /// expected as a vector with one element per pixel and are uploaded into
+            /// an image with the extent and format passed to the wrapper.
+            /// @throws std::runtime_error if `extent` is empty, has more than `Dims`
+            ///                            dimensions or a dimension of size 0.
+            template<class Arg, size_t Dims = 2, class Tag = val>
+            struct in_image : arg_tag, input_tag {
+                static_assert(Dims >= 1 && Dims <= 3, "Images have one to three dimensions.");
+                static_assert(std::is_same<Tag, val>::value || std::is_same<Tag, mref>::value,
+                              "Argument of type `in_image` must be passed as value or image_ref.");
+                using tag_type = Tag;
+                using arg_type = detail::decay_t<Arg>;
+
+                in_image() : format_(make_image_format()) {
+                    static_assert(std::is_same<Tag, mref>::value,
+                                  "Argument of type `in_image` requires an extent if it is passed as value.");
+                }
+
+                in_image(dim_vec extent, cl_image_format format = make_image_format()) :
+                    extent_(std::move(extent)), format_(format) {
+                    if (extent_.empty() || extent_.size() > Dims) {
+                        ACTOR_RAISE_ERROR("in_image extent has no or too many dimensions");
+                    }
+                    for (auto x : extent_) {
+                        if (x == 0) {
+                            ACTOR_RAISE_ERROR("in_image requires a non-empty extent");
+                        }
+                    }
+                }
+
+                dim_vec extent_;
+                cl_image_format format_;
+            };
+
+            /// Mark a spawn argument as an output image with `Dims` dimensions, which
+            /// is returned as image_ref.
+            template<class Arg, size_t Dims = 2>
+            struct out_image : arg_tag, output_tag {
+                static_assert(Dims >= 1 && Dims <= 3, "Images have one to three dimensions.");
+                using arg_type = detail::decay_t<Arg>;
+
+                out_image(dim_vec extent, cl_image_format format = make_image_format()) :
+                    extent_(std::move(extent)), format_(format) {
+                    // nop
+                }
+
+                dim_vec extent_;
+                cl_image_format format_;
+            };
+
+            /// Mark a spawn argument as a sampler, which is created once by the actor
+            /// and passed to every kernel execution.
+            struct sampler : arg_tag {
+                using arg_type = cl_sampler;
+
+                sampler(cl_filter_mode filter = CL_FILTER_NEAREST,
+                        cl_addressing_mode addressing = CL_ADDRESS_CLAMP_TO_EDGE,
+                        cl_bool normalized_coords = CL_FALSE) :
+                    filter_(filter),
+                    addressing_(addressing), normalized_coords_(normalized_coords) {
+                    // nop
+                }
+
+                cl_filter_mode filter_;
+                cl_addressing_mode addressing_;
+                cl_bool normalized_coords_;
+            };
+
+            /// Mark a spawn argument as an input that is cut out of a larger host
+            /// buffer. The incoming vector is interpreted as a row-major matrix and
+            /// only the box described by the rect is uploaded, i.e., the kernel sees
+            /// the elements of the box as a tightly packed buffer.
+            template<class Arg>
+            struct in_rect : arg_tag, input_tag {
+                using tag_type = val;
+                using arg_type = detail::decay_t<Arg>;
+
+                in_rect(buffer_rect rect) : rect_(std::move(rect)) {
+                    // nop
+                }
+
+                buffer_rect rect_;
+            };
+
+            /// Mark a spawn argument as an output whose device buffer holds a larger
+            /// row-major matrix of which only the box described by the rect is read
+            /// back. The result is returned as a tightly packed vector.
+            template<class Arg>
+            struct out_rect : arg_tag, output_tag {
+                using tag_type = val;
+                using arg_type = detail::decay_t<Arg>;
+
+                out_rect(buffer_rect rect) : rect_(std::move(rect)) {
+                    // nop
+                }
+
+                buffer_rect rect_;
+            };
+
+            /// Mark a spawn argument as an input of structs that is uploaded in planar
+            /// layout, see `soa_layout`. The incoming vector holds the structs and the
+            /// kernel receives a single buffer with one plane per field, which lets
+            /// neighboring work items load neighboring values of the same field.
+            template<class Arg>
+            struct in_soa : arg_tag, input_tag {
+                using tag_type = val;
+                using arg_type = detail::decay_t<Arg>;
+
+                in_soa() : layout_(soa_layout::of<arg_type>()) {
+                    // nop
+                }
+
+                soa_layout layout_;
+            };
+
+            /// Mark a spawn argument as an output of structs that the kernel writes in
+            /// planar layout, see `soa_layout`. The planes are gathered into a vector of
+            /// structs after reading them back. The number of elements is calculated
+            /// by a function of type `Fun`, which is type-erased if `void`.
+            template<class Arg, class Fun = void>
+            struct out_soa : arg_tag, output_tag, requires_size_tag {
+                using tag_type = val;
+                using arg_type = detail::decay_t<Arg>;
+
+                out_soa() : layout_(soa_layout::of<arg_type>()) {
+                    // nop
+                }
+
+                template<class F,
+                         class = typename std::enable_if<!std::is_base_of<arg_tag, detail::decay_t<F>>::value>::type>
+                out_soa(F fun) : layout_(soa_layout::of<arg_type>()), fun_ {std::move(fun)} {
+                    // nop
+                }
+
+                optional<size_t> operator()(message &msg) const {
+                    return detail::try_apply_fun(fun_, msg, 0UL);
+                }
+
+                soa_layout layout_;
+                detail::arg_fun<size_t, Fun> fun_;
+            };
+
+            /// Creates an `out` argument whose size function is stored by its type.
+            template<class Arg, class Tag = val, class F>
+            out<Arg, Tag, F> make_out(F fun) {
+                return {std::move(fun)};
+            }
+
+            /// Creates a `scratch` argument whose size function is stored by its type.
+            template<class Arg, class F>
+            scratch<Arg, F> make_scratch(F fun) {
+                return {std::move(fun)};
+            }
+
+            /// Creates a `local` argument whose size function is stored by its type.
+            template<class Arg, class F>
+            local<Arg, F> make_local(size_t size, F fun) {
+                return {size, std::move(fun)};
+            }
+
+            /// Creates a hidden `priv` argument whose function is stored by its type.
+            template<class Arg, class F>
+            priv<Arg, hidden, F> make_priv(Arg value, F fun) {
+                return {value, std::move(fun)};
+            }
+
             /// Cconverts C arrays, i.e., pointers, to vectors.
             template<class T>
             struct carr_to_vec {
@@ -258,26 +497,66 @@ namespace nil {
                 using type = detail::decay_t<typename carr_to_vec<T>::type>;
             };
 
-            template<class T, class Tag>
-            struct extract_type<out<T, Tag>> {
+            template<class T, class Tag, class F>
+            struct extract_type<out<T, Tag, F>> {
                 using type = detail::decay_t<typename carr_to_vec<T>::type>;
             };
 
-            template<class T>
-            struct extract_type<scratch<T>> {
+            template<class T, class F>
+            struct extract_type<scratch<T, F>> {
                 using type = detail::decay_t<typename carr_to_vec<T>::type>;
             };
 
-            template<class T>
-            struct extract_type<local<T>> {
+            template<class T, class F>
+            struct extract_type<local<T, F>> {
                 using type = detail::decay_t<typename carr_to_vec<T>::type>;
             };
 
-            template<class T, class Tag>
-            struct extract_type<priv<T, Tag>> {
+            template<class T, class Tag, class F>
+            struct extract_type<priv<T, Tag, F>> {
                 using type = detail::decay_t<typename carr_to_vec<T>::type>;
             };
 
+            template<class T, size_t Dim>
+            struct extract_type<real_size<T, Dim>> {
+                using type = detail::decay_t<T>;
+            };
+
+            template<class T, size_t Dims, class Tag>
+            struct extract_type<in_image<T, Dims, Tag>> {
+                using type = detail::decay_t<T>;
+            };
+
+            template<class T, size_t Dims>
+            struct extract_type<out_image<T, Dims>> {
+                using type = detail::decay_t<T>;
+            };
+
+            template<class T>
+            struct extract_type<in_rect<T>> {
+                using type = detail::decay_t<T>;
+            };
+
+            template<class T>
+            struct extract_type<out_rect<T>> {
+                using type = detail::decay_t<T>;
+            };
+
+            template<class T>
+            struct extract_type<in_soa<T>> {
+                using type = detail::decay_t<T>;
+            };
+
+            template<class T, class F>
+            struct extract_type<out_soa<T, F>> {
+                using type = detail::decay_t<T>;
+            };
+
+            template<>
+            struct extract_type<sampler> {
+                using type = cl_sampler;
+            };
+
             /// extract type expected in an incoming message
             template<class T>
             struct extract_input_type {};
@@ -292,6 +571,11 @@ namespace nil {
                 using type = opencl::mem_ref<Arg>;
             };
 
+            template<class Arg>
+            struct extract_input_type<in<Arg, cached>> {
+                using type = std::vector<Arg>;
+            };
+
             template<class Arg, class TagOut>
             struct extract_input_type<in_out<Arg, val, TagOut>> {
                 using type = std::vector<Arg>;
@@ -302,22 +586,42 @@ namespace nil {
                 using type = opencl::mem_ref<Arg>;
             };
 
-            template<class Arg>
-            struct extract_input_type<priv<Arg, val>> {
+            template<class Arg, class F>
+            struct extract_input_type<priv<Arg, val, F>> {
                 using type = Arg;
             };
 
+            template<class Arg, size_t Dims>
+            struct extract_input_type<in_image<Arg, Dims, val>> {
+                using type = std::vector<Arg>;
+            };
+
+            template<class Arg, size_t Dims>
+            struct extract_input_type<in_image<Arg, Dims, mref>> {
+                using type = opencl::image_ref<Arg, Dims>;
+            };
+
+            template<class Arg>
+            struct extract_input_type<in_rect<Arg>> {
+                using type = std::vector<Arg>;
+            };
+
+            template<class Arg>
+            struct extract_input_type<in_soa<Arg>> {
+                using type = std::vector<Arg>;
+            };
+
             /// extract type sent in an outgoing message
             template<class T>
             struct extract_output_type {};
 
-            template<class Arg>
-            struct extract_output_type<out<Arg, val>> {
+            template<class Arg, class F>
+            struct extract_output_type<out<Arg, val, F>> {
                 using type = std::vector<Arg>;
             };
 
-            template<class Arg>
-            struct extract_output_type<out<Arg, mref>> {
+            template<class Arg, class F>
+            struct extract_output_type<out<Arg, mref, F>> {
                 using type = opencl::mem_ref<Arg>;
             };
 
@@ -331,6 +635,21 @@ namespace nil {
                 using type = opencl::mem_ref<Arg>;
             };
 
+            template<class Arg, size_t Dims>
+            struct extract_output_type<out_image<Arg, Dims>> {
+                using type = opencl::image_ref<Arg, Dims>;
+            };
+
+            template<class Arg>
+            struct extract_output_type<out_rect<Arg>> {
+                using type = std::vector<Arg>;
+            };
+
+            template<class Arg, class F>
+            struct extract_output_type<out_soa<Arg, F>> {
+                using type = std::vector<Arg>;
+            };
+
             /// extract input tag
             template<class T>
             struct extract_input_tag {};
@@ -345,8 +664,23 @@ namespace nil {
                 using tag = TagIn;
             };
 
+            template<class Arg, class F>
+            struct extract_input_tag<priv<Arg, val, F>> {
+                using tag = val;
+            };
+
+            template<class Arg, size_t Dims, class Tag>
+            struct extract_input_tag<in_image<Arg, Dims, Tag>> {
+                using tag = Tag;
+            };
+
             template<class Arg>
-            struct extract_input_tag<priv<Arg, val>> {
+            struct extract_input_tag<in_rect<Arg>> {
+                using tag = val;
+            };
+
+            template<class Arg>
+            struct extract_input_tag<in_soa<Arg>> {
                 using tag = val;
             };
 
@@ -354,8 +688,8 @@ namespace nil {
             template<class T>
             struct extract_output_tag {};
 
-            template<class Arg, class Tag>
-            struct extract_output_tag<out<Arg, Tag>> {
+            template<class Arg, class Tag, class F>
+            struct extract_output_tag<out<Arg, Tag, F>> {
                 using tag = Tag;
             };
 
@@ -364,6 +698,21 @@ namespace nil {
                 using tag = TagOut;
             };
 
+            template<class Arg, size_t Dims>
+            struct extract_output_tag<out_image<Arg, Dims>> {
+                using tag = mref;
+            };
+
+            template<class Arg>
+            struct extract_output_tag<out_rect<Arg>> {
+                using tag = val;
+            };
+
+            template<class Arg, class F>
+            struct extract_output_tag<out_soa<Arg, F>> {
+                using tag = val;
+            };
+
             /// Create the return message from tuple arumgent
             struct message_from_results {
                 template<class T, class... Ts>
@@ -392,8 +741,26 @@ namespace nil {
                 static constexpr int next = Counter + 1;
             };
 
-            template<int Counter, class Arg, class Tag>
-            struct out_index_of<Counter, out<Arg, Tag>> {
+            template<int Counter, class Arg, class Tag, class F>
+            struct out_index_of<Counter, out<Arg, Tag, F>> {
+                static constexpr int value = Counter;
+                static constexpr int next = Counter + 1;
+            };
+
+            template<int Counter, class Arg, size_t Dims>
+            struct out_index_of<Counter, out_image<Arg, Dims>> {
+                static constexpr int value = Counter;
+                static constexpr int next = Counter + 1;
+            };
+
+            template<int Counter, class Arg>
+            struct out_index_of<Counter, out_rect<Arg>> {
+                static constexpr int value = Counter;
+                static constexpr int next = Counter + 1;
+            };
+
+            template<int Counter, class Arg, class F>
+            struct out_index_of<Counter, out_soa<Arg, F>> {
                 static constexpr int value = Counter;
                 static constexpr int next = Counter + 1;
             };
@@ -417,8 +784,26 @@ namespace nil {
                 static constexpr int next = Counter + 1;
             };
 
+            template<int Counter, class Arg, class F>
+            struct in_index_of<Counter, priv<Arg, val, F>> {
+                static constexpr int value = Counter;
+                static constexpr int next = Counter + 1;
+            };
+
+            template<int Counter, class Arg, size_t Dims, class Tag>
+            struct in_index_of<Counter, in_image<Arg, Dims, Tag>> {
+                static constexpr int value = Counter;
+                static constexpr int next = Counter + 1;
+            };
+
             template<int Counter, class Arg>
-            struct in_index_of<Counter, priv<Arg, val>> {
+            struct in_index_of<Counter, in_rect<Arg>> {
+                static constexpr int value = Counter;
+                static constexpr int next = Counter + 1;
+            };
+
+            template<int Counter, class Arg>
+            struct in_index_of<Counter, in_soa<Arg>> {
                 static constexpr int value = Counter;
                 static constexpr int next = Counter + 1;
             };
@@ -471,6 +856,19 @@ namespace nil {
                 using type = typename cl_arg_info_list_impl<detail::type_list<>, List, 0, 0>::type;
             };
 
+            /// Position of the argument producing the output at `OutPos` in a list
+            /// created by `cl_arg_info_list`, -1 if no argument produces it.
+            template<int OutPos, class List, long Pos = 0>
+            struct output_arg_pos;
+
+            template<int OutPos, long Pos>
+            struct output_arg_pos<OutPos, detail::type_list<>, Pos> : std::integral_constant<long, -1> {};
+
+            template<int OutPos, class Info, class... Infos, long Pos>
+            struct output_arg_pos<OutPos, detail::type_list<Info, Infos...>, Pos>
+                : std::conditional<Info::out_pos == OutPos, std::integral_constant<long, Pos>,
+                                   output_arg_pos<OutPos, detail::type_list<Infos...>, Pos + 1>>::type {};
+
             /// Helpers for conversion in deprecated spawn functions
 
             template<class T>
@@ -0,0 +1,59 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/metrics.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// Remembers the last value bound to each argument of a kernel and skips
+            /// `clSetKernelArg` calls that would bind the same bytes again. Kernel
+            /// arguments stay bound between launches, hence uniform values such as
+            /// `priv`, `real_size` and `local` arguments only need to be set when
+            /// they change. The kernel must not be shared with code that sets its
+            /// arguments without this cache. Not thread safe.
+            class binding_cache {
+            public:
+                binding_cache(size_t num_args, device_counters &counters);
+
+                /// Binds the `size` bytes at `value` to argument `index` unless the
+                /// argument holds them already. A `nullptr` value allocates `size`
+                /// bytes of local memory.
+                void set(cl_kernel kernel, cl_uint index, size_t size, const void *value);
+
+                /// Binds the memory object `mem` to argument `index`. Always calls
+                /// `clSetKernelArg`, because the handle of a released memory object
+                /// may be reused by the next allocation.
+                void set_mem(cl_kernel kernel, cl_uint index, cl_mem mem);
+
+                /// Forgets all bound values, e.g., after setting arguments elsewhere.
+                void clear();
+
+            private:
+                struct binding {
+                    bool valid = false;
+                    bool local = false;
+                    size_t size = 0;
+                    std::vector<char> bytes;
+                };
+
+                std::vector<binding> bindings_;
+                device_counters *counters_;
+            };
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,119 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include <nil/actor/detail/raw_ptr.hpp>
+
+#include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/memory_accountant.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// A content-addressed cache of read-only device buffers. Host data is
+            /// looked up by its hash and size and compared against a host copy of the
+            /// cached data, hence a hash collision costs a transfer but never binds
+            /// the wrong data. Buffers are evicted in least recently used order once
+            /// the cache exceeds its budget. Each device owns one cache, which is
+            /// shared by all actors running on the device.
+            class buffer_cache {
+            public:
+                /// A device-resident copy of some host data and the event of the
+                /// transfer that filled it (if the transfer may still be pending).
+                struct entry {
+                    detail::raw_mem_ptr memory;
+                    detail::raw_event_ptr event;
+                };
+
+                explicit buffer_cache(size_t budget = 0);
+
+                buffer_cache(const buffer_cache &) = delete;
+
+                buffer_cache &operator=(const buffer_cache &) = delete;
+
+                /// Returns a buffer holding a copy of the `num_bytes` bytes at `data`.
+                /// A hit requires the cached bytes to equal the bytes at `data`.
+                /// On a miss, allocates a new buffer through `memory` and enqueues a
+                /// non-blocking upload on `queue`, in which case `data` must remain
+                /// valid until the returned event completed.
+                entry lookup_or_upload(memory_accountant &memory, const detail::raw_command_queue_ptr &queue,
+                                       const void *data, size_t num_bytes);
+
+                /// Drops least recently used entries until at least `num_bytes` bytes
+                /// were released or the cache is empty.
+                /// @returns the number of bytes released.
+                size_t evict(size_t num_bytes);
+
+                /// Drops all entries.
+                void clear();
+
+                /// Sets the maximum number of bytes kept on the device and evicts
+                /// entries if necessary.
+                void budget(size_t num_bytes);
+
+                /// Returns the maximum number of bytes kept on the device.
+                size_t budget() const;
+
+                /// Returns the number of bytes currently kept on the device.
+                size_t size_in_bytes() const;
+
+                /// Returns the number of lookups served without a transfer.
+                size_t hits() const;
+
+                /// Returns the number of lookups that required a transfer.
+                size_t misses() const;
+
+            private:
+                struct key {
+                    uint64_t hash;
+                    size_t num_bytes;
+
+                    bool operator==(const key &other) const {
+                        return hash == other.hash && num_bytes == other.num_bytes;
+                    }
+                };
+
+                struct key_hash {
+                    size_t operator()(const key &x) const {
+                        return static_cast<size_t>(x.hash ^ (x.num_bytes * 0x9E3779B97F4A7C15ULL));
+                    }
+                };
+
+                struct slot {
+                    key id;
+                    entry value;
+                    /// Host copy of the cached data for verifying hits.
+                    std::vector<char> bytes;
+                };
+
+                using lru_list = std::list<slot>;
+
+                // Requires `mtx_` to be locked.
+                size_t evict_locked(size_t num_bytes);
+
+                mutable std::mutex mtx_;
+                lru_list lru_;
+                std::unordered_map<key, lru_list::iterator, key_hash> index_;
+                size_t budget_;
+                size_t size_;
+                size_t hits_;
+                size_t misses_;
+            };
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
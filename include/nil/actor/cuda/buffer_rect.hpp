@@ -0,0 +1,95 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <array>
+
+#include <nil/actor/cuda/global.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// Describes a box inside a row-major buffer with up to three dimensions.
+            /// All values are given in elements rather than bytes. Unused dimensions
+            /// have an origin of 0 and a region of 1. A pitch of 0 means that rows,
+            /// respectively slices, are tightly packed.
+            struct buffer_rect {
+                std::array<size_t, 3> origin;
+                std::array<size_t, 3> region;
+                size_t row_pitch;
+                size_t slice_pitch;
+
+                buffer_rect() : origin {{0, 0, 0}}, region {{0, 1, 1}}, row_pitch(0), slice_pitch(0) {
+                    // nop
+                }
+
+                buffer_rect(const dim_vec &origin_dims, const dim_vec &region_dims, size_t row_pitch_elements = 0,
+                            size_t slice_pitch_elements = 0) :
+                    origin {{0, 0, 0}},
+                    region {{1, 1, 1}}, row_pitch(row_pitch_elements), slice_pitch(slice_pitch_elements) {
+                    for (size_t i = 0; i < 3 && i < origin_dims.size(); ++i) {
+                        origin[i] = origin_dims[i];
+                    }
+                    for (size_t i = 0; i < 3 && i < region_dims.size(); ++i) {
+                        region[i] = region_dims[i];
+                    }
+                }
+
+                /// Returns the number of elements in a row.
+                size_t row_size() const {
+                    return row_pitch == 0 ? region[0] : row_pitch;
+                }
+
+                /// Returns the number of elements in a slice.
+                size_t slice_size() const {
+                    return slice_pitch == 0 ? row_size() * region[1] : slice_pitch;
+                }
+
+                /// Returns the number of elements inside the box.
+                size_t num_elements() const {
+                    return region[0] * region[1] * region[2];
+                }
+
+                /// Returns the minimum number of elements of a buffer containing the box.
+                size_t extent() const {
+                    if (num_elements() == 0) {
+                        return 0;
+                    }
+                    return (origin[2] + region[2] - 1) * slice_size() + (origin[1] + region[1] - 1) * row_size() +
+                           origin[0] + region[0];
+                }
+
+                /// Returns a box of the same size that starts at the first element of a
+                /// tightly packed buffer.
+                buffer_rect packed() const {
+                    buffer_rect result;
+                    result.region = region;
+                    return result;
+                }
+
+                /// Returns the origin in the format of the `clEnqueue*BufferRect`
+                /// functions, which expect the first component in bytes.
+                template<class T>
+                std::array<size_t, 3> origin_bytes() const {
+                    return {{origin[0] * sizeof(T), origin[1], origin[2]}};
+                }
+
+                /// Returns the region in the format of the `clEnqueue*BufferRect`
+                /// functions, which expect the first component in bytes.
+                template<class T>
+                std::array<size_t, 3> region_bytes() const {
+                    return {{region[0] * sizeof(T), region[1], region[2]}};
+                }
+            };
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,99 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+#include <nil/actor/optional.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// Hands out chunks of a job of independent work items to a set of
+            /// workers, e.g., devices of different speed. Idle workers pull the next
+            /// chunk from the front of the remaining items, sized by their share of
+            /// the measured throughput. Once no items remain, an idle worker steals a
+            /// late chunk by running it as well, the first result wins. Throughput
+            /// estimates persist across jobs. Not thread safe.
+            class chunk_scheduler {
+            public:
+                using clock = std::chrono::steady_clock;
+
+                struct chunk {
+                    /// Unique across jobs, hence results of previous jobs are ignored.
+                    size_t id;
+                    size_t first;
+                    size_t count;
+                };
+
+                /// Creates a scheduler for one worker per element of `weights`, which
+                /// hold their relative speed until all workers finished a chunk.
+                /// Chunks have at least `min_chunk` items unless fewer remain.
+                chunk_scheduler(std::vector<double> weights, size_t min_chunk);
+
+                /// Starts a job with `num_items` items. Drops all chunks of the
+                /// previous job.
+                void reset(size_t num_items);
+
+                /// Returns the next chunk for the idle `worker`, or `none` if neither
+                /// items remain nor a chunk is worth stealing.
+                optional<chunk> next(size_t worker, clock::time_point now);
+
+                /// Records that `worker` finished chunk `id`.
+                /// @returns whether this is the first result for a chunk of the
+                ///          current job, i.e., whether the caller should use it.
+                bool complete(size_t worker, size_t id, clock::time_point now);
+
+                /// Returns whether all items of the current job are complete.
+                bool done() const {
+                    return remaining_ == 0;
+                }
+
+                /// Returns the estimated items per second of `worker`, or 0 before
+                /// it finished a chunk.
+                double throughput(size_t worker) const {
+                    return throughput_[worker];
+                }
+
+                size_t num_workers() const {
+                    return weights_.size();
+                }
+
+            private:
+                struct run {
+                    size_t worker;
+                    clock::time_point start;
+                };
+
+                struct entry {
+                    size_t id;
+                    size_t first;
+                    size_t count;
+                    std::vector<run> runs;
+                    bool done;
+                };
+
+                double share(size_t worker) const;
+
+                std::vector<double> weights_;
+                std::vector<double> throughput_;
+                size_t min_chunk_;
+                size_t next_id_;
+                size_t next_item_;
+                size_t num_items_;
+                size_t remaining_;
+                std::vector<entry> chunks_;
+            };
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
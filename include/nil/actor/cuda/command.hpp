@@ -10,6 +10,7 @@
 #pragma once
 
 #include <tuple>
+#include <chrono>
 #include <vector>
 #include <numeric>
 #include <algorithm>
@@ -23,11 +24,14 @@
 
 #include <nil/actor/detail/raw_ptr.hpp>
 #include <nil/actor/detail/scope_guard.hpp>
+#include <nil/actor/detail/static_vector.hpp>
 
 #include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/tracer.hpp>
 #include <nil/actor/cuda/nd_range.hpp>
 #include <nil/actor/cuda/arguments.hpp>
 #include <nil/actor/cuda/opencl_error.hpp>
+#include <nil/actor/cuda/completion_executor.hpp>
 
 namespace nil {
     namespace actor {
@@ -36,25 +40,34 @@ namespace nil {
             /// A command represents the execution of a kernel on a device. It handles the
             /// OpenCL calls to enqueue the kernel with the index space and keeps references
             /// to the management data during the execution. Furthermore, the command sends
-            /// the execution results to the responsible actor.
+            /// the execution results to the responsible actor. Results are handled on the
+            /// completion executor of the actor rather than on the thread of the OpenCL
+            /// runtime that signals the completion.
             template<class Actor, class... Ts>
-            class command : public ref_counted {
+            class command : public ref_counted, public completion_executor::job {
             public:
                 using result_types = detail::type_list<Ts...>;
 
-                command(response_promise promise, strong_actor_ptr parent, std::vector<cl_event> events,
-                        std::vector<detail::raw_mem_ptr> inputs, std::vector<detail::raw_mem_ptr> outputs,
-                        std::vector<detail::raw_mem_ptr> scratches, std::vector<size_t> lengths, message msg,
-                        std::tuple<Ts...> output_tuple, nd_range range) :
+                using evnt_vec = typename Actor::evnt_vec;
+                using mem_vec = typename Actor::mem_vec;
+                using len_vec = typename Actor::len_vec;
+
+                // the kernel event and at most one read per result
+                using out_evnt_vec = detail::static_vector<cl_event, sizeof...(Ts) + 1>;
+
+                command(response_promise promise, strong_actor_ptr parent, evnt_vec events, mem_vec inputs,
+                        mem_vec outputs, mem_vec scratches, len_vec lengths, message msg,
+                        std::tuple<Ts...> output_tuple, nd_range range, uint64_t received = 0) :
                     lengths_(std::move(lengths)),
                     promise_(std::move(promise)), cl_actor_(std::move(parent)), mem_in_events_(std::move(events)),
                     input_buffers_(std::move(inputs)), output_buffers_(std::move(outputs)),
                     scratch_buffers_(std::move(scratches)), results_(std::move(output_tuple)), msg_(std::move(msg)),
-                    range_(std::move(range)) {
-                    // nop
+                    range_(std::move(range)), received_(received), enqueued_(0), trace_id_(0) {
+                    ++counters().in_flight;
                 }
 
                 ~command() override {
+                    --counters().in_flight;
                     for (auto &e : mem_in_events_) {
                         if (e) {
                             v1callcl(ACTOR_CLF(clReleaseEvent), e);
@@ -77,43 +90,46 @@ namespace nil {
                     // because they require non-standard error handling
                     ACTOR_LOG_TRACE("");
                     this->ref();    // reference held by the OpenCL comand queue
-                    auto data_or_nullptr = [](const dim_vec &vec) { return vec.empty() ? nullptr : vec.data(); };
+                    ++counters().commands;
                     auto parent = static_cast<Actor *>(actor_cast<abstract_actor *>(cl_actor_));
+                    trace_dispatch(parent);
                     // OpenCL expects cl_uint (unsigned int), hence the cast
                     mem_out_events_.emplace_back();
-                    auto success = invoke_cl(
-                        clEnqueueNDRangeKernel, parent->queue_.get(), parent->kernel_.get(),
-                        static_cast<unsigned int>(range_.dimensions().size()), data_or_nullptr(range_.offsets()),
-                        data_or_nullptr(range_.dimensions()), data_or_nullptr(range_.local_dimensions()),
-                        static_cast<unsigned int>(mem_in_events_.size()),
-                        (mem_in_events_.empty() ? nullptr : mem_in_events_.data()), &mem_out_events_.back());
+                    auto success = invoke_cl(enqueue_nd_range, parent->queue_.get(), parent->kernel_.get(), range_,
+                                             static_cast<unsigned int>(mem_in_events_.size()),
+                                             (mem_in_events_.empty() ? nullptr : mem_in_events_.data()),
+                                             &mem_out_events_.back());
                     if (!success) {
                         return;
                     }
                     size_t pos = 0;
                     ACTOR_ASSERT(!mem_out_events_.empty());
                     enqueue_read_buffers(pos, mem_out_events_, detail::get_indices(results_));
+                    // only wait for the kernel and the reads of this command instead of
+                    // everything in the queue
                     cl_event marker_event;
-#if defined(__APPLE__)
                     success = invoke_cl(clEnqueueMarkerWithWaitList, parent->queue_.get(),
                                         static_cast<unsigned int>(mem_out_events_.size()), mem_out_events_.data(),
                                         &marker_event);
-#else
-                    success = invoke_cl(clEnqueueMarker, parent->queue_.get(), &marker_event);
-#endif
                     callback_.reset(marker_event, false);
                     if (!success) {
                         return;
                     }
                     auto cb = [](cl_event, cl_int, void *data) {
                         auto cmd = reinterpret_cast<command *>(data);
-                        cmd->handle_results();
-                        cmd->deref();
+                        auto p = static_cast<Actor *>(actor_cast<abstract_actor *>(cmd->cl_actor_));
+                        cmd->completed_ = std::chrono::steady_clock::now();
+                        if (p->executor_ != nullptr) {
+                            ++p->device_->counters().queue_depth;
+                            p->executor_->submit(cmd);
+                        } else {
+                            cmd->run();
+                        }
                     };
                     if (!invoke_cl(clSetEventCallback, callback_.get(), CL_COMPLETE, std::move(cb), this)) {
                         return;
                     }
-                    v3callcl(clFlush, parent->queue_.get());
+                    parent->device_->flusher().request();
                 }
 
                 /// Enqueue the kernel for execution and send the mem_refs relating to the
@@ -126,38 +142,90 @@ namespace nil {
                     // because they require non-standard error handling
                     ACTOR_LOG_TRACE("");
                     this->ref();    // reference held by the OpenCL command queue
-                    auto data_or_nullptr = [](const dim_vec &vec) { return vec.empty() ? nullptr : vec.data(); };
+                    ++counters().commands;
                     auto parent = static_cast<Actor *>(actor_cast<abstract_actor *>(cl_actor_));
+                    trace_dispatch(parent);
                     cl_event execution_event;
-                    auto success =
-                        invoke_cl(clEnqueueNDRangeKernel, parent->queue_.get(), parent->kernel_.get(),
-                                  static_cast<cl_uint>(range_.dimensions().size()), data_or_nullptr(range_.offsets()),
-                                  data_or_nullptr(range_.dimensions()), data_or_nullptr(range_.local_dimensions()),
-                                  static_cast<unsigned int>(mem_in_events_.size()),
-                                  (mem_in_events_.empty() ? nullptr : mem_in_events_.data()), &execution_event);
+                    auto success = invoke_cl(enqueue_nd_range, parent->queue_.get(), parent->kernel_.get(), range_,
+                                             static_cast<unsigned int>(mem_in_events_.size()),
+                                             (mem_in_events_.empty() ? nullptr : mem_in_events_.data()),
+                                             &execution_event);
                     callback_.reset(execution_event, false);
                     if (!success) {
                         return;
                     }
-                    auto cb = [](cl_event, cl_int, void *data) {
+                    auto cb = [](cl_event event, cl_int, void *data) {
                         auto c = reinterpret_cast<command *>(data);
+                        c->trace_device(event);
                         c->deref();
                     };
                     if (!invoke_cl(clSetEventCallback, callback_.get(), CL_COMPLETE, std::move(cb), this)) {
                         return;
                     }
-                    v3callcl(clFlush, parent->queue_.get());
+                    parent->device_->flusher().request();
                     auto msg = msg_adding_event {callback_}(results_);
-                    promise_.deliver(std::move(msg));
+                    deliver(parent, std::move(msg));
+                }
+
+                /// Delivers the results and releases the reference held by the queue.
+                void run() override {
+                    auto parent = static_cast<Actor *>(actor_cast<abstract_actor *>(cl_actor_));
+                    if (parent->executor_ != nullptr) {
+                        --counters().queue_depth;
+                    }
+                    trace_device(mem_out_events_.front());
+                    handle_results();
+                    this->deref();
                 }
 
             private:
+                device_counters &counters() {
+                    return static_cast<Actor *>(actor_cast<abstract_actor *>(cl_actor_))->device_->counters();
+                }
+
+                // records the time from receiving the message until enqueuing the kernel
+                void trace_dispatch(Actor *parent) {
+                    if (auto trace = parent->device_->trace()) {
+                        trace_id_ = trace->next_id();
+                        enqueued_ = trace->now();
+                        trace->record("dispatch", "host", tracer::host_track, received_, enqueued_, trace_id_);
+                    }
+                }
+
+                // records the transfers and the kernel once all of them completed
+                void trace_device(cl_event kernel_event) {
+                    auto parent = static_cast<Actor *>(actor_cast<abstract_actor *>(cl_actor_));
+                    auto trace = parent->device_->trace();
+                    if (trace == nullptr) {
+                        return;
+                    }
+                    auto dev = parent->device_->id();
+                    auto offset = tracer::offset(kernel_event, enqueued_);
+                    for (auto e : mem_in_events_) {
+                        if (e) {
+                            trace->record(e, nullptr, dev, offset, trace_id_);
+                        }
+                    }
+                    trace->record(kernel_event, parent->kernel_name_.c_str(), dev, offset, trace_id_);
+                    for (size_t i = 1; i < mem_out_events_.size(); ++i) {
+                        trace->record(mem_out_events_[i], nullptr, dev, offset, trace_id_);
+                    }
+                }
+
                 template<long I, class T>
-                void enqueue_read(std::vector<T> &, std::vector<cl_event> &events, size_t &pos) {
+                void enqueue_read(std::vector<T> &result, out_evnt_vec &events, size_t &pos) {
+                    auto p = static_cast<Actor *>(actor_cast<abstract_actor *>(cl_actor_));
+                    constexpr auto arg_pos = output_arg_pos<I, typename Actor::processing_list>::value;
+                    enqueue_read<I>(std::get<arg_pos>(p->kernel_signature_), result, events, pos);
+                }
+
+                template<long I, class Wrapper, class T>
+                void enqueue_read(const Wrapper &, std::vector<T> &, out_evnt_vec &events, size_t &pos) {
                     auto p = static_cast<Actor *>(actor_cast<abstract_actor *>(cl_actor_));
                     events.emplace_back();
                     auto size = lengths_[pos];
                     auto buffer_size = sizeof(T) * size;
+                    counters().bytes_downloaded += buffer_size;
                     std::get<I>(results_).resize(size);
                     auto err =
                         clEnqueueReadBuffer(p->queue_.get(), output_buffers_[pos].get(), CL_FALSE, 0, buffer_size,
@@ -170,27 +238,126 @@ namespace nil {
                 }
 
                 template<long I, class T>
-                void enqueue_read(mem_ref<T> &, std::vector<cl_event> &, size_t &) {
+                void enqueue_read(const out_rect<T> &wrapper, std::vector<T> &, out_evnt_vec &events, size_t &pos) {
+                    auto p = static_cast<Actor *>(actor_cast<abstract_actor *>(cl_actor_));
+                    events.emplace_back();
+                    auto &rect = wrapper.rect_;
+                    auto packed = rect.packed();
+                    std::get<I>(results_).resize(lengths_[pos]);
+                    counters().bytes_downloaded += sizeof(T) * rect.num_elements();
+                    auto err = clEnqueueReadBufferRect(
+                        p->queue_.get(), output_buffers_[pos].get(), CL_FALSE, rect.origin_bytes<T>().data(),
+                        packed.origin_bytes<T>().data(), rect.region_bytes<T>().data(), rect.row_size() * sizeof(T),
+                        rect.slice_size() * sizeof(T), packed.row_size() * sizeof(T), packed.slice_size() * sizeof(T),
+                        std::get<I>(results_).data(), 1, events.data(), &events.back());
+                    if (err != CL_SUCCESS) {
+                        this->deref();    // failed to enqueue command
+                        ACTOR_RAISE_ERROR("failed to enqueue command");
+                    }
+                    pos += 1;
+                }
+
+                template<long I, class T, class F>
+                void enqueue_read(const out_soa<T, F> &wrapper, std::vector<T> &, out_evnt_vec &events, size_t &pos) {
+                    auto p = static_cast<Actor *>(actor_cast<abstract_actor *>(cl_actor_));
+                    events.emplace_back();
+                    auto num_bytes = wrapper.layout_.num_bytes(lengths_[pos]);
+                    counters().bytes_downloaded += num_bytes;
+                    // holds the planes until `gather_results` turns them into structs
+                    std::get<I>(results_).resize((num_bytes + sizeof(T) - 1) / sizeof(T));
+                    auto err = clEnqueueReadBuffer(p->queue_.get(), output_buffers_[pos].get(), CL_FALSE, 0, num_bytes,
+                                                   std::get<I>(results_).data(), 1, events.data(), &events.back());
+                    if (err != CL_SUCCESS) {
+                        this->deref();    // failed to enqueue command
+                        ACTOR_RAISE_ERROR("failed to enqueue command");
+                    }
+                    pos += 1;
+                }
+
+                template<long I, class T>
+                void enqueue_read(mem_ref<T> &, out_evnt_vec &, size_t &) {
                     // Nothing to read back if we return references.
                 }
 
-                void enqueue_read_buffers(size_t &, std::vector<cl_event> &, detail::int_list<>) {
+                template<long I, class T, size_t Dims>
+                void enqueue_read(image_ref<T, Dims> &, out_evnt_vec &, size_t &) {
+                    // Images are always returned as references.
+                }
+
+                void enqueue_read_buffers(size_t &, out_evnt_vec &, detail::int_list<>) {
                     // end of recursion
                 }
 
                 template<long I, long... Is>
-                void enqueue_read_buffers(size_t &pos, std::vector<cl_event> &events, detail::int_list<I, Is...>) {
+                void enqueue_read_buffers(size_t &pos, out_evnt_vec &events, detail::int_list<I, Is...>) {
                     enqueue_read<I>(std::get<I>(results_), events, pos);
                     enqueue_read_buffers(pos, events, detail::int_list<Is...> {});
                 }
 
+                template<long I, class T>
+                void gather_result(std::vector<T> &result, size_t &pos) {
+                    auto p = static_cast<Actor *>(actor_cast<abstract_actor *>(cl_actor_));
+                    constexpr auto arg_pos = output_arg_pos<I, typename Actor::processing_list>::value;
+                    gather_result<I>(std::get<arg_pos>(p->kernel_signature_), result, pos);
+                }
+
+                template<long I, class Wrapper, class T>
+                void gather_result(const Wrapper &, std::vector<T> &, size_t &pos) {
+                    pos += 1;
+                }
+
+                template<long I, class T, class F>
+                void gather_result(const out_soa<T, F> &wrapper, std::vector<T> &result, size_t &pos) {
+                    auto planes = std::move(result);
+                    result.resize(lengths_[pos]);
+                    wrapper.layout_.gather(planes.data(), result.size(), result.data());
+                    pos += 1;
+                }
+
+                template<long I, class T>
+                void gather_result(mem_ref<T> &, size_t &) {
+                    // nop
+                }
+
+                template<long I, class T, size_t Dims>
+                void gather_result(image_ref<T, Dims> &, size_t &) {
+                    // nop
+                }
+
+                void gather_results(size_t &, detail::int_list<>) {
+                    // end of recursion
+                }
+
+                /// Converts results that were read back in a device layout, which
+                /// follows the order of `enqueue_read_buffers`.
+                template<long I, long... Is>
+                void gather_results(size_t &pos, detail::int_list<I, Is...>) {
+                    gather_result<I>(std::get<I>(results_), pos);
+                    gather_results(pos, detail::int_list<Is...> {});
+                }
+
                 // handle results if execution result includes a value type
                 void handle_results() {
+                    size_t pos = 0;
+                    gather_results(pos, detail::get_indices(results_));
                     auto parent = static_cast<Actor *>(actor_cast<abstract_actor *>(cl_actor_));
                     auto &map_fun = parent->map_results_;
                     auto msg = map_fun ? apply_args(map_fun, detail::get_indices(results_), results_) :
                                          message_from_results {}(results_);
+                    // measured up to the hand-off, so the receiver always sees the update
+                    auto latency = std::chrono::steady_clock::now() - completed_;
+                    counters().record_callback(
+                        static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count()));
+                    deliver(parent, std::move(msg));
+                }
+
+                void deliver(Actor *parent, message msg) {
+                    auto trace = parent->device_->trace();
+                    auto begin = trace != nullptr ? trace->now() : 0;
                     promise_.deliver(std::move(msg));
+                    if (trace != nullptr) {
+                        trace->record("deliver", "host", tracer::host_track, begin, trace->now(), trace_id_);
+                    }
                 }
 
                 // call function F and derefenrence the command on failure
@@ -205,18 +372,22 @@ namespace nil {
                     return false;
                 }
 
-                std::vector<size_t> lengths_;
+                len_vec lengths_;
                 response_promise promise_;
                 strong_actor_ptr cl_actor_;
-                std::vector<cl_event> mem_in_events_;
-                std::vector<cl_event> mem_out_events_;
+                evnt_vec mem_in_events_;
+                out_evnt_vec mem_out_events_;
                 detail::raw_event_ptr callback_;
-                std::vector<detail::raw_mem_ptr> input_buffers_;
-                std::vector<detail::raw_mem_ptr> output_buffers_;
-                std::vector<detail::raw_mem_ptr> scratch_buffers_;
+                mem_vec input_buffers_;
+                mem_vec output_buffers_;
+                mem_vec scratch_buffers_;
                 std::tuple<Ts...> results_;
                 message msg_;    // keeps the argument buffers alive for async copy to device
                 nd_range range_;
+                std::chrono::steady_clock::time_point completed_;
+                uint64_t received_;    // host clock of the tracer, if any
+                uint64_t enqueued_;
+                uint64_t trace_id_;
             };
         }    // namespace cuda
     }        // namespace actor
@@ -0,0 +1,80 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// Runs completion handlers of OpenCL commands on a small pool of threads
+            /// instead of the callback thread of the OpenCL runtime. Each thread drains
+            /// its own lock-free multi-producer single-consumer queue, submitters pick
+            /// the queues in round robin order.
+            class completion_executor {
+            public:
+                /// An intrusive queue node representing one unit of work.
+                class job {
+                public:
+                    friend class completion_executor;
+
+                    job();
+
+                    virtual ~job();
+
+                    /// Runs the completion handler. The executor does not touch the
+                    /// job afterwards, i.e., `run` may destroy the job.
+                    virtual void run() = 0;
+
+                private:
+                    std::atomic<job *> next_;
+                };
+
+                /// Creates an executor with `num_threads` threads. An executor without
+                /// threads runs all jobs immediately on the submitting thread.
+                explicit completion_executor(size_t num_threads = 0);
+
+                completion_executor(const completion_executor &) = delete;
+
+                completion_executor &operator=(const completion_executor &) = delete;
+
+                ~completion_executor();
+
+                /// Starts the threads.
+                void start();
+
+                /// Stops the threads after running all submitted jobs.
+                void stop();
+
+                /// Schedules `x` for execution. Never blocks and may be called from any
+                /// thread, including callbacks of the OpenCL runtime.
+                void submit(job *x);
+
+                /// Returns the number of threads.
+                size_t num_threads() const;
+
+            private:
+                struct worker;
+
+                void run_worker(worker &w);
+
+                std::vector<std::unique_ptr<worker>> workers_;
+                std::atomic<size_t> next_worker_;
+                std::atomic<bool> running_;
+                /// Number of `submit` calls that may still push to a worker.
+                std::atomic<size_t> submitters_;
+            };
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -12,10 +12,17 @@
 #include <vector>
 
 #include <nil/actor/sec.hpp>
+#include <nil/actor/raise_error.hpp>
 
 #include <nil/actor/detail/raw_ptr.hpp>
 
 #include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/tracer.hpp>
+#include <nil/actor/cuda/metrics.hpp>
+#include <nil/actor/cuda/image_ref.hpp>
+#include <nil/actor/cuda/buffer_cache.hpp>
+#include <nil/actor/cuda/flush_batcher.hpp>
+#include <nil/actor/cuda/memory_accountant.hpp>
 #include <nil/actor/cuda/opencl_error.hpp>
 
 namespace nil {
@@ -39,6 +46,8 @@ namespace nil {
 
                 friend class manager;
 
+                friend class persistent_kernel;
+
                 template<class T>
                 friend class mem_ref;
 
@@ -53,20 +62,61 @@ namespace nil {
                                            optional<size_t> size = none, cl_bool blocking = CL_FALSE) {
                     size_t num_elements = size ? *size : data.size();
                     size_t buffer_size = sizeof(T) * num_elements;
-                    auto buffer = v2get(ACTOR_CLF(clCreateBuffer), context_.get(), flags, buffer_size, nullptr);
+                    auto buffer = memory_.create_buffer(flags, buffer_size);
                     detail::raw_event_ptr event {v1get<cl_event>(ACTOR_CLF(clEnqueueWriteBuffer), queue_.get(), buffer,
                                                                  blocking, cl_uint {0}, buffer_size, data.data()),
                                                  false};
+                    counters_.bytes_uploaded += buffer_size;
                     return mem_ref<T> {num_elements, queue_, std::move(buffer), flags, std::move(event)};
                 }
 
                 /// Create an argument for an OpenCL kernel in global memory without data.
                 template<class T>
                 mem_ref<T> scratch_argument(size_t size, cl_mem_flags flags = buffer_type::scratch_space) {
-                    auto buffer = v2get(ACTOR_CLF(clCreateBuffer), context_.get(), flags, sizeof(T) * size, nullptr);
+                    auto buffer = memory_.create_buffer(flags, sizeof(T) * size);
                     return mem_ref<T> {size, queue_, std::move(buffer), flags, nullptr};
                 }
 
+                /// Create an image argument with `Dims` dimensions of size `extent` and
+                /// initialize it with `data`, which holds one element per pixel.
+                /// @throws std::runtime_error if `sizeof(T)` does not match `format`.
+                template<class T, size_t Dims = 2>
+                image_ref<T, Dims> image_argument(const std::vector<T> &data, const dim_vec &extent,
+                                                  cl_image_format format = make_image_format(),
+                                                  cl_mem_flags flags = buffer_type::input_output,
+                                                  cl_bool blocking = CL_FALSE) {
+                    auto result = scratch_image<T, Dims>(extent, format, flags);
+                    auto &region = result.extent();
+                    if (data.size() < result.size()) {
+                        ACTOR_RAISE_ERROR("image_argument: not enough data");
+                    }
+                    image_region origin {{0, 0, 0}};
+                    detail::raw_event_ptr event {
+                        v1get<cl_event>(ACTOR_CLF(clEnqueueWriteImage), queue_.get(), result.get().get(), blocking,
+                                        origin.data(), region.data(), size_t {0}, size_t {0}, data.data()),
+                        false};
+                    counters_.bytes_uploaded += sizeof(T) * result.size();
+                    result.set_event(std::move(event));
+                    return result;
+                }
+
+                /// Create an image with `Dims` dimensions of size `extent` without data.
+                /// @throws std::runtime_error if `sizeof(T)` does not match `format`.
+                template<class T, size_t Dims = 2>
+                image_ref<T, Dims> scratch_image(const dim_vec &extent, cl_image_format format = make_image_format(),
+                                                 cl_mem_flags flags = buffer_type::input_output) {
+                    auto region = to_image_region<Dims>(extent);
+                    auto desc = make_image_desc<Dims>(region);
+                    auto num_bytes = sizeof(T) * region[0] * region[1] * region[2];
+                    detail::raw_mem_ptr image {memory_.create_image(flags, format, desc, num_bytes), false};
+                    auto element_size =
+                        v3get<size_t>(ACTOR_CLF(clGetImageInfo), image.get(), cl_image_info {CL_IMAGE_ELEMENT_SIZE});
+                    if (element_size != sizeof(T)) {
+                        ACTOR_RAISE_ERROR("image element type does not match the channel format");
+                    }
+                    return image_ref<T, Dims> {region, format, queue_, std::move(image), flags, nullptr};
+                }
+
                 template<class T>
                 expected<mem_ref<T>> copy(mem_ref<T> &mem) {
                     if (!mem.get()) {
@@ -74,7 +124,7 @@ namespace nil {
                     }
                     auto buffer_size = sizeof(T) * mem.size();
                     cl_event event;
-                    auto buffer = v2get(ACTOR_CLF(clCreateBuffer), context_.get(), mem.access(), buffer_size, nullptr);
+                    auto buffer = memory_.create_buffer(mem.access(), buffer_size);
                     std::vector<cl_event> prev_events;
                     cl_event e = mem.take_event();
                     if (e) {
@@ -104,13 +154,43 @@ namespace nil {
                     return mem_ref<T>(mem.size(), queue_, std::move(buffer), mem.access(), {event, false});
                 }
 
-                /// Initialize a new device in a context using a specific device_id
+                /// Initialize a new device in a context using a specific device_id. The
+                /// command queue records profiling info if `trace` is set.
                 static device_ptr create(const detail::raw_context_ptr &context,
-                                         const detail::raw_device_ptr &device_id, unsigned id);
+                                         const detail::raw_device_ptr &device_id, unsigned id,
+                                         tracer *trace = nullptr);
 
                 /// Synchronizes all commands in its queue, waiting for them to finish.
                 void synchronize();
 
+                /// Creates an additional in-order command queue for this device, e.g.,
+                /// to overlap transfers with the execution of kernels.
+                detail::raw_command_queue_ptr create_queue() const;
+
+                /// Returns the cache holding device-resident copies of input arguments
+                /// tagged as `cached`. Its budget defaults to an eighth of the global
+                /// memory of the device.
+                inline buffer_cache &input_cache();
+
+                /// Returns the accountant for all buffers allocated on this device. Its
+                /// soft budget defaults to 90% of the global memory of the device and
+                /// the input cache is evicted first when approaching it.
+                inline memory_accountant &memory();
+
+                /// Returns the batcher coalescing flushes of the command queue shared
+                /// by all actor facades running on this device.
+                inline flush_batcher &flusher();
+
+                /// Returns the tracer recording the commands on this device or `nullptr`
+                /// if tracing is disabled.
+                inline tracer *trace() const;
+
+                /// Returns the counters updated by the actors running on this device.
+                inline device_counters &counters();
+
+                /// Returns a snapshot of the counters and gauges of this device.
+                device_metrics metrics();
+
                 /// Get the id assigned by caf
                 inline unsigned id() const;
 
@@ -132,6 +212,13 @@ namespace nil {
                 /// Returns device info on CL_DEVICE_HOST_UNIFIED_MEMORY
                 inline cl_bool host_unified_memory() const;
 
+                /// Returns device info on CL_DEVICE_IMAGE_SUPPORT
+                inline cl_bool image_support() const;
+
+                /// Returns whether CL_DEVICE_SVM_CAPABILITIES include fine-grained
+                /// buffers with atomics, as required by persistent kernels
+                inline bool svm_atomics() const;
+
                 /// Returns device info on CL_DEVICE_LOCAL_MEM_SIZE
                 inline cl_ulong local_mem_size() const;
 
@@ -206,9 +293,15 @@ namespace nil {
                 detail::raw_command_queue_ptr queue_;
                 detail::raw_context_ptr context_;
                 unsigned id_;
+                memory_accountant memory_;
+                buffer_cache input_cache_;
+                flush_batcher flusher_;
+                tracer *trace_;
+                device_counters counters_;
 
                 bool profiling_enabled_;         // CL_DEVICE_QUEUE_PROPERTIES
                 bool out_of_order_execution_;    // CL_DEVICE_QUEUE_PROPERTIES
+                bool svm_atomics_;               // CL_DEVICE_SVM_CAPABILITIES
 
                 cl_uint address_bits_;                   // CL_DEVICE_ADDRESS_BITS
                 cl_bool little_endian_;                  // CL_DEVICE_ENDIAN_LITTLE
@@ -216,6 +309,7 @@ namespace nil {
                 cl_uint global_mem_cacheline_size_;      // CL_DEVICE_GLOBAL_MEM_CACHELINE_SIZE
                 cl_ulong global_mem_size_;               // CL_DEVICE_GLOBAL_MEM_SIZE
                 cl_bool host_unified_memory_;            // CL_DEVICE_HOST_UNIFIED_MEMORY
+                cl_bool image_support_;                  // CL_DEVICE_IMAGE_SUPPORT
                 cl_ulong local_mem_size_;                // CL_DEVICE_LOCAL_MEM_SIZE
                 cl_uint local_mem_type_;                 // CL_DEVICE_LOCAL_MEM_TYPE
                 cl_uint max_clock_frequency_;            // CL_DEVICE_MAX_CLOCK_FREQUENCY
@@ -245,6 +339,26 @@ namespace nil {
                 return id_;
             }
 
+            inline buffer_cache &device::input_cache() {
+                return input_cache_;
+            }
+
+            inline memory_accountant &device::memory() {
+                return memory_;
+            }
+
+            inline flush_batcher &device::flusher() {
+                return flusher_;
+            }
+
+            inline tracer *device::trace() const {
+                return trace_;
+            }
+
+            inline device_counters &device::counters() {
+                return counters_;
+            }
+
             inline cl_uint device::address_bits() const {
                 return address_bits_;
             }
@@ -269,6 +383,14 @@ namespace nil {
                 return host_unified_memory_;
             }
 
+            inline cl_bool device::image_support() const {
+                return image_support_;
+            }
+
+            inline bool device::svm_atomics() const {
+                return svm_atomics_;
+            }
+
             inline cl_ulong device::local_mem_size() const {
                 return local_mem_size_;
             }
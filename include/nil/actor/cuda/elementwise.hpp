@@ -0,0 +1,55 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/device.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// A step of an elementwise chain, given as OpenCL C expression over the
+            /// element `x` and its index `i`, e.g., `x * 2.0f`. All steps of a chain
+            /// run in a single kernel that reads and writes each element once.
+            struct elementwise_op {
+                std::string expression;
+            };
+
+            /// Multiplies each element by `factor`, an OpenCL C expression.
+            inline elementwise_op scale_op(const std::string &factor) {
+                return {"x * (" + factor + ")"};
+            }
+
+            /// Adds `value`, an OpenCL C expression, to each element.
+            inline elementwise_op offset_op(const std::string &value) {
+                return {"x + (" + value + ")"};
+            }
+
+            /// Limits each element to the range from `lo` to `hi`, both OpenCL C
+            /// expressions.
+            inline elementwise_op clamp_op(const std::string &lo, const std::string &hi) {
+                return {"clamp(x, (ACTOR_T) (" + lo + "), (ACTOR_T) (" + hi + "))"};
+            }
+
+            /// Returns the OpenCL C source of the kernel `actor_elementwise` that
+            /// applies `ops` in order to the elements of `type` in place. The kernel
+            /// expects the data and its length.
+            std::string elementwise_source(const char *type, const std::vector<elementwise_op> &ops);
+
+            /// Returns the work-group size used for elementwise kernels on `dev`.
+            size_t elementwise_group_size(const device &dev);
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,114 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/device.hpp>
+#include <nil/actor/cuda/mem_ref.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// Arithmetic modulo an odd prime on integers that consist of 32-bit limbs
+            /// in little-endian order. Products use Montgomery form with R = 2^(32 * n)
+            /// for `n` limbs. The host functions mirror the OpenCL C functions
+            /// returned by `source()`, which kernels use to work on the same values.
+            ///
+            /// Kernels either prepend `source()` to their own source or prepend
+            /// `library()` and build with `options()`, e.g., when the same kernel
+            /// source is compiled for several moduli:
+            ///
+            /// ~~~
+            /// auto prog = mngr.create_program((field.library() + kernels).c_str(), field.options().c_str(), dev);
+            /// ~~~
+            ///
+            /// Besides the element-wise layout, buffers may store elements limb by
+            /// limb (SoA), which `actor_fe_load_soa` reads with coalesced accesses.
+            class montgomery_field {
+            public:
+                using limbs = std::vector<cl_uint>;
+
+                /// @throws std::runtime_error if `modulus` is empty or even.
+                explicit montgomery_field(limbs modulus);
+
+                /// Returns the modulus p.
+                const limbs &modulus() const {
+                    return modulus_;
+                }
+
+                /// Returns the number of limbs of an element.
+                size_t size() const {
+                    return modulus_.size();
+                }
+
+                /// Returns -p^-1 mod 2^32.
+                cl_uint inverse() const {
+                    return inverse_;
+                }
+
+                /// Returns x * R mod p for x < p.
+                limbs to_montgomery(limbs x) const;
+
+                /// Returns a + b mod p for a, b < p.
+                limbs add(const limbs &a, const limbs &b) const;
+
+                /// Returns a - b mod p for a, b < p.
+                limbs sub(const limbs &a, const limbs &b) const;
+
+                /// Returns a * b / R mod p.
+                limbs mul(const limbs &a, const limbs &b) const;
+
+                /// Returns x^e for x in Montgomery form.
+                limbs pow(const limbs &x, const limbs &e) const;
+
+                /// Returns R mod p, i.e., 1 in Montgomery form.
+                limbs one() const;
+
+                /// Returns R^2 mod p, which converts into Montgomery form by `mul`.
+                limbs r2() const;
+
+                /// Converts consecutive elements into a limb-major layout, i.e., limb
+                /// `l` of element `i` out of `n` moves to index `l * n + i`.
+                limbs to_soa(const limbs &elements) const;
+
+                /// Converts a limb-major layout back into consecutive elements.
+                limbs from_soa(const limbs &soa) const;
+
+                /// Creates a buffer on `dev` that holds `elements` in limb-major layout.
+                /// @throws std::runtime_error if `elements` holds a partial element.
+                mem_ref<cl_uint> soa_argument(device &dev, const limbs &elements,
+                                              cl_mem_flags flags = buffer_type::input_output) const;
+
+                /// Reads a buffer in limb-major layout and returns consecutive elements.
+                expected<limbs> soa_data(mem_ref<cl_uint> &ref) const;
+
+                /// Returns the OpenCL C type `actor_fe` for field elements together
+                /// with the macros `ACTOR_LIMBS`, `ACTOR_MODULUS` and `ACTOR_INV` and
+                /// the functions `actor_fe_*` that operate on it.
+                std::string source() const;
+
+                /// Returns the functions of `source()` without the macros.
+                std::string library() const;
+
+                /// Returns build options that define the macros of `source()`.
+                std::string options() const;
+
+            private:
+                limbs modulus_;
+                cl_uint inverse_;
+            };
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,86 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+
+#include <nil/actor/cuda/global.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// Coalesces the `clFlush` calls of commands enqueued to the same command
+            /// queue. Requests made inside a `scope` are flushed once when the
+            /// outermost scope of the thread ends. Otherwise, the first request wakes
+            /// a dedicated thread, started on demand, that issues a single flush, and
+            /// requests arriving until it runs share it. The thread does nothing else,
+            /// hence a launch never waits behind the mapping of results. Once
+            /// `threshold` requests are pending, the queue is flushed immediately to
+            /// not starve the device under load.
+            class flush_batcher {
+            public:
+                /// Marks a burst of commands issued by the calling thread, e.g., a loop
+                /// sending messages to actor facades. Scopes may nest.
+                class scope {
+                public:
+                    scope();
+
+                    scope(const scope &) = delete;
+
+                    scope &operator=(const scope &) = delete;
+
+                    /// Flushes the queues requested during the burst if this is the
+                    /// outermost scope.
+                    ~scope();
+                };
+
+                /// Creates a batcher for `queue`, which must outlive the batcher.
+                explicit flush_batcher(cl_command_queue queue, size_t threshold = 16);
+
+                flush_batcher(const flush_batcher &) = delete;
+
+                flush_batcher &operator=(const flush_batcher &) = delete;
+
+                /// Flushes pending requests and stops the thread.
+                ~flush_batcher();
+
+                /// Makes sure the queue gets flushed after the commands enqueued so far.
+                void request();
+
+                /// Returns the number of `clFlush` calls issued so far.
+                size_t flushes() const;
+
+                /// Returns the number of flush requests received so far.
+                size_t requests() const;
+
+            private:
+                void run();
+
+                void flush();
+
+                cl_command_queue queue_;
+                size_t threshold_;
+                std::atomic<size_t> pending_;
+                std::atomic<bool> scheduled_;
+                std::atomic<size_t> flushes_;
+                std::atomic<size_t> requests_;
+                bool stopping_;
+                std::mutex mtx_;
+                std::condition_variable cv_;
+                std::thread thread_;
+            };
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,274 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <numeric>
+#include <functional>
+
+#include <nil/actor/all.hpp>
+
+#include <nil/actor/raise_error.hpp>
+
+#include <nil/actor/detail/command_helper.hpp>
+
+#include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/nd_range.hpp>
+#include <nil/actor/cuda/arguments.hpp>
+#include <nil/actor/cuda/host_kernel.hpp>
+#include <nil/actor/cuda/completion_executor.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// Filter for arguments supported by the host facade.
+            template<class T>
+            struct is_host_arg : std::false_type {};
+
+            template<class T>
+            struct is_host_arg<in<T, val>> : std::true_type {};
+
+            template<class T>
+            struct is_host_arg<in_out<T, val, val>> : std::true_type {};
+
+            template<class T, class F>
+            struct is_host_arg<out<T, val, F>> : std::true_type {};
+
+            template<class T, class F>
+            struct is_host_arg<scratch<T, F>> : std::true_type {};
+
+            template<class T, class Tag, class F>
+            struct is_host_arg<priv<T, Tag, F>> : std::true_type {};
+
+            template<class T, size_t Dim>
+            struct is_host_arg<real_size<T, Dim>> : std::true_type {};
+
+            /// An actor running a registered `host_kernel` instead of an OpenCL
+            /// kernel, e.g., on nodes without an OpenCL device. Accepts the same
+            /// messages and replies with the same results as an actor facade with
+            /// the same signature. The work items of each message run in chunks on
+            /// the host executor of the manager. An optional input mapping may adapt
+            /// the range to each message.
+            template<class... Ts>
+            class host_facade : public local_actor {
+            public:
+                static_assert(detail::tl_forall<detail::type_list<Ts...>, is_host_arg>::value,
+                              "The host facade only accepts in<T, val>, in_out<T, val, val>, out<T, val>, "
+                              "scratch<T>, priv<T> and real_size<T> arguments.");
+
+                using arg_types = detail::type_list<Ts...>;
+                using unpacked_types = typename detail::tl_map<arg_types, extract_type>::type;
+
+                using input_wrapped_types = typename detail::tl_filter<arg_types, is_input_arg>::type;
+                using input_types = typename detail::tl_map<input_wrapped_types, extract_input_type>::type;
+
+                using output_wrapped_types = typename detail::tl_filter<arg_types, is_output_arg>::type;
+                using output_types = typename detail::tl_map<output_wrapped_types, extract_output_type>::type;
+
+                using processing_list = typename cl_arg_info_list<arg_types>::type;
+
+                using out_tup = typename detail::tuple_type_of<output_types>::type;
+
+                typename detail::il_indices<arg_types>::type indices;
+
+                using kernel_ptr = std::shared_ptr<const host_kernel>;
+
+                using input_mapping = std::function<optional<message>(nd_range &, message &)>;
+
+                const char *name() const override {
+                    return "CUDA host actor";
+                }
+
+                static actor create(actor_config actor_conf, kernel_ptr kernel, completion_executor &executor,
+                                    const nd_range &range, input_mapping map_args, Ts &&... xs) {
+                    if (range.dimensions().empty()) {
+                        ACTOR_RAISE_ERROR("host kernel needs at least 1 global dimension");
+                    }
+                    auto &sys = actor_conf.host->system();
+                    return make_actor<host_facade, actor>(sys.next_actor_id(), sys.node(), &sys, std::move(actor_conf),
+                                                          std::move(kernel), &executor, range, std::move(map_args),
+                                                          std::forward_as_tuple(xs...));
+                }
+
+                void enqueue(mailbox_element_ptr ptr, execution_unit *) override {
+                    ACTOR_ASSERT(ptr != nullptr);
+                    ACTOR_LOG_TRACE(ACTOR_ARG(*ptr));
+                    response_promise promise {ctrl(), *ptr};
+                    auto content = ptr->move_content_to_message();
+                    auto range = range_;
+                    if (map_args_) {
+                        auto mapped = map_args_(range, content);
+                        if (!mapped) {
+                            ACTOR_LOG_ERROR("Mapping argumentes failed.");
+                            return;
+                        }
+                        content = std::move(*mapped);
+                    }
+                    if (!content.match_elements(input_types {})) {
+                        ACTOR_LOG_ERROR("Message types do not match the expected signature.");
+                        return;
+                    }
+                    auto &real_dims = range.real_dimensions();
+                    auto num_items = std::accumulate(std::begin(real_dims), std::end(real_dims), size_t {1},
+                                                     std::multiplies<size_t> {});
+                    auto state = make_counted<launch_state>(kernel_, std::move(range), std::move(content),
+                                                            std::move(promise), num_items);
+                    add_arguments(*state, indices);
+                    auto chunks = host_chunks(num_items, executor_->num_threads());
+                    if (chunks.empty()) {
+                        state->deliver();
+                        return;
+                    }
+                    state->pending = chunks.size();
+                    for (auto &chunk : chunks) {
+                        executor_->submit(new chunk_job(state, chunk.first, chunk.second));
+                    }
+                }
+
+                void enqueue(strong_actor_ptr sender, message_id mid, message content, execution_unit *host) override {
+                    ACTOR_LOG_TRACE("");
+                    enqueue(make_mailbox_element(std::move(sender), mid, {}, std::move(content)), host);
+                }
+
+                host_facade(actor_config actor_conf, kernel_ptr kernel, completion_executor *executor, nd_range range,
+                            input_mapping map_args, std::tuple<Ts...> xs) :
+                    local_actor(actor_conf),
+                    kernel_(std::move(kernel)), executor_(executor), range_(std::move(range)),
+                    map_args_(std::move(map_args)), kernel_signature_(std::move(xs)) {
+                    ACTOR_LOG_TRACE(ACTOR_ARG(this->id()));
+                }
+
+                void launch(execution_unit *, bool, bool) override {
+                    ACTOR_RAISE_ERROR("launch of the host facade should not be called");
+                }
+
+            private:
+                /// Everything a message needs until its last chunk finished.
+                struct launch_state : ref_counted {
+                    launch_state(kernel_ptr fun, nd_range range, message msg, response_promise rp, size_t items) :
+                        kernel(std::move(fun)), args(std::move(range)), content(std::move(msg)),
+                        promise(std::move(rp)), num_items(items), pending(0) {
+                        // nop
+                    }
+
+                    void deliver() {
+                        promise.deliver(message_from_results {}(result));
+                    }
+
+                    kernel_ptr kernel;
+                    host_args args;
+                    message content;
+                    out_tup result;
+                    response_promise promise;
+                    size_t num_items;
+                    std::atomic<size_t> pending;
+                };
+
+                class chunk_job : public completion_executor::job {
+                public:
+                    chunk_job(intrusive_ptr<launch_state> state, size_t begin, size_t end) :
+                        state_(std::move(state)), begin_(begin), end_(end) {
+                        // nop
+                    }
+
+                    void run() override {
+                        (*state_->kernel)(state_->args, begin_, end_);
+                        if (--state_->pending == 0) {
+                            state_->deliver();
+                        }
+                        delete this;
+                    }
+
+                private:
+                    intrusive_ptr<launch_state> state_;
+                    size_t begin_;
+                    size_t end_;
+                };
+
+                void add_arguments(launch_state &, detail::int_list<>) {
+                    // nop
+                }
+
+                template<long I, long... Is>
+                void add_arguments(launch_state &state, detail::int_list<I, Is...>) {
+                    using arg_type = typename detail::tl_at<processing_list, I>::type;
+                    add_argument<I, arg_type::in_pos, arg_type::out_pos>(std::get<I>(kernel_signature_), state);
+                    add_arguments(state, detail::int_list<Is...> {});
+                }
+
+                // inputs are read in place from the message
+
+                template<long I, int InPos, int OutPos, class T>
+                void add_argument(const in<T, val> &, launch_state &state) {
+                    using value_type = typename detail::tl_at<unpacked_types, I>::type;
+                    auto &container = state.content.template get_as<std::vector<value_type>>(InPos);
+                    state.args.add(const_cast<value_type *>(container.data()), container.size());
+                }
+
+                template<long I, int InPos, int OutPos, class T>
+                void add_argument(const in_out<T, val, val> &, launch_state &state) {
+                    using value_type = typename detail::tl_at<unpacked_types, I>::type;
+                    auto &result = std::get<OutPos>(state.result);
+                    result = state.content.template get_as<std::vector<value_type>>(InPos);
+                    state.args.add(result.data(), result.size());
+                }
+
+                template<long I, int InPos, int OutPos, class T, class F>
+                void add_argument(const out<T, val, F> &wrapper, launch_state &state) {
+                    auto &result = std::get<OutPos>(state.result);
+                    result.resize(argument_length(wrapper, state.content, state.num_items));
+                    state.args.add(result.data(), result.size());
+                }
+
+                template<long I, int InPos, int OutPos, class T, class F>
+                void add_argument(const scratch<T, F> &wrapper, launch_state &state) {
+                    using value_type = typename detail::tl_at<unpacked_types, I>::type;
+                    state.args.add_owned(argument_length(wrapper, state.content, state.num_items), sizeof(value_type));
+                }
+
+                template<long I, int InPos, int OutPos, class T, class F>
+                void add_argument(const priv<T, val, F> &, launch_state &state) {
+                    using value_type = typename detail::tl_at<unpacked_types, I>::type;
+                    auto &value = state.content.template get_as<value_type>(InPos);
+                    state.args.add(const_cast<value_type *>(&value), 1);
+                }
+
+                template<long I, int InPos, int OutPos, class T, class F>
+                void add_argument(const priv<T, hidden, F> &wrapper, launch_state &state) {
+                    auto value = wrapper(state.content);
+                    *static_cast<T *>(state.args.add_owned(1, sizeof(T))) = value;
+                }
+
+                template<long I, int InPos, int OutPos, class T, size_t Dim>
+                void add_argument(const real_size<T, Dim> &, launch_state &state) {
+                    auto &dims = state.args.range().real_dimensions();
+                    *static_cast<T *>(state.args.add_owned(1, sizeof(T))) =
+                        static_cast<T>(Dim < dims.size() ? dims[Dim] : 1);
+                }
+
+                template<class Fun>
+                size_t argument_length(Fun &f, message &m, size_t fallback) {
+                    auto length = f(m);
+                    return length && (*length > 0) ? *length : fallback;
+                }
+
+                kernel_ptr kernel_;
+                completion_executor *executor_;
+                nd_range range_;
+                input_mapping map_args_;
+                std::tuple<Ts...> kernel_signature_;
+            };
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,92 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <utility>
+#include <functional>
+
+#include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/nd_range.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// The arguments of one launch of a host kernel, one entry per argument of
+            /// the facade signature. Entries of `in`, `in_out`, `out` and `scratch`
+            /// arguments point to their elements, entries of `priv` and `real_size`
+            /// arguments to their value. `local` arguments are not supported.
+            class host_args {
+            public:
+                explicit host_args(nd_range range);
+
+                host_args(host_args &&) = default;
+
+                host_args &operator=(host_args &&) = default;
+
+                /// Returns the elements of argument `i`.
+                template<class T>
+                T *get(size_t i) const {
+                    return static_cast<T *>(args_[i].first);
+                }
+
+                /// Returns the value of the `priv` or `real_size` argument `i`.
+                template<class T>
+                const T &value(size_t i) const {
+                    return *get<T>(i);
+                }
+
+                /// Returns the number of elements of argument `i`.
+                size_t size(size_t i) const {
+                    return args_[i].second;
+                }
+
+                size_t num_args() const {
+                    return args_.size();
+                }
+
+                /// Returns the range of the launch. Host kernels see the work items of
+                /// the real dimensions linearized in row-major order.
+                const nd_range &range() const {
+                    return range_;
+                }
+
+                /// Appends an argument with `size` elements at `data`, which must stay
+                /// valid for the launch.
+                void add(void *data, size_t size);
+
+                /// Appends an argument with `size` zero-initialized elements of
+                /// `elem_size` bytes that lives as long as the launch and returns it.
+                void *add_owned(size_t size, size_t elem_size);
+
+            private:
+                nd_range range_;
+                std::vector<std::pair<void *, size_t>> args_;
+                std::vector<std::unique_ptr<char[]>> owned_;
+            };
+
+            /// A C++ kernel that runs the linearized work items in `[begin, end)`.
+            /// Launches are split into chunks of consecutive work items that run
+            /// in parallel, hence the body is best a plain loop the compiler can
+            /// vectorize. Work items must not depend on each other.
+            using host_kernel = std::function<void(const host_args &args, size_t begin, size_t end)>;
+
+            /// Splits `num_items` work items into at most `4 * num_threads` chunks of
+            /// at least `host_min_chunk` items each.
+            std::vector<std::pair<size_t, size_t>> host_chunks(size_t num_items, size_t num_threads);
+
+            /// Work items per chunk below which splitting costs more than it gains.
+            constexpr size_t host_min_chunk = 4096;
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,226 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstring>
+
+#include <nil/actor/sec.hpp>
+#include <nil/actor/error.hpp>
+#include <nil/actor/expected.hpp>
+
+#include <nil/actor/detail/raw_ptr.hpp>
+
+#include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/mem_ref.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// Origin or extent of an image region. Unused dimensions are 0 for
+            /// origins and 1 for extents.
+            using image_region = std::array<size_t, 3>;
+
+            /// Creates an image format, the default describes four float channels.
+            inline cl_image_format make_image_format(cl_channel_order order = CL_RGBA,
+                                                     cl_channel_type type = CL_FLOAT) {
+                cl_image_format result;
+                result.image_channel_order = order;
+                result.image_channel_data_type = type;
+                return result;
+            }
+
+            /// Converts the first `Dims` entries of `dims` to an extent.
+            template<size_t Dims>
+            image_region to_image_region(const dim_vec &dims) {
+                image_region result {{1, 1, 1}};
+                for (size_t i = 0; i < Dims && i < dims.size(); ++i) {
+                    result[i] = dims[i];
+                }
+                return result;
+            }
+
+            /// Returns a description of an image with `Dims` dimensions.
+            template<size_t Dims>
+            cl_image_desc make_image_desc(const image_region &extent) {
+                static_assert(Dims >= 1 && Dims <= 3, "Images have one to three dimensions.");
+                cl_image_desc desc;
+                std::memset(&desc, 0, sizeof(desc));
+                desc.image_type =
+                    Dims == 1 ? CL_MEM_OBJECT_IMAGE1D : (Dims == 2 ? CL_MEM_OBJECT_IMAGE2D : CL_MEM_OBJECT_IMAGE3D);
+                desc.image_width = extent[0];
+                desc.image_height = Dims > 1 ? extent[1] : 0;
+                desc.image_depth = Dims > 2 ? extent[2] : 0;
+                return desc;
+            }
+
+            /// A reference type for images on an OpenCL device. Each element of type `T`
+            /// holds one pixel, i.e., its size must match the channel format. Access is
+            /// not thread safe. Hence, an image_ref should only be passed to actors
+            /// sequentially.
+            template<class T, size_t Dims = 2>
+            class image_ref : ref_tag {
+            public:
+                static_assert(Dims >= 1 && Dims <= 3, "Images have one to three dimensions.");
+
+                using value_type = T;
+
+                static constexpr size_t dimensions = Dims;
+
+                friend struct msg_adding_event;
+
+                template<bool PassConfig, class... Ts>
+                friend class actor_facade;
+
+                friend class device;
+
+                /// Reads the whole image.
+                expected<std::vector<T>> data() {
+                    return read_rect(image_region {{0, 0, 0}}, extent_);
+                }
+
+                /// Reads the pixels in the box starting at `origin` with size `region`
+                /// into a tightly packed vector.
+                expected<std::vector<T>> read_rect(const image_region &origin, const image_region &region) {
+                    if (!memory_) {
+                        return make_error(sec::runtime_error, "No memory assigned.");
+                    }
+                    if (0 != (access_ & CL_MEM_HOST_NO_ACCESS) || 0 != (access_ & CL_MEM_HOST_WRITE_ONLY)) {
+                        return make_error(sec::runtime_error, "No memory access.");
+                    }
+                    if (!contains(origin, region)) {
+                        return make_error(sec::runtime_error, "Region exceeds the image.");
+                    }
+                    std::vector<T> buffer(region[0] * region[1] * region[2]);
+                    std::vector<cl_event> prev_events;
+                    if (event_) {
+                        prev_events.push_back(event_.get());
+                    }
+                    cl_event event;
+                    auto err = clEnqueueReadImage(queue_.get(), memory_.get(), CL_TRUE, origin.data(), region.data(),
+                                                  0, 0, buffer.data(), static_cast<cl_uint>(prev_events.size()),
+                                                  prev_events.data(), &event);
+                    if (err != CL_SUCCESS) {
+                        return make_error(sec::runtime_error, opencl_error(err));
+                    }
+                    event_.reset(event, false);
+                    return buffer;
+                }
+
+                /// Writes the tightly packed pixels in `data` to the box starting at
+                /// `origin` with size `region`. Blocks until the transfer finished.
+                error write_rect(const image_region &origin, const image_region &region, const std::vector<T> &data) {
+                    if (!memory_) {
+                        return make_error(sec::runtime_error, "No memory assigned.");
+                    }
+                    if (0 != (access_ & CL_MEM_HOST_NO_ACCESS) || 0 != (access_ & CL_MEM_HOST_READ_ONLY)) {
+                        return make_error(sec::runtime_error, "No memory access.");
+                    }
+                    if (!contains(origin, region) || data.size() < region[0] * region[1] * region[2]) {
+                        return make_error(sec::runtime_error, "Region exceeds the image or the data.");
+                    }
+                    std::vector<cl_event> prev_events;
+                    if (event_) {
+                        prev_events.push_back(event_.get());
+                    }
+                    cl_event event;
+                    auto err = clEnqueueWriteImage(queue_.get(), memory_.get(), CL_TRUE, origin.data(), region.data(),
+                                                   0, 0, data.data(), static_cast<cl_uint>(prev_events.size()),
+                                                   prev_events.data(), &event);
+                    if (err != CL_SUCCESS) {
+                        return make_error(sec::runtime_error, opencl_error(err));
+                    }
+                    event_.reset(event, false);
+                    return none;
+                }
+
+                void reset() {
+                    extent_ = image_region {{0, 0, 0}};
+                    access_ = 0;
+                    memory_.reset();
+                    event_.reset();
+                }
+
+                inline const detail::raw_mem_ptr &get() const {
+                    return memory_;
+                }
+
+                /// Returns the number of pixels.
+                inline size_t size() const {
+                    return extent_[0] * extent_[1] * extent_[2];
+                }
+
+                inline const image_region &extent() const {
+                    return extent_;
+                }
+
+                inline const cl_image_format &format() const {
+                    return format_;
+                }
+
+                inline cl_mem_flags access() const {
+                    return access_;
+                }
+
+                image_ref() : extent_ {{0, 0, 0}}, format_(make_image_format()), access_ {CL_MEM_HOST_NO_ACCESS} {
+                    // nop
+                }
+
+                image_ref(image_region extent, cl_image_format format, detail::raw_command_queue_ptr queue,
+                          detail::raw_mem_ptr memory, cl_mem_flags access, detail::raw_event_ptr event) :
+                    extent_(extent),
+                    format_(format), access_ {access}, queue_ {std::move(queue)}, event_ {std::move(event)},
+                    memory_ {std::move(memory)} {
+                    // nop
+                }
+
+                image_ref(image_ref &&other) = default;
+
+                image_ref(const image_ref &other) = default;
+
+                image_ref &operator=(image_ref &&other) = default;
+
+                image_ref &operator=(const image_ref &other) = default;
+
+            private:
+                bool contains(const image_region &origin, const image_region &region) const {
+                    for (size_t i = 0; i < 3; ++i) {
+                        if (origin[i] + region[i] > extent_[i]) {
+                            return false;
+                        }
+                    }
+                    return true;
+                }
+
+                inline void set_event(detail::raw_event_ptr e) {
+                    event_ = std::move(e);
+                }
+
+                inline cl_event take_event() {
+                    return event_.detach();
+                }
+
+                image_region extent_;
+                cl_image_format format_;
+                cl_mem_flags access_;
+                detail::raw_command_queue_ptr queue_;
+                detail::raw_event_ptr event_;
+                detail::raw_mem_ptr memory_;
+            };
+
+        }    // namespace cuda
+
+        template<class T, size_t Dims>
+        struct allowed_unsafe_message_type<opencl::image_ref<T, Dims>> : std::true_type {};
+
+    }    // namespace actor
+}    // namespace nil
@@ -0,0 +1,74 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/device.hpp>
+#include <nil/actor/cuda/nd_range.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// Resource usage of a compiled kernel on a device.
+            struct kernel_info {
+                /// CL_KERNEL_WORK_GROUP_SIZE, the largest work-group the kernel can run
+                /// with on the device.
+                size_t work_group_size;
+                /// CL_KERNEL_COMPILE_WORK_GROUP_SIZE, all zeros unless the kernel sets
+                /// `reqd_work_group_size`.
+                dim_vec compile_work_group_size;
+                /// CL_KERNEL_LOCAL_MEM_SIZE, local memory used by the kernel in bytes,
+                /// including `local` arguments set so far.
+                cl_ulong local_mem_size;
+                /// CL_KERNEL_PRIVATE_MEM_SIZE, private memory used per work item in
+                /// bytes.
+                cl_ulong private_mem_size;
+                /// CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, e.g., the warp or
+                /// wavefront size.
+                size_t preferred_work_group_size_multiple;
+
+                /// Queries the info of `kernel` on `device_id`.
+                /// @throws std::runtime_error if a query fails.
+                static kernel_info query(cl_kernel kernel, cl_device_id device_id);
+            };
+
+            /// Estimated occupancy of a kernel launched with an `nd_range`.
+            struct occupancy_estimate {
+                /// Whether the work-group size fits the limits of kernel and device.
+                bool fits;
+                /// Share of the SIMD lanes of the compute units kept busy by the launch,
+                /// between 0 and 1. Counts the lanes lost to work-groups that are not a
+                /// multiple of the preferred size and the compute units left idle by too
+                /// few work-groups. Is 1 if the runtime picks the work-group size.
+                double occupancy;
+                /// Human readable descriptions of all limits exceeded and of the causes
+                /// of poor occupancy.
+                std::vector<std::string> issues;
+            };
+
+            /// Occupancy below this share is reported as poor.
+            constexpr double poor_occupancy = 0.5;
+
+            /// Estimates the occupancy of launching a kernel described by `info` on
+            /// `dev` with `range`.
+            occupancy_estimate estimate_occupancy(const kernel_info &info, const device &dev, const nd_range &range);
+
+            /// Logs a warning for each issue of launching the kernel `kernel_name`
+            /// with `range` and returns the estimate.
+            occupancy_estimate check_occupancy(const char *kernel_name, const kernel_info &info, const device &dev,
+                                               const nd_range &range);
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
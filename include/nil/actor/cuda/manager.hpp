@@ -9,8 +9,14 @@
 
 #pragma once
 
+#include <map>
+#include <deque>
+#include <mutex>
 #include <atomic>
+#include <memory>
+#include <string>
 #include <vector>
+#include <utility>
 #include <algorithm>
 #include <functional>
 
@@ -21,11 +27,23 @@
 #include <nil/actor/detail/raw_ptr.hpp>
 #include <nil/actor/detail/spawn_helper.hpp>
 
+#include <nil/actor/cuda/ntt.hpp>
+#include <nil/actor/cuda/msm.hpp>
+#include <nil/actor/cuda/field.hpp>
 #include <nil/actor/cuda/device.hpp>
+#include <nil/actor/cuda/merkle.hpp>
 #include <nil/actor/cuda/global.hpp>
 #include <nil/actor/cuda/program.hpp>
 #include <nil/actor/cuda/platform.hpp>
+#include <nil/actor/cuda/primitives.hpp>
+#include <nil/actor/cuda/elementwise.hpp>
+#include <nil/actor/cuda/host_facade.hpp>
 #include <nil/actor/cuda/actor_facade.hpp>
+#include <nil/actor/cuda/stream_facade.hpp>
+#include <nil/actor/cuda/chunk_scheduler.hpp>
+#include <nil/actor/cuda/persistent_kernel.hpp>
+#include <nil/actor/cuda/persistent_facade.hpp>
+#include <nil/actor/cuda/completion_executor.hpp>
 
 namespace nil {
     namespace actor {
@@ -72,6 +90,19 @@ namespace nil {
 
                 static spawner_module *make(spawner &sys, detail::type_list<>);
 
+                /// Returns a snapshot of the counters and gauges of all devices, e.g.,
+                /// for capacity planning. Rates follow from two consecutive snapshots.
+                metrics_snapshot metrics() const;
+
+                /// Returns the tracer recording the commands of all devices or `nullptr`
+                /// if neither `opencl.trace-capacity` nor `opencl.trace-file` is set.
+                /// The trace is written to `opencl.trace-file`, if set, on `stop()`.
+                tracer *trace() const;
+
+                /// Writes the spans recorded so far in the Chrome trace format.
+                /// @returns `false` if tracing is disabled.
+                bool write_trace(std::ostream &out) const;
+
                 // OpenCL functionality
 
                 /// @brief Factory method, that creates a nil::actor::opencl::program
@@ -234,14 +265,643 @@ namespace nil {
                              std::move(map_args), std::forward<T>(x), std::forward<Ts>(xs)...);
                 }
 
+                // --- Streaming of messages through rotating buffer sets ---
+
+                /// Creates a new streaming actor for an OpenCL kernel that invokes the
+                /// function named `fname` from `prog`. The actor rotates over `depth`
+                /// buffer sets to overlap transfers of consecutive messages with the
+                /// kernel execution and replies in the order of the received messages.
+                /// @throws std::runtime_error if `dims.empty()`, `depth < 2`, or
+                ///                            `clCreateKernel` failed.
+                template<class T, class... Ts>
+                typename std::enable_if<opencl::is_opencl_arg<T>::value, actor>::type
+                    spawn_stream(const opencl::program_ptr prog, const char *fname, const opencl::nd_range &range,
+                                 size_t depth, T &&x, Ts &&... xs) {
+                    using impl = stream_facade<detail::decay_t<T>, detail::decay_t<Ts>...>;
+                    return impl::create(actor_config {system_.dummy_execution_unit()}, prog, fname, range, depth,
+                                        detail::decay_t<T>(std::forward<T>(x)),
+                                        detail::decay_t<Ts>(std::forward<Ts>(xs))...);
+                }
+
+                // --- Host kernels for nodes without OpenCL devices ---
+
+                /// Registers `fun` as the host kernel named `name`, replacing a previous
+                /// registration. Host kernels run on `opencl.host-threads` threads.
+                void add_host_kernel(const std::string &name, host_kernel fun);
+
+                /// Creates an actor that runs the host kernel named `fname` with the
+                /// signature of an actor facade. The actor accepts and replies with the
+                /// same messages as `spawn` for the same arguments.
+                /// @throws std::runtime_error if no host kernel named `fname` exists.
+                template<class T, class... Ts>
+                typename std::enable_if<opencl::is_opencl_arg<T>::value, actor>::type
+                    spawn_host(const char *fname, const opencl::nd_range &range, T &&x, Ts &&... xs) {
+                    using impl = host_facade<detail::decay_t<T>, detail::decay_t<Ts>...>;
+                    return impl::create(actor_config {system_.dummy_execution_unit()}, find_host_kernel(fname),
+                                        host_executor(), range, nullptr, detail::decay_t<T>(std::forward<T>(x)),
+                                        detail::decay_t<Ts>(std::forward<Ts>(xs))...);
+                }
+
+                /// Creates an actor that runs the host kernel named `fname` and adapts
+                /// the range and the message with `map_args` first, like `spawn`.
+                /// @throws std::runtime_error if no host kernel named `fname` exists.
+                template<class T, class... Ts>
+                typename std::enable_if<opencl::is_opencl_arg<T>::value, actor>::type
+                    spawn_host(const char *fname, const opencl::nd_range &range,
+                               std::function<optional<message>(nd_range &, message &)> map_args, T &&x, Ts &&... xs) {
+                    using impl = host_facade<detail::decay_t<T>, detail::decay_t<Ts>...>;
+                    return impl::create(actor_config {system_.dummy_execution_unit()}, find_host_kernel(fname),
+                                        host_executor(), range, std::move(map_args),
+                                        detail::decay_t<T>(std::forward<T>(x)),
+                                        detail::decay_t<Ts>(std::forward<Ts>(xs))...);
+                }
+
+                /// Compiles `source` and creates an actor facade for the kernel `fname`
+                /// on the first device or, if the node has no device, an actor for the
+                /// host kernel registered under the same name.
+                template<class T, class... Ts>
+                typename std::enable_if<opencl::is_opencl_arg<T>::value, actor>::type
+                    spawn_auto(const char *source, const char *fname, const opencl::nd_range &range, T &&x,
+                               Ts &&... xs) {
+                    if (find_device(0)) {
+                        return spawn(source, fname, range, std::forward<T>(x), std::forward<Ts>(xs)...);
+                    }
+                    return spawn_host(fname, range, std::forward<T>(x), std::forward<Ts>(xs)...);
+                }
+
+                // --- Co-scheduling across devices ---
+
+                /// Creates an actor that splits each `std::vector<In>` into chunks for
+                /// `workers` with a `chunk_scheduler` and replies with the concatenated
+                /// `std::vector<Out>`. Each worker must reply to a chunk with one output
+                /// per input, e.g., actor facades for the same kernel on a GPU and a CPU
+                /// device or a host actor. `weights` hold the relative speeds of the
+                /// workers until measured, equal by default. Messages are processed one
+                /// after another.
+                /// @throws std::runtime_error if `workers` is empty or `weights` does
+                ///                            not hold one element per worker.
+                template<class In, class Out = In>
+                actor spawn_balanced(std::vector<actor> workers, std::vector<double> weights = {},
+                                     size_t min_chunk = 1024) {
+                    if (workers.empty()) {
+                        ACTOR_RAISE_ERROR("spawn_balanced requires at least one worker");
+                    }
+                    if (weights.empty()) {
+                        weights.assign(workers.size(), 1.0);
+                    }
+                    if (weights.size() != workers.size()) {
+                        ACTOR_RAISE_ERROR("spawn_balanced requires one weight per worker");
+                    }
+                    using in_vec = std::vector<In>;
+                    using out_vec = std::vector<Out>;
+                    struct job {
+                        response_promise promise;
+                        in_vec input;
+                        out_vec output;
+                    };
+                    struct state {
+                        chunk_scheduler scheduler;
+                        std::vector<bool> busy;
+                        // the front job is the one in progress
+                        std::deque<job> jobs;
+                    };
+                    return system_.spawn([=](event_based_actor *self) -> behavior {
+                        auto st = std::make_shared<state>(
+                            state {chunk_scheduler {weights, min_chunk}, std::vector<bool>(workers.size()), {}});
+                        auto start = [=] {
+                            while (!st->jobs.empty()) {
+                                auto &front = st->jobs.front();
+                                st->scheduler.reset(front.input.size());
+                                if (!st->scheduler.done()) {
+                                    front.output.resize(front.input.size());
+                                    return;
+                                }
+                                front.promise.deliver(out_vec {});
+                                st->jobs.pop_front();
+                            }
+                            // ignores chunks still running for the last job
+                            st->scheduler.reset(0);
+                        };
+                        auto finish = [=](out_vec result) {
+                            st->jobs.front().promise.deliver(std::move(result));
+                            st->jobs.pop_front();
+                            start();
+                        };
+                        auto fail = [=](error err) {
+                            st->jobs.front().promise.deliver(std::move(err));
+                            st->jobs.pop_front();
+                            start();
+                        };
+                        // hands chunks to idle workers, the behavior owns it
+                        auto assign = std::make_shared<std::function<void()>>();
+                        auto assign_ptr = assign.get();
+                        *assign = [=] {
+                            for (size_t w = 0; w < workers.size() && !st->jobs.empty(); ++w) {
+                                if (st->busy[w]) {
+                                    continue;
+                                }
+                                auto next = st->scheduler.next(w, chunk_scheduler::clock::now());
+                                if (!next) {
+                                    continue;
+                                }
+                                auto id = next->id;
+                                auto first = next->first;
+                                auto count = next->count;
+                                auto &input = st->jobs.front().input;
+                                in_vec part(input.begin() + first, input.begin() + first + count);
+                                st->busy[w] = true;
+                                self->request(workers[w], infinite, std::move(part))
+                                    .then(
+                                        [=](out_vec &result) {
+                                            st->busy[w] = false;
+                                            if (st->scheduler.complete(w, id, chunk_scheduler::clock::now())) {
+                                                if (result.size() != count) {
+                                                    fail(make_error(sec::invalid_argument));
+                                                } else {
+                                                    auto &output = st->jobs.front().output;
+                                                    std::move(result.begin(), result.end(), output.begin() + first);
+                                                    if (st->scheduler.done()) {
+                                                        finish(std::move(output));
+                                                    }
+                                                }
+                                            }
+                                            (*assign_ptr)();
+                                        },
+                                        [=](error &err) {
+                                            st->busy[w] = false;
+                                            if (st->scheduler.complete(w, id, chunk_scheduler::clock::now())) {
+                                                fail(std::move(err));
+                                            }
+                                            (*assign_ptr)();
+                                        });
+                            }
+                        };
+                        return {
+                            [=](in_vec &input) {
+                                auto promise = self->make_response_promise();
+                                st->jobs.push_back(job {promise, std::move(input), {}});
+                                if (st->jobs.size() == 1) {
+                                    start();
+                                    (*assign)();
+                                }
+                                return promise;
+                            },
+                        };
+                    });
+                }
+
+                // --- Persistent kernels for low-latency requests ---
+
+                /// Launches the kernel named `fname` from `prog` once and creates an actor
+                /// that forwards each `In` to it through a ring buffer with `capacity`
+                /// slots. The kernel must be defined with `ACTOR_PERSISTENT_KERNEL` from
+                /// `persistent_kernel_prelude`. The kernel runs until the manager stops.
+                /// A capacity with many small divisors, e.g., a power of two, lets more
+                /// work items serve the ring.
+                /// @throws std::runtime_error if the device lacks fine-grained SVM with
+                ///                            atomics or `clCreateKernel` failed.
+                template<class In, class Out>
+                actor spawn_persistent(const opencl::program_ptr prog, const char *fname, size_t capacity = 64) {
+                    using impl = persistent_facade<In, Out>;
+                    auto kernel = create_persistent_kernel(prog, fname, capacity, sizeof(In), sizeof(Out),
+                                                           &impl::deliver);
+                    return impl::create(actor_config {system_.dummy_execution_unit()}, std::move(kernel));
+                }
+
+                // --- Parallel primitives ---
+
+                /// Creates an actor that reduces a `std::vector<T>` with `op` and replies
+                /// with a single `T`.
+                template<class T>
+                actor spawn_reduce(const device_ptr &dev, const primitive_op &op = sum_op()) {
+                    auto prog = create_primitives_program(dev, primitive_type<T>::name(), op, "", false);
+                    auto group = primitives_group_size(*dev, sizeof(T));
+                    auto chunks = spawn(
+                        prog, "actor_reduce", primitives_range(1, group),
+                        [group](nd_range &range, message &msg) -> optional<message> {
+                            return msg.apply([&](std::vector<T> &xs) {
+                                auto len = static_cast<cl_uint>(xs.size());
+                                range = primitives_range(primitives_num_groups(len, group), group);
+                                return make_message(std::move(xs), len);
+                            });
+                        },
+                        in<T> {},
+                        make_out<T, mref>([group](const std::vector<T> &, cl_uint len) {
+                            return primitives_num_groups(len, group);
+                        }),
+                        local<T> {group}, priv<cl_uint, val> {});
+                    auto total = spawn(
+                        prog, "actor_reduce", primitives_range(1, group),
+                        [](message &msg) -> optional<message> {
+                            return msg.apply([&](mem_ref<T> &partials) {
+                                auto len = static_cast<cl_uint>(partials.size());
+                                return make_message(std::move(partials), len);
+                            });
+                        },
+                        [](std::vector<T> &result) { return make_message(result.front()); }, in<T, mref> {},
+                        make_out<T>([](const mem_ref<T> &, cl_uint) { return size_t {1}; }), local<T> {group},
+                        priv<cl_uint, val> {});
+                    return total * chunks;
+                }
+
+                /// Creates an actor that computes the inclusive or exclusive scan of a
+                /// `std::vector<T>` with `op` and replies with a vector of equal length.
+                template<class T>
+                actor spawn_scan(const device_ptr &dev, const primitive_op &op = sum_op(), bool exclusive = false) {
+                    auto prog = create_primitives_program(dev, primitive_type<T>::name(), op, "", exclusive);
+                    auto group = primitives_group_size(*dev, sizeof(T));
+                    auto reduce = spawn(
+                        prog, "actor_reduce", primitives_range(1, group),
+                        [group](nd_range &range, message &msg) -> optional<message> {
+                            return msg.apply([&](std::vector<T> &xs) {
+                                auto len = static_cast<cl_uint>(xs.size());
+                                range = primitives_range(primitives_num_groups(len, group), group);
+                                return make_message(std::move(xs), len);
+                            });
+                        },
+                        in_out<T, val, mref> {},
+                        make_out<T, mref>([group](const std::vector<T> &, cl_uint len) {
+                            return primitives_num_groups(len, group);
+                        }),
+                        local<T> {group}, priv<cl_uint, val> {});
+                    auto partials = spawn(
+                        prog, "actor_scan_partials", primitives_range(1, group),
+                        [](message &msg) -> optional<message> {
+                            return msg.apply([&](mem_ref<T> &data, mem_ref<T> &xs) {
+                                auto len = static_cast<cl_uint>(xs.size());
+                                return make_message(std::move(data), std::move(xs), len);
+                            });
+                        },
+                        in_out<T, mref, mref> {}, in_out<T, mref, mref> {}, local<T> {group}, priv<cl_uint, val> {});
+                    auto chunks = spawn(
+                        prog, "actor_scan_chunks", primitives_range(1, group),
+                        [group](nd_range &range, message &msg) -> optional<message> {
+                            return msg.apply([&](mem_ref<T> &data, mem_ref<T> &xs) {
+                                auto len = static_cast<cl_uint>(data.size());
+                                range = primitives_range(xs.size(), group);
+                                return make_message(std::move(data), std::move(xs), len);
+                            });
+                        },
+                        in_out<T, mref, val> {}, in<T, mref> {}, local<T> {group}, priv<cl_uint, val> {});
+                    return chunks * partials * reduce;
+                }
+
+                /// Creates an actor that keeps the elements of a `std::vector<T>` for
+                /// which the OpenCL C expression `predicate` over the element `x` holds,
+                /// e.g., `"x > 0"`, and replies with them in their original order.
+                template<class T>
+                actor spawn_compact(const device_ptr &dev, const std::string &predicate) {
+                    auto prog = create_primitives_program(dev, primitive_type<T>::name(), sum_op(), predicate, false);
+                    auto group = primitives_group_size(*dev, sizeof(T));
+                    auto count = spawn(
+                        prog, "actor_count", primitives_range(1, group),
+                        [group](nd_range &range, message &msg) -> optional<message> {
+                            return msg.apply([&](std::vector<T> &xs) {
+                                auto len = static_cast<cl_uint>(xs.size());
+                                range = primitives_range(primitives_num_groups(len, group), group);
+                                return make_message(std::move(xs), len);
+                            });
+                        },
+                        in_out<T, val, mref> {},
+                        make_out<cl_uint, mref>([group](const std::vector<T> &, cl_uint len) {
+                            return primitives_num_groups(len, group) + 1;
+                        }),
+                        local<cl_uint> {group}, priv<cl_uint, val> {});
+                    auto offsets = spawn(
+                        prog, "actor_scan_counts", primitives_range(1, group),
+                        [](message &msg) -> optional<message> {
+                            return msg.apply([&](mem_ref<T> &data, mem_ref<cl_uint> &counts) {
+                                auto len = static_cast<cl_uint>(counts.size() - 1);
+                                return make_message(std::move(data), std::move(counts), len);
+                            });
+                        },
+                        in_out<T, mref, mref> {}, in_out<cl_uint, mref, mref> {}, local<cl_uint> {group},
+                        priv<cl_uint, val> {});
+                    auto scatter = spawn(
+                        prog, "actor_compact", primitives_range(1, group),
+                        [group](nd_range &range, message &msg) -> optional<message> {
+                            return msg.apply([&](mem_ref<T> &data, mem_ref<cl_uint> &counts) {
+                                auto len = static_cast<cl_uint>(data.size());
+                                range = primitives_range(counts.size() - 1, group);
+                                return make_message(std::move(data), std::move(counts), len);
+                            });
+                        },
+                        [](std::vector<cl_uint> &counts, std::vector<T> &result) {
+                            result.resize(counts.back());
+                            return make_message(std::move(result));
+                        },
+                        in<T, mref> {}, in_out<cl_uint, mref, val> {},
+                        make_out<T>([](const mem_ref<T> &data, const mem_ref<cl_uint> &, cl_uint) {
+                            return data.size();
+                        }),
+                        local<cl_uint> {group}, priv<cl_uint, val> {});
+                    return scatter * offsets * count;
+                }
+
+                /// Creates an actor that sorts a `std::vector<T>` of unsigned integers in
+                /// ascending order with a stable radix sort.
+                template<class T>
+                actor spawn_sort(const device_ptr &dev) {
+                    static_assert(std::is_unsigned<T>::value, "The radix sort only supports unsigned keys.");
+                    auto prog = create_primitives_program(dev, primitive_type<T>::name(), sum_op(), "", false);
+                    auto group = primitives_group_size(*dev, sizeof(T));
+                    auto with_len = [group](nd_range &range, message &msg) -> optional<message> {
+                        auto len = static_cast<cl_uint>(msg.match_element<std::vector<T>>(0) ?
+                                                            msg.get_as<std::vector<T>>(0).size() :
+                                                            msg.get_as<mem_ref<T>>(0).size());
+                        range = primitives_range(primitives_num_groups(len, group), group);
+                        return message::concat(msg, make_message(len));
+                    };
+                    auto num_counts = [group](size_t len) {
+                        return radix_digits * primitives_num_groups(len, group) + 1;
+                    };
+                    auto size_of = [](const mem_ref<T> &keys, const mem_ref<cl_uint> &, cl_uint) {
+                        return keys.size();
+                    };
+                    constexpr size_t num_passes = sizeof(T) * 8 / radix_bits;
+                    std::vector<actor> passes;
+                    for (size_t pass = 0; pass < num_passes; ++pass) {
+                        auto shift = static_cast<cl_uint>(pass * radix_bits);
+                        auto range = primitives_range(1, group);
+                        // the first pass uploads the keys, the last pass reads them back
+                        auto count =
+                            pass == 0 ?
+                                spawn(prog, "actor_radix_count", range, with_len, in_out<T, val, mref> {},
+                                      make_out<cl_uint, mref>([num_counts](const std::vector<T> &, cl_uint len) {
+                                          return num_counts(len);
+                                      }),
+                                      local<cl_uint> {radix_digits}, priv<cl_uint, val> {}, priv<cl_uint> {shift}) :
+                                spawn(prog, "actor_radix_count", range, with_len, in_out<T, mref, mref> {},
+                                      make_out<cl_uint, mref>([num_counts](const mem_ref<T> &, cl_uint len) {
+                                          return num_counts(len);
+                                      }),
+                                      local<cl_uint> {radix_digits}, priv<cl_uint, val> {}, priv<cl_uint> {shift});
+                        auto offsets = spawn(
+                            prog, "actor_scan_counts", range,
+                            [](message &msg) -> optional<message> {
+                                return msg.apply([&](mem_ref<T> &keys, mem_ref<cl_uint> &counts) {
+                                    auto len = static_cast<cl_uint>(counts.size() - 1);
+                                    return make_message(std::move(keys), std::move(counts), len);
+                                });
+                            },
+                            in_out<T, mref, mref> {}, in_out<cl_uint, mref, mref> {}, local<cl_uint> {group},
+                            priv<cl_uint, val> {});
+                        auto scatter =
+                            pass + 1 == num_passes ?
+                                spawn(prog, "actor_radix_scatter", range, with_len, in<T, mref> {},
+                                      in<cl_uint, mref> {}, make_out<T>(size_of), local<cl_uint> {group},
+                                      priv<cl_uint, val> {}, priv<cl_uint> {shift}) :
+                                spawn(prog, "actor_radix_scatter", range, with_len, in<T, mref> {},
+                                      in<cl_uint, mref> {}, make_out<T, mref>(size_of), local<cl_uint> {group},
+                                      priv<cl_uint, val> {}, priv<cl_uint> {shift});
+                        passes.push_back(scatter * offsets * count);
+                    }
+                    auto result = passes.front();
+                    for (size_t i = 1; i < passes.size(); ++i) {
+                        result = passes[i] * result;
+                    }
+                    return result;
+                }
+
+                /// Creates an actor that reduces each segment of a `std::vector<T>` with
+                /// `op`. The second element of the message is a `std::vector<cl_uint>`
+                /// holding the first index of each segment followed by the length of
+                /// the input. The actor replies with one value per segment and ignores
+                /// messages whose offsets decrease or do not end at the input length.
+                template<class T>
+                actor spawn_segmented_reduce(const device_ptr &dev, const primitive_op &op = sum_op()) {
+                    auto prog = create_primitives_program(dev, primitive_type<T>::name(), op, "", false);
+                    auto group = primitives_group_size(*dev, sizeof(T));
+                    return spawn(
+                        prog, "actor_segmented_reduce", primitives_range(1, group),
+                        [group](nd_range &range, message &msg) -> optional<message> {
+                            if (!msg.match_elements<std::vector<T>, std::vector<cl_uint>>()) {
+                                return none;
+                            }
+                            auto &offsets = msg.get_as<std::vector<cl_uint>>(1);
+                            if (offsets.size() < 2 || offsets.back() != msg.get_as<std::vector<T>>(0).size()
+                                || !std::is_sorted(offsets.begin(), offsets.end())) {
+                                return none;
+                            }
+                            range = primitives_range(offsets.size() - 1, group);
+                            return msg;
+                        },
+                        in<T> {}, in<cl_uint> {},
+                        make_out<T>([](const std::vector<T> &, const std::vector<cl_uint> &offsets) {
+                            return offsets.size() - 1;
+                        }),
+                        local<T> {group});
+                }
+
+                /// Creates an actor that scans each segment of a `std::vector<T>` with
+                /// `op`. The segments are passed as for `spawn_segmented_reduce`.
+                template<class T>
+                actor spawn_segmented_scan(const device_ptr &dev, const primitive_op &op = sum_op(),
+                                           bool exclusive = false) {
+                    auto prog = create_primitives_program(dev, primitive_type<T>::name(), op, "", exclusive);
+                    auto group = primitives_group_size(*dev, sizeof(T));
+                    return spawn(
+                        prog, "actor_segmented_scan", primitives_range(1, group),
+                        [group](nd_range &range, message &msg) -> optional<message> {
+                            if (!msg.match_elements<std::vector<T>, std::vector<cl_uint>>()) {
+                                return none;
+                            }
+                            auto &offsets = msg.get_as<std::vector<cl_uint>>(1);
+                            if (offsets.size() < 2 || offsets.back() != msg.get_as<std::vector<T>>(0).size()
+                                || !std::is_sorted(offsets.begin(), offsets.end())) {
+                                return none;
+                            }
+                            range = primitives_range(offsets.size() - 1, group);
+                            return msg;
+                        },
+                        in_out<T> {}, in<cl_uint> {}, local<T> {group});
+                }
+
+                // --- Elementwise chains ---
+
+                /// Creates an actor that applies `ops` in order to each element of a
+                /// `std::vector<T>` or `mem_ref<T>`, depending on `Tag`, and replies with
+                /// the result in the same form. All steps run in one kernel and the
+                /// program for a chain is built once per device.
+                template<class T, class Tag = val>
+                actor spawn_elementwise(const device_ptr &dev, const std::vector<elementwise_op> &ops) {
+                    auto prog = create_elementwise_program(dev, primitive_type<T>::name(), ops);
+                    auto group = elementwise_group_size(*dev);
+                    auto with_range = [group](nd_range &range, message &msg) -> optional<message> {
+                        size_t len = 0;
+                        if (msg.match_elements<std::vector<T>>()) {
+                            len = msg.get_as<std::vector<T>>(0).size();
+                        } else if (msg.match_elements<mem_ref<T>>()) {
+                            len = msg.get_as<mem_ref<T>>(0).size();
+                        }
+                        if (len == 0) {
+                            return none;
+                        }
+                        range = nd_range::padded(dim_vec {len}, dim_vec {group});
+                        return msg;
+                    };
+                    return spawn(prog, "actor_elementwise", nd_range::padded(dim_vec {1}, dim_vec {group}), with_range,
+                                 in_out<T, Tag, Tag> {}, real_size<cl_uint> {});
+                }
+
+                // --- Number-theoretic transform ---
+
+                /// Creates an actor that transforms a `std::vector<cl_uint>` or
+                /// `mem_ref<cl_uint>`, depending on `Tag`, holding `2^log_size` elements
+                /// of `field` in Montgomery form and replies with the transformed
+                /// elements in natural order and in the same form. The twiddles are
+                /// computed once and stay on `dev` for the lifetime of the actor.
+                /// @throws std::runtime_error if `log_size` is 0 or exceeds the
+                ///                            two-adicity of `field`.
+                template<class Tag = val>
+                actor spawn_ntt(const device_ptr &dev, const ntt_field &field, size_t log_size, bool inverse = false) {
+                    using input_type = typename extract_input_type<in<cl_uint, Tag>>::type;
+                    auto twiddles = dev->global_argument(ntt_twiddles(field, log_size, inverse), buffer_type::input,
+                                                         none, CL_TRUE);
+                    auto prog = create_ntt_program(dev, field);
+                    auto limbs = field.limbs();
+                    auto n = size_t {1} << log_size;
+                    auto block = ntt_block_size(*dev, field, n);
+                    auto log_n = static_cast<cl_uint>(log_size);
+                    auto with_twiddles = [twiddles](message &msg) -> optional<message> {
+                        return message::concat(msg, make_message(twiddles));
+                    };
+                    // the first stage reorders the input and runs all stages that fit
+                    // into a block, the remaining stages combine two blocks at a time
+                    std::vector<actor> stages;
+                    auto local_range = nd_range {dim_vec {n / 2}, {}, dim_vec {block / 2}};
+                    auto first = [=](message &msg) -> optional<message> {
+                        if (!msg.match_elements<input_type>() || msg.get_as<input_type>(0).size() != n * limbs) {
+                            return none;
+                        }
+                        return message::concat(msg, make_message(twiddles));
+                    };
+                    auto input_size = [](const input_type &data, const mem_ref<cl_uint> &) { return data.size(); };
+                    auto log_block = size_t {0};
+                    while ((size_t {1} << log_block) < block) {
+                        ++log_block;
+                    }
+                    auto last = log_block == log_size && !inverse;
+                    stages.push_back(last ? spawn(prog, "actor_ntt_local", local_range, first, in<cl_uint, Tag> {},
+                                                  in<cl_uint, mref> {}, make_out<cl_uint, Tag>(input_size),
+                                                  local<cl_uint> {block * limbs}, priv<cl_uint> {log_n}) :
+                                            spawn(prog, "actor_ntt_local", local_range, first, in<cl_uint, Tag> {},
+                                                  in<cl_uint, mref> {}, make_out<cl_uint, mref>(input_size),
+                                                  local<cl_uint> {block * limbs}, priv<cl_uint> {log_n}));
+                    for (auto stage = log_block; stage < log_size;) {
+                        auto radix4 = stage + 2 <= log_size;
+                        auto next = stage + (radix4 ? 2 : 1);
+                        auto range = nd_range {dim_vec {radix4 ? n / 4 : n / 2}};
+                        auto fname = radix4 ? "actor_ntt_radix4" : "actor_ntt_radix2";
+                        auto s = static_cast<cl_uint>(stage);
+                        last = next == log_size && !inverse;
+                        stages.push_back(last ? spawn(prog, fname, range, with_twiddles, in_out<cl_uint, mref, Tag> {},
+                                                      in<cl_uint, mref> {}, priv<cl_uint> {log_n}, priv<cl_uint> {s}) :
+                                                spawn(prog, fname, range, with_twiddles, in_out<cl_uint, mref, mref> {},
+                                                      in<cl_uint, mref> {}, priv<cl_uint> {log_n}, priv<cl_uint> {s}));
+                        stage = next;
+                    }
+                    if (inverse) {
+                        stages.push_back(spawn(prog, "actor_ntt_scale", nd_range {dim_vec {n}}, with_twiddles,
+                                               in_out<cl_uint, mref, Tag> {}, in<cl_uint, mref> {},
+                                               priv<cl_uint> {log_n}));
+                    }
+                    auto result = stages.front();
+                    for (size_t i = 1; i < stages.size(); ++i) {
+                        result = stages[i] * result;
+                    }
+                    return result;
+                }
+
+                /// Creates an actor that converts a `std::vector<cl_uint>` or
+                /// `mem_ref<cl_uint>`, depending on `Tag`, of elements of `field` into
+                /// Montgomery form or out of it and replies in the same form.
+                template<class Tag = val>
+                actor spawn_ntt_convert(const device_ptr &dev, const ntt_field &field, bool to_montgomery) {
+                    using input_type = typename extract_input_type<in<cl_uint, Tag>>::type;
+                    auto factor = dev->global_argument(ntt_conversion_factor(field, to_montgomery),
+                                                       buffer_type::input, none, CL_TRUE);
+                    auto prog = create_ntt_program(dev, field);
+                    auto limbs = field.limbs();
+                    return spawn(
+                        prog, "actor_ntt_convert", nd_range {dim_vec {1}},
+                        [=](nd_range &range, message &msg) -> optional<message> {
+                            if (!msg.match_elements<input_type>()) {
+                                return none;
+                            }
+                            auto len = msg.get_as<input_type>(0).size();
+                            if (len == 0 || len % limbs != 0) {
+                                return none;
+                            }
+                            range = nd_range {dim_vec {len / limbs}};
+                            return message::concat(msg, make_message(factor));
+                        },
+                        in_out<cl_uint, Tag, Tag> {}, in<cl_uint, mref> {});
+                }
+
+                // --- Multi-scalar multiplication ---
+
+                /// Creates an actor that computes the sum of s_i * P_i for a message of
+                /// two `std::vector<cl_uint>`, i.e., the affine points of `curve` and
+                /// their scalars, and replies with the affine result. Buckets and windows
+                /// are reduced on `dev` with Pippenger's algorithm. The window size is
+                /// chosen for `num_points` unless `window_bits` is set.
+                actor spawn_msm(const device_ptr &dev, const msm_curve &curve, size_t num_points,
+                                size_t window_bits = 0);
+
+                /// Creates an actor that splits the points of each MSM across `devs` in
+                /// proportion to their compute units and sums the partial results.
+                /// @throws std::runtime_error if `devs` is empty.
+                actor spawn_msm(const std::vector<device_ptr> &devs, const msm_curve &curve, size_t num_points);
+
+                // --- Merkle trees ---
+
+                /// Creates a `merkle_builder` on `dev` that hashes inner nodes with `hash`.
+                actor spawn_merkle(const device_ptr &dev, const merkle_hash &hash = sha256_merkle_hash());
+
             protected:
                 manager(spawner &sys);
 
                 ~manager() override;
 
             private:
+                program_ptr create_primitives_program(const device_ptr &dev, const char *type, const primitive_op &op,
+                                                      const std::string &predicate, bool exclusive);
+
+                /// Returns the cached program for `ops` on `dev` or builds it.
+                program_ptr create_elementwise_program(const device_ptr &dev, const char *type,
+                                                       const std::vector<elementwise_op> &ops);
+
+                program_ptr create_ntt_program(const device_ptr &dev, const ntt_field &field);
+
+                /// @throws std::runtime_error if no host kernel named `name` exists.
+                std::shared_ptr<const host_kernel> find_host_kernel(const std::string &name) const;
+
+                /// Returns the executor for host kernels, starting its threads on the
+                /// first call before the manager stops.
+                completion_executor &host_executor();
+
+                actor spawn_msm(const device_ptr &dev, const program_ptr &prog, const msm_curve &curve,
+                                size_t window_bits);
+
+                persistent_kernel_ptr create_persistent_kernel(const program_ptr &prog, const char *fname,
+                                                               size_t capacity, size_t input_size, size_t output_size,
+                                                               persistent_kernel::deliver_fun deliver);
+
                 spawner &system_;
+                // devices refer to the tracer, hence it outlives the platforms
+                std::unique_ptr<tracer> tracer_;
+                std::string trace_file_;
                 std::vector<platform_ptr> platforms_;
+                std::unique_ptr<completion_executor> executor_;
+                std::unique_ptr<completion_executor> host_executor_;
+                bool host_stopped_;
+                std::mutex persistent_mtx_;
+                std::vector<persistent_kernel_ptr> persistent_kernels_;
+                std::mutex elementwise_mtx_;
+                std::map<std::pair<unsigned, std::string>, program_ptr> elementwise_programs_;
+                mutable std::mutex host_mtx_;
+                std::map<std::string, std::shared_ptr<const host_kernel>> host_kernels_;
             };
 
         }    // namespace cuda
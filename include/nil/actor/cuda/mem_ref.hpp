@@ -18,6 +18,8 @@
 
 #include <nil/actor/detail/raw_ptr.hpp>
 
+#include <nil/actor/cuda/buffer_rect.hpp>
+
 namespace nil {
     namespace actor {
         namespace cuda {
@@ -27,6 +29,9 @@ namespace nil {
 
             class device;
 
+            template<class T, size_t Dims>
+            class image_ref;
+
             /// A reference type for buffers on a OpenCL devive. Access is not thread safe.
             /// Hence, a mem_ref should only be passed to actors sequentially.
             template<class T>
@@ -70,6 +75,132 @@ namespace nil {
                     return buffer;
                 }
 
+                /// Reads the box described by `rect` into a tightly packed vector.
+                expected<std::vector<T>> read_rect(const buffer_rect &rect) {
+                    if (!memory_) {
+                        return make_error(sec::runtime_error, "No memory assigned.");
+                    }
+                    if (0 != (access_ & CL_MEM_HOST_NO_ACCESS) || 0 != (access_ & CL_MEM_HOST_WRITE_ONLY)) {
+                        return make_error(sec::runtime_error, "No memory access.");
+                    }
+                    if (rect.extent() > num_elements_) {
+                        return make_error(sec::runtime_error, "Region exceeds the buffer.");
+                    }
+                    std::vector<T> buffer(rect.num_elements());
+                    auto packed = rect.packed();
+                    std::vector<cl_event> prev_events;
+                    if (event_) {
+                        prev_events.push_back(event_.get());
+                    }
+                    cl_event event;
+                    auto err = clEnqueueReadBufferRect(
+                        queue_.get(), memory_.get(), CL_TRUE, rect.origin_bytes<T>().data(),
+                        packed.origin_bytes<T>().data(), rect.region_bytes<T>().data(), rect.row_size() * sizeof(T),
+                        rect.slice_size() * sizeof(T), packed.row_size() * sizeof(T), packed.slice_size() * sizeof(T),
+                        buffer.data(), static_cast<cl_uint>(prev_events.size()), prev_events.data(), &event);
+                    if (err != CL_SUCCESS) {
+                        return make_error(sec::runtime_error, opencl_error(err));
+                    }
+                    event_.reset(event, false);
+                    return buffer;
+                }
+
+                /// Writes the box described by `host` from `data` to the box described
+                /// by `rect`. Both boxes must have the same region. Blocks until the
+                /// transfer finished.
+                error write_rect(const buffer_rect &rect, const std::vector<T> &data, const buffer_rect &host) {
+                    if (!memory_) {
+                        return make_error(sec::runtime_error, "No memory assigned.");
+                    }
+                    if (0 != (access_ & CL_MEM_HOST_NO_ACCESS) || 0 != (access_ & CL_MEM_HOST_READ_ONLY)) {
+                        return make_error(sec::runtime_error, "No memory access.");
+                    }
+                    if (rect.region != host.region) {
+                        return make_error(sec::runtime_error, "Regions differ in size.");
+                    }
+                    if (rect.extent() > num_elements_ || host.extent() > data.size()) {
+                        return make_error(sec::runtime_error, "Region exceeds the buffer or the data.");
+                    }
+                    std::vector<cl_event> prev_events;
+                    if (event_) {
+                        prev_events.push_back(event_.get());
+                    }
+                    cl_event event;
+                    auto err = clEnqueueWriteBufferRect(
+                        queue_.get(), memory_.get(), CL_TRUE, rect.origin_bytes<T>().data(),
+                        host.origin_bytes<T>().data(), rect.region_bytes<T>().data(), rect.row_size() * sizeof(T),
+                        rect.slice_size() * sizeof(T), host.row_size() * sizeof(T), host.slice_size() * sizeof(T),
+                        data.data(), static_cast<cl_uint>(prev_events.size()), prev_events.data(), &event);
+                    if (err != CL_SUCCESS) {
+                        return make_error(sec::runtime_error, opencl_error(err));
+                    }
+                    event_.reset(event, false);
+                    return none;
+                }
+
+                /// Writes the tightly packed elements in `data` to the box described by
+                /// `rect`. Blocks until the transfer finished.
+                error write_rect(const buffer_rect &rect, const std::vector<T> &data) {
+                    return write_rect(rect, data, rect.packed());
+                }
+
+                /// Reads `num_elements` elements starting at element `offset`. Blocks
+                /// until the transfer finished.
+                expected<std::vector<T>> read(size_t offset, size_t num_elements) {
+                    if (!memory_) {
+                        return make_error(sec::runtime_error, "No memory assigned.");
+                    }
+                    if (0 != (access_ & CL_MEM_HOST_NO_ACCESS) || 0 != (access_ & CL_MEM_HOST_WRITE_ONLY)) {
+                        return make_error(sec::runtime_error, "No memory access.");
+                    }
+                    if (offset + num_elements > num_elements_) {
+                        return make_error(sec::runtime_error, "Range exceeds the buffer.");
+                    }
+                    std::vector<T> buffer(num_elements);
+                    std::vector<cl_event> prev_events;
+                    if (event_) {
+                        prev_events.push_back(event_.get());
+                    }
+                    cl_event event;
+                    auto err = clEnqueueReadBuffer(queue_.get(), memory_.get(), CL_TRUE, sizeof(T) * offset,
+                                                   sizeof(T) * num_elements, buffer.data(),
+                                                   static_cast<cl_uint>(prev_events.size()), prev_events.data(),
+                                                   &event);
+                    if (err != CL_SUCCESS) {
+                        return make_error(sec::runtime_error, opencl_error(err));
+                    }
+                    event_.reset(event, false);
+                    return buffer;
+                }
+
+                /// Writes `data` starting at element `offset`. Blocks until the transfer
+                /// finished.
+                error write(size_t offset, const std::vector<T> &data) {
+                    if (!memory_) {
+                        return make_error(sec::runtime_error, "No memory assigned.");
+                    }
+                    if (0 != (access_ & CL_MEM_HOST_NO_ACCESS) || 0 != (access_ & CL_MEM_HOST_READ_ONLY)) {
+                        return make_error(sec::runtime_error, "No memory access.");
+                    }
+                    if (offset + data.size() > num_elements_) {
+                        return make_error(sec::runtime_error, "Range exceeds the buffer.");
+                    }
+                    std::vector<cl_event> prev_events;
+                    if (event_) {
+                        prev_events.push_back(event_.get());
+                    }
+                    cl_event event;
+                    auto err = clEnqueueWriteBuffer(queue_.get(), memory_.get(), CL_TRUE, sizeof(T) * offset,
+                                                    sizeof(T) * data.size(), data.data(),
+                                                    static_cast<cl_uint>(prev_events.size()), prev_events.data(),
+                                                    &event);
+                    if (err != CL_SUCCESS) {
+                        return make_error(sec::runtime_error, opencl_error(err));
+                    }
+                    event_.reset(event, false);
+                    return none;
+                }
+
                 void reset() {
                     num_elements_ = 0;
                     access_ = CL_MEM_HOST_NO_ACCESS;
@@ -168,6 +299,12 @@ namespace nil {
                     return std::move(ref);
                 }
 
+                template<class T, size_t Dims>
+                image_ref<T, Dims> add_event(image_ref<T, Dims> ref) {
+                    ref.set_event(event_);
+                    return std::move(ref);
+                }
+
                 detail::raw_event_ptr event_;
             };
 
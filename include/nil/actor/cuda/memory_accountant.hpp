@@ -0,0 +1,122 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <functional>
+
+#include <nil/actor/detail/raw_ptr.hpp>
+
+#include <nil/actor/cuda/global.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// A snapshot of the memory held by buffers allocated on a device.
+            struct memory_stats {
+                /// Bytes held by live buffers.
+                size_t current;
+                /// Maximum of `current` since the device was created.
+                size_t peak;
+                /// Soft limit for `current`, exceeding it triggers evictions.
+                size_t budget;
+                /// Number of live buffers.
+                size_t allocations;
+                /// Number of bytes released by evictions so far.
+                size_t evicted;
+                /// Share of the reserved device memory lost to rounding buffer sizes
+                /// up to the base address alignment of the device, i.e., `1 - current
+                /// / reserved`. This does not include fragmentation by the allocator
+                /// of the OpenCL runtime, which is not observable.
+                double rounding_overhead;
+            };
+
+            /// Tracks all buffers created for a device and keeps the sum of their sizes
+            /// below a soft budget by asking registered evictors, e.g., caches, to
+            /// release memory before new buffers are created.
+            class memory_accountant {
+            public:
+                /// Releases at least the given number of bytes if possible and returns
+                /// the number of bytes actually released.
+                using evictor = std::function<size_t(size_t)>;
+
+                /// Creates an accountant that reserves buffer sizes in multiples of
+                /// `granularity` bytes, i.e., `CL_DEVICE_MEM_BASE_ADDR_ALIGN` in bytes.
+                memory_accountant(detail::raw_context_ptr context, size_t granularity);
+
+                memory_accountant(const memory_accountant &) = delete;
+
+                memory_accountant &operator=(const memory_accountant &) = delete;
+
+                /// Creates a buffer of `num_bytes` bytes and tracks it until the OpenCL
+                /// runtime destroys it. Evicts registered caches first if the budget
+                /// would be exceeded and retries once after evicting everything if the
+                /// runtime fails to allocate the buffer.
+                /// @throws std::runtime_error if the buffer could not be created.
+                cl_mem create_buffer(cl_mem_flags flags, size_t num_bytes, void *host_ptr = nullptr);
+
+                /// Creates an image described by `format` and `desc` that occupies
+                /// `num_bytes` bytes and tracks it like a buffer.
+                /// @throws std::runtime_error if the image could not be created.
+                cl_mem create_image(cl_mem_flags flags, const cl_image_format &format, const cl_image_desc &desc,
+                                    size_t num_bytes);
+
+                /// Registers a function for releasing memory under pressure. Evictors
+                /// are asked in registration order.
+                void add_evictor(evictor f);
+
+                /// Sets the soft budget to `fraction` of `global_mem_size` bytes.
+                void budget(cl_ulong global_mem_size, double fraction);
+
+                /// Returns the current figures.
+                memory_stats stats() const;
+
+            private:
+                struct counters {
+                    std::mutex mtx;
+                    size_t current = 0;
+                    size_t reserved = 0;
+                    size_t peak = 0;
+                    size_t allocations = 0;
+                };
+
+                // Bookkeeping for a single buffer, owned by the OpenCL runtime through
+                // the destructor callback of the buffer.
+                struct allocation {
+                    std::shared_ptr<counters> owner;
+                    size_t num_bytes;
+                    size_t reserved;
+                };
+
+                static void CL_CALLBACK release(cl_mem, void *data);
+
+                // Runs `create` under the budget and tracks the resulting memory object.
+                cl_mem allocate(const char *fname, size_t num_bytes, const std::function<cl_mem(cl_int *)> &create);
+
+                // Asks evictors to release `num_bytes` bytes, returns released bytes.
+                size_t evict(size_t num_bytes);
+
+                size_t reserved_size(size_t num_bytes) const;
+
+                detail::raw_context_ptr context_;
+                size_t granularity_;
+                std::shared_ptr<counters> counters_;
+                mutable std::mutex mtx_;
+                std::vector<evictor> evictors_;
+                size_t budget_;
+                size_t evicted_;
+            };
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,92 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <mutex>
+#include <string>
+
+#include <nil/actor/all.hpp>
+
+#include <nil/actor/detail/raw_ptr.hpp>
+
+#include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/device.hpp>
+#include <nil/actor/cuda/mem_ref.hpp>
+#include <nil/actor/cuda/completion_executor.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// The hash function of inner nodes in a Merkle tree with nodes of
+            /// `words` 32-bit words. The OpenCL C `source` defines the function
+            /// `void actor_merkle_hash(const uint* left, const uint* right, uint* out)`
+            /// and may use the macro `ACTOR_WORDS`.
+            struct merkle_hash {
+                std::string source;
+                size_t words;
+            };
+
+            /// Returns SHA-256 over the concatenation of both children. Nodes are
+            /// digests stored as eight big-endian words.
+            merkle_hash sha256_merkle_hash();
+
+            /// Returns the OpenCL C source of the Merkle kernels for `hash`.
+            std::string merkle_source(const merkle_hash &hash);
+
+            /// An actor that builds a Merkle tree over `2^k` leaves on the device. All
+            /// levels live in a single buffer with the leaves first and the root last,
+            /// and the kernels of all levels are enqueued at once with each level
+            /// waiting for the event of the previous one. Only the requested nodes
+            /// are read back:
+            ///
+            /// - `(leaves)` replies with the root.
+            /// - `(leaves, indices)` replies with the root and the authentication path
+            ///   of each leaf in `indices`, i.e., the siblings from the leaf level
+            ///   upwards, as a single vector.
+            ///
+            /// The leaves are a `std::vector<cl_uint>` or a `mem_ref<cl_uint>` holding
+            /// `words` words per leaf and the indices a `std::vector<cl_uint>`.
+            class merkle_builder : public local_actor {
+            public:
+                const char *name() const override {
+                    return "CUDA merkle builder";
+                }
+
+                static actor create(actor_config actor_conf, device_ptr dev, detail::raw_command_queue_ptr queue,
+                                    completion_executor *executor, detail::raw_kernel_ptr level_kernel,
+                                    detail::raw_kernel_ptr paths_kernel, size_t words);
+
+                void enqueue(mailbox_element_ptr ptr, execution_unit *) override;
+
+                void enqueue(strong_actor_ptr sender, message_id mid, message content, execution_unit *host) override;
+
+                merkle_builder(actor_config actor_conf, device_ptr dev, detail::raw_command_queue_ptr queue,
+                               completion_executor *executor, detail::raw_kernel_ptr level_kernel,
+                               detail::raw_kernel_ptr paths_kernel, size_t words);
+
+                void launch(execution_unit *, bool, bool) override;
+
+            private:
+                void build(message content, response_promise promise);
+
+                device_ptr device_;
+                detail::raw_command_queue_ptr queue_;
+                completion_executor *executor_;
+                // kernel arguments are set before each launch
+                std::mutex kernel_mtx_;
+                detail::raw_kernel_ptr level_kernel_;
+                detail::raw_kernel_ptr paths_kernel_;
+                size_t words_;
+            };
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,137 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <nil/actor/fwd.hpp>
+
+#include <nil/actor/cuda/memory_accountant.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// Counters of a single actor facade.
+            struct kernel_metrics {
+                /// Id of the actor facade.
+                actor_id id;
+                /// Name of the kernel the facade invokes.
+                std::string name;
+                /// Number of messages the facade received so far.
+                uint64_t messages;
+            };
+
+            /// A snapshot of the counters and gauges of a device.
+            struct device_metrics {
+                /// Id of the device as assigned by the manager.
+                unsigned id;
+                /// Number of kernel launches by actor facades so far.
+                uint64_t commands;
+                /// Number of commands enqueued or waiting for their results to be
+                /// delivered.
+                uint64_t in_flight;
+                /// Number of completed commands waiting for a thread of the completion
+                /// executor.
+                uint64_t queue_depth;
+                /// Number of bytes written to the device by actors so far.
+                uint64_t bytes_uploaded;
+                /// Number of bytes read back from the device by actors so far.
+                uint64_t bytes_downloaded;
+                /// Number of programs built for the device so far.
+                uint64_t program_builds;
+                /// Number of `clSetKernelArg` calls by actor facades so far.
+                uint64_t arg_sets;
+                /// Number of `clSetKernelArg` calls skipped by actor facades so far,
+                /// because the argument held the same value already.
+                uint64_t arg_sets_skipped;
+                /// Number of completion callbacks that delivered results so far.
+                uint64_t callbacks;
+                /// Sum of the time from completion callback to handing the result to
+                /// the receiver in nanoseconds.
+                uint64_t callback_latency;
+                /// Maximum of the time from completion callback to handing the result
+                /// to the receiver in nanoseconds.
+                uint64_t max_callback_latency;
+                /// Buffers currently allocated on the device.
+                memory_stats memory;
+                /// Counters of the live actor facades running on the device.
+                std::vector<kernel_metrics> kernels;
+            };
+
+            /// A snapshot of the counters and gauges of all devices.
+            struct metrics_snapshot {
+                /// Time at which the snapshot was taken.
+                std::chrono::steady_clock::time_point time;
+
+                std::vector<device_metrics> devices;
+
+                /// Returns the messages per second received by the facade `id` between
+                /// `earlier` and this snapshot or 0 if it is missing from one of them.
+                double message_rate(const metrics_snapshot &earlier, actor_id id) const;
+            };
+
+            /// Counters updated while a device processes commands. All counters are
+            /// atomics and may be updated from any thread.
+            class device_counters {
+            public:
+                /// Counter of a single actor facade, shared between the facade and the
+                /// device.
+                using kernel_counter = std::atomic<uint64_t>;
+
+                device_counters();
+
+                device_counters(const device_counters &) = delete;
+
+                device_counters &operator=(const device_counters &) = delete;
+
+                /// Returns the message counter for the facade `id`, which stays listed
+                /// in snapshots as long as the facade holds on to it.
+                std::shared_ptr<kernel_counter> add_kernel(actor_id id, std::string name);
+
+                /// Records the time from completion callback to handing the result to
+                /// the receiver.
+                void record_callback(uint64_t latency);
+
+                /// Fills all fields of `result` but `id` and `memory`.
+                void collect(device_metrics &result) const;
+
+                std::atomic<uint64_t> commands;
+                std::atomic<uint64_t> in_flight;
+                std::atomic<uint64_t> queue_depth;
+                std::atomic<uint64_t> bytes_uploaded;
+                std::atomic<uint64_t> bytes_downloaded;
+                std::atomic<uint64_t> program_builds;
+                std::atomic<uint64_t> arg_sets;
+                std::atomic<uint64_t> arg_sets_skipped;
+
+            private:
+                struct kernel_entry {
+                    actor_id id;
+                    std::string name;
+                    std::weak_ptr<kernel_counter> counter;
+                };
+
+                std::atomic<uint64_t> callbacks_;
+                std::atomic<uint64_t> callback_latency_;
+                std::atomic<uint64_t> max_callback_latency_;
+                mutable std::mutex mtx_;
+                std::vector<kernel_entry> kernels_;
+            };
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
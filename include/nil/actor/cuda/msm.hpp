@@ -0,0 +1,64 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/device.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// A short Weierstrass curve y^2 = x^3 + b over a prime field, e.g.,
+            /// BN254 or BLS12-381. The MSM kernels do not depend on `b`. Points are
+            /// passed in affine coordinates with `limbs()` 32-bit words per coordinate
+            /// in little-endian order and not in Montgomery form. The point at
+            /// infinity is encoded as (0, 0).
+            struct msm_curve {
+                /// The odd prime modulus of the base field.
+                std::vector<cl_uint> modulus;
+
+                /// Number of bits of the scalars, which must be below 2^scalar_bits.
+                size_t scalar_bits;
+
+                size_t limbs() const {
+                    return modulus.size();
+                }
+
+                size_t scalar_limbs() const {
+                    return (scalar_bits + 31) / 32;
+                }
+            };
+
+            /// Returns the number of windows of `window_bits` that cover a scalar.
+            inline size_t msm_num_windows(const msm_curve &curve, size_t window_bits) {
+                return (curve.scalar_bits + window_bits - 1) / window_bits;
+            }
+
+            /// Returns the OpenCL C source of the MSM kernels for `curve` and windows
+            /// of `window_bits`.
+            std::string msm_source(const msm_curve &curve, size_t window_bits);
+
+            /// Returns the window size that minimizes the estimated run time of an
+            /// MSM over `num_points` points on `dev`, taking the number of compute
+            /// units and the local memory for the window reduction into account.
+            size_t msm_window_bits(const device &dev, const msm_curve &curve, size_t num_points);
+
+            /// Returns the work-group size of the window reduction on `dev`, i.e.,
+            /// the largest power of two within `max_work_group_size()` and the number
+            /// of buckets whose partial sums fit into local memory.
+            size_t msm_group_size(const device &dev, const msm_curve &curve, size_t window_bits);
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -9,12 +9,29 @@
 
 #pragma once
 
+#include <vector>
+
 #include <nil/actor/cuda/global.hpp>
 
 namespace nil {
     namespace actor {
         namespace cuda {
 
+            /// How a range whose global dimensions are not multiples of its local
+            /// dimensions is launched.
+            enum class remainder_policy {
+                /// Launch as given, which requires the global dimensions to be multiples
+                /// of the local dimensions before OpenCL 2.0.
+                none,
+                /// Round the global dimensions up to the next multiple. Kernels skip
+                /// the padding by checking against a `real_size` argument.
+                pad,
+                /// Launch all full work-groups at once and the remainder of each
+                /// dimension as a separate launch with smaller work-groups, which lets
+                /// kernels omit bounds checks.
+                split
+            };
+
             class nd_range {
             public:
                 nd_range(const opencl::dim_vec &dimensions, const opencl::dim_vec &offsets = {},
@@ -51,12 +68,44 @@ namespace nil {
                     return local_dims_;
                 }
 
+                /// Returns the global dimensions before padding, which equal
+                /// `dimensions()` unless the policy is `pad`.
+                const opencl::dim_vec &real_dimensions() const {
+                    return real_dims_.empty() ? dims_ : real_dims_;
+                }
+
+                remainder_policy policy() const {
+                    return policy_;
+                }
+
+                /// Returns the ranges to enqueue for this range, i.e., this range unless
+                /// the policy is `split` and a dimension has a remainder. Otherwise one
+                /// range per combination of full and remainder part of each dimension.
+                std::vector<nd_range> launches() const;
+
+                /// Creates a range of `dimensions` rounded up to multiples of
+                /// `local_dimensions`.
+                static nd_range padded(const opencl::dim_vec &dimensions, const opencl::dim_vec &local_dimensions,
+                                       const opencl::dim_vec &offsets = {});
+
+                /// Creates a range of `dimensions` that launches its remainders
+                /// separately.
+                static nd_range split(const opencl::dim_vec &dimensions, const opencl::dim_vec &local_dimensions,
+                                      const opencl::dim_vec &offsets = {});
+
             private:
                 opencl::dim_vec dims_;
                 opencl::dim_vec offset_;
                 opencl::dim_vec local_dims_;
+                opencl::dim_vec real_dims_;
+                remainder_policy policy_ = remainder_policy::none;
             };
 
+            /// Enqueues the launches of `range` for `kernel`, waiting for `events`.
+            /// Stores an event that completes with the last launch in `event`.
+            cl_int enqueue_nd_range(cl_command_queue queue, cl_kernel kernel, const nd_range &range,
+                                    cl_uint num_events, const cl_event *events, cl_event *event);
+
         }    // namespace cuda
     }        // namespace actor
 }    // namespace nil
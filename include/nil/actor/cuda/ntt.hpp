@@ -0,0 +1,61 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/device.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// A prime field for the number-theoretic transform. Elements consist of
+            /// `limbs()` 32-bit words in little-endian order. The NTT kernels expect
+            /// elements in Montgomery form, see `manager::spawn_ntt_convert`.
+            struct ntt_field {
+                /// The odd prime modulus.
+                std::vector<cl_uint> modulus;
+
+                /// A primitive root of unity of order `2^two_adicity`, not in
+                /// Montgomery form.
+                std::vector<cl_uint> root_of_unity;
+
+                /// Binary logarithm of the largest supported transform.
+                size_t two_adicity;
+
+                size_t limbs() const {
+                    return modulus.size();
+                }
+            };
+
+            /// Returns the OpenCL C source of the NTT kernels for `field`.
+            std::string ntt_source(const ntt_field &field);
+
+            /// Returns the twiddle table for a transform of `2^log_size` elements,
+            /// i.e., the first `2^(log_size - 1)` powers of the root of unity of that
+            /// order in Montgomery form. The table of an inverse transform uses the
+            /// inverse root and additionally stores `2^-log_size` at its end.
+            /// @throws std::runtime_error if `log_size` is 0 or exceeds the two-adicity.
+            std::vector<cl_uint> ntt_twiddles(const ntt_field &field, size_t log_size, bool inverse);
+
+            /// Returns the factor that converts elements of `field` into Montgomery
+            /// form (R^2 mod p) or out of it (1) by a Montgomery multiplication.
+            std::vector<cl_uint> ntt_conversion_factor(const ntt_field &field, bool to_montgomery);
+
+            /// Returns the number of elements a work group of the NTT on `dev`
+            /// transforms in local memory, which is a power of two of at most `n`.
+            size_t ntt_block_size(const device &dev, const ntt_field &field, size_t n);
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,85 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <cstring>
+#include <type_traits>
+
+#include <nil/actor/all.hpp>
+
+#include <nil/actor/raise_error.hpp>
+
+#include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/persistent_kernel.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// An actor forwarding each message with a single `In` to a persistent
+            /// kernel and replying with the `Out` computed for it. Both types are
+            /// copied bytewise to and from the device and must have the same layout
+            /// as the types used in the kernel.
+            template<class In, class Out>
+            class persistent_facade : public local_actor {
+            public:
+                static_assert(std::is_trivially_copyable<In>::value && std::is_trivially_copyable<Out>::value,
+                              "Descriptors of persistent kernels must be trivially copyable.");
+
+                const char *name() const override {
+                    return "CUDA persistent actor";
+                }
+
+                static actor create(actor_config actor_conf, persistent_kernel_ptr kernel) {
+                    auto &sys = actor_conf.host->system();
+                    return make_actor<persistent_facade, actor>(sys.next_actor_id(), sys.node(), &sys,
+                                                                std::move(actor_conf), std::move(kernel));
+                }
+
+                /// Delivers the output descriptor at `data`, which may be unaligned.
+                static void deliver(response_promise &promise, const void *data) {
+                    Out result;
+                    std::memcpy(&result, data, sizeof(Out));
+                    promise.deliver(std::move(result));
+                }
+
+                void enqueue(mailbox_element_ptr ptr, execution_unit *) override {
+                    ACTOR_ASSERT(ptr != nullptr);
+                    ACTOR_LOG_TRACE(ACTOR_ARG(*ptr));
+                    response_promise promise {ctrl(), *ptr};
+                    auto content = ptr->move_content_to_message();
+                    if (!content.match_elements<In>()) {
+                        ACTOR_LOG_ERROR("Message types do not match the expected signature.");
+                        return;
+                    }
+                    kernel_->submit(&content.get_as<In>(0), std::move(promise));
+                }
+
+                void enqueue(strong_actor_ptr sender, message_id mid, message content, execution_unit *host) override {
+                    ACTOR_LOG_TRACE("");
+                    enqueue(make_mailbox_element(std::move(sender), mid, {}, std::move(content)), host);
+                }
+
+                persistent_facade(actor_config actor_conf, persistent_kernel_ptr kernel) :
+                    local_actor(actor_conf), kernel_(std::move(kernel)) {
+                    ACTOR_LOG_TRACE(ACTOR_ARG(this->id()));
+                }
+
+                void launch(execution_unit *, bool, bool) override {
+                    ACTOR_RAISE_ERROR("launch of the persistent facade should not be called");
+                }
+
+            private:
+                persistent_kernel_ptr kernel_;
+            };
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
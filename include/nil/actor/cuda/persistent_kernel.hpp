@@ -0,0 +1,113 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <condition_variable>
+
+#include <nil/actor/ref_counted.hpp>
+#include <nil/actor/intrusive_ptr.hpp>
+#include <nil/actor/response_promise.hpp>
+
+#include <nil/actor/detail/raw_ptr.hpp>
+
+#include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/device.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// OpenCL C 2.0 source that defines `ACTOR_PERSISTENT_KERNEL(name, in_type,
+            /// out_type, fn)`. Prepend it to a program compiled with `-cl-std=CL2.0`
+            /// and use the macro to define a kernel that calls `fn(const global in_type *,
+            /// global out_type *)` for every descriptor written to its ring buffer.
+            extern const char *persistent_kernel_prelude;
+
+            class persistent_kernel;
+
+            using persistent_kernel_ptr = intrusive_ptr<persistent_kernel>;
+
+            /// A kernel that is launched once as a single work-group and then polls a
+            /// ring buffer of work descriptors in fine-grained shared virtual memory.
+            /// Work item i serves the slots i, i + n, ... of the ring, where n is the
+            /// largest divisor of the capacity that fits into a work-group, hence up
+            /// to n consecutive requests run concurrently.
+            /// Submitting a request only writes its descriptor into the ring and flips
+            /// the state of its slot, i.e., requests require neither kernel launches nor
+            /// buffer allocations. A host thread polls the ring for completions and
+            /// fulfills the promises in submission order. Requires a device with
+            /// support for fine-grained SVM buffers with atomics.
+            class persistent_kernel : public ref_counted {
+            public:
+                /// Delivers the output descriptor at the second argument.
+                using deliver_fun = void (*)(response_promise &, const void *);
+
+                persistent_kernel(device_ptr dev, detail::raw_kernel_ptr kernel, size_t capacity, size_t input_size,
+                                  size_t output_size, deliver_fun deliver);
+
+                ~persistent_kernel() override;
+
+                /// Allocates the ring buffer, launches the kernel and starts polling.
+                /// @throws std::runtime_error if the device lacks SVM atomics.
+                void start();
+
+                /// Writes `input` to a free slot or queues it until a slot becomes free.
+                void submit(const void *input, response_promise promise);
+
+                /// Stops the kernel and the poller, pending requests receive an error.
+                void shutdown();
+
+                /// Returns whether the kernel accepts requests.
+                bool running() const;
+
+                /// Returns the number of slots in the ring buffer.
+                size_t capacity() const;
+
+            private:
+                enum slot_state : cl_uint { slot_free = 0, slot_submitted = 1, slot_completed = 2 };
+
+                // Requires `mtx_` to be locked and a free slot.
+                void publish(const void *input, response_promise promise);
+
+                void poll_loop();
+
+                std::atomic<cl_uint> &control();
+
+                std::atomic<cl_uint> &state(size_t slot);
+
+                device_ptr device_;
+                detail::raw_kernel_ptr kernel_;
+                detail::raw_command_queue_ptr queue_;
+                size_t capacity_;
+                size_t input_size_;
+                size_t output_size_;
+                deliver_fun deliver_;
+                void *ring_;
+                char *inputs_;
+                char *outputs_;
+                std::atomic<bool> running_;
+                std::mutex mtx_;
+                std::condition_variable cv_;
+                std::vector<response_promise> promises_;
+                std::deque<std::pair<std::vector<char>, response_promise>> backlog_;
+                size_t submitted_;
+                size_t completed_;
+                std::thread poller_;
+            };
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -36,7 +36,7 @@ namespace nil {
 
                 inline const std::string &version() const;
 
-                static platform_ptr create(cl_platform_id platform_id, unsigned start_id);
+                static platform_ptr create(cl_platform_id platform_id, unsigned start_id, tracer *trace = nullptr);
 
             private:
                 platform(cl_platform_id platform_id, detail::raw_context_ptr context, std::string name,
@@ -0,0 +1,163 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <string>
+
+#include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/device.hpp>
+#include <nil/actor/cuda/nd_range.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// Number of bits sorted per pass of the radix sort.
+            constexpr size_t radix_bits = 4;
+
+            /// Number of buckets per pass of the radix sort.
+            constexpr size_t radix_digits = size_t {1} << radix_bits;
+
+            /// Names an element type in OpenCL C together with its limits.
+            template<class T>
+            struct primitive_type;
+
+            template<>
+            struct primitive_type<cl_int> {
+                static const char *name() {
+                    return "int";
+                }
+                static const char *lowest() {
+                    return "INT_MIN";
+                }
+                static const char *max() {
+                    return "INT_MAX";
+                }
+            };
+
+            template<>
+            struct primitive_type<cl_uint> {
+                static const char *name() {
+                    return "uint";
+                }
+                static const char *lowest() {
+                    return "0";
+                }
+                static const char *max() {
+                    return "UINT_MAX";
+                }
+            };
+
+            template<>
+            struct primitive_type<cl_long> {
+                static const char *name() {
+                    return "long";
+                }
+                static const char *lowest() {
+                    return "LONG_MIN";
+                }
+                static const char *max() {
+                    return "LONG_MAX";
+                }
+            };
+
+            template<>
+            struct primitive_type<cl_ulong> {
+                static const char *name() {
+                    return "ulong";
+                }
+                static const char *lowest() {
+                    return "0";
+                }
+                static const char *max() {
+                    return "ULONG_MAX";
+                }
+            };
+
+            template<>
+            struct primitive_type<cl_float> {
+                static const char *name() {
+                    return "float";
+                }
+                static const char *lowest() {
+                    return "-INFINITY";
+                }
+                static const char *max() {
+                    return "INFINITY";
+                }
+            };
+
+            template<>
+            struct primitive_type<cl_double> {
+                static const char *name() {
+                    return "double";
+                }
+                static const char *lowest() {
+                    return "-INFINITY";
+                }
+                static const char *max() {
+                    return "INFINITY";
+                }
+            };
+
+            /// A binary operator for reductions and scans, given as OpenCL C
+            /// expression over the operands `a` and `b`. The operator must be
+            /// associative and commutative, and `identity` must be its neutral
+            /// element.
+            struct primitive_op {
+                std::string expression;
+                std::string identity;
+            };
+
+            inline primitive_op sum_op() {
+                return {"a + b", "0"};
+            }
+
+            inline primitive_op product_op() {
+                return {"a * b", "1"};
+            }
+
+            template<class T>
+            primitive_op min_op() {
+                return {"min(a, b)", primitive_type<T>::max()};
+            }
+
+            template<class T>
+            primitive_op max_op() {
+                return {"max(a, b)", primitive_type<T>::lowest()};
+            }
+
+            /// Returns the OpenCL C source of all primitives for elements of `type`.
+            /// `predicate` selects the elements kept by stream compaction and is an
+            /// expression over the element `x`.
+            std::string primitives_source(const char *type, const primitive_op &op, const std::string &predicate,
+                                          bool exclusive);
+
+            /// Returns the work-group size used by the primitives on `dev`, i.e., the
+            /// largest power of two within `max_work_group_size()` whose scratch of
+            /// `bytes_per_item` per work item fits into local memory.
+            size_t primitives_group_size(const device &dev, size_t bytes_per_item);
+
+            /// Returns the number of groups that process `len` elements. Each group
+            /// handles a contiguous chunk, and no more groups than `group_size` are
+            /// used, i.e., the partial results fit into a single group.
+            inline size_t primitives_num_groups(size_t len, size_t group_size) {
+                auto groups = (len + group_size - 1) / group_size;
+                return groups == 0 ? 1 : (groups < group_size ? groups : group_size);
+            }
+
+            /// Returns the index space for `num_groups` groups of `group_size`.
+            inline nd_range primitives_range(size_t num_groups, size_t group_size) {
+                return nd_range {dim_vec {num_groups * group_size}, {}, dim_vec {group_size}};
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
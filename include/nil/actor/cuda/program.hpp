@@ -11,13 +11,18 @@
 
 #include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
+#include <nil/actor/optional.hpp>
 #include <nil/actor/ref_counted.hpp>
 
 #include <nil/actor/detail/raw_ptr.hpp>
 
 #include <nil/actor/cuda/device.hpp>
 #include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/kernel_info.hpp>
+#include <nil/actor/cuda/completion_executor.hpp>
 
 namespace nil {
     namespace actor {
@@ -35,19 +40,38 @@ namespace nil {
                 template<bool PassConfig, class... Ts>
                 friend class actor_facade;
 
+                template<class... Ts>
+                friend class stream_facade;
+
                 template<class T, class... Ts>
                 friend intrusive_ptr<T> nil::actor::make_counted(Ts &&...);
 
+                /// Returns the device this program was built for.
+                inline const device_ptr &device() const {
+                    return device_;
+                }
+
+                /// Returns the names of all kernels in this program.
+                std::vector<std::string> kernel_names() const;
+
+                /// Returns the resource usage of the kernel `kernel_name` on the device
+                /// of this program or `none` if the program has no such kernel.
+                /// @throws std::runtime_error if a query fails.
+                optional<kernel_info> info(const std::string &kernel_name) const;
+
             private:
-                program(detail::raw_context_ptr context, detail::raw_command_queue_ptr queue,
-                        detail::raw_program_ptr prog, std::map<std::string, detail::raw_kernel_ptr> available_kernels);
+                program(device_ptr dev, detail::raw_context_ptr context, detail::raw_command_queue_ptr queue,
+                        detail::raw_program_ptr prog, std::map<std::string, detail::raw_kernel_ptr> available_kernels,
+                        completion_executor *executor);
 
                 ~program();
 
+                device_ptr device_;
                 detail::raw_context_ptr context_;
                 detail::raw_program_ptr program_;
                 detail::raw_command_queue_ptr queue_;
                 std::map<std::string, detail::raw_kernel_ptr> available_kernels_;
+                completion_executor *executor_;
             };
 
         }    // namespace cuda
@@ -0,0 +1,207 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include <nil/actor/sec.hpp>
+#include <nil/actor/error.hpp>
+#include <nil/actor/spawner.hpp>
+#include <nil/actor/expected.hpp>
+#include <nil/actor/execution_unit.hpp>
+#include <nil/actor/meta/type_name.hpp>
+#include <nil/actor/meta/load_callback.hpp>
+#include <nil/actor/meta/save_callback.hpp>
+
+#include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/device.hpp>
+#include <nil/actor/cuda/manager.hpp>
+#include <nil/actor/cuda/mem_ref.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// Size of the pieces a `remote_ref` is read back and uploaded in.
+            constexpr size_t remote_chunk_bytes = size_t {1} << 20;
+
+            /// A handle to a device buffer that may cross node boundaries. Serializing
+            /// it reads the buffer back in chunks of `remote_chunk_bytes`, while
+            /// deserializing it uploads the chunks to the target device of the
+            /// receiving node, or to its first device if it has no such device. If
+            /// the receiver has no OpenCL manager, the data stays on the host until
+            /// `get` is called. Like `mem_ref`, access is not thread safe.
+            ///
+            /// Messages only carry types known to the type system of both nodes,
+            /// hence each node registers the instantiations it sends or receives
+            /// under the same name, e.g.,
+            /// `cfg.add_message_type<remote_ref<float>>("remote_float_ref")`.
+            template<class T>
+            class remote_ref {
+            public:
+                using value_type = T;
+
+                remote_ref() : target_ {0}, num_elements_ {0} {
+                    // nop
+                }
+
+                /// Wraps `ref`, which the receiver uploads to its device `target`. The
+                /// buffer must allow reading from the host.
+                explicit remote_ref(mem_ref<T> ref, size_t target = 0) :
+                    ref_ {std::move(ref)}, target_ {static_cast<uint32_t>(target)},
+                    num_elements_ {static_cast<uint64_t>(ref_.size())} {
+                    // nop
+                }
+
+                remote_ref(remote_ref &&) = default;
+
+                remote_ref(const remote_ref &) = default;
+
+                remote_ref &operator=(remote_ref &&) = default;
+
+                remote_ref &operator=(const remote_ref &) = default;
+
+                inline size_t size() const {
+                    return static_cast<size_t>(num_elements_);
+                }
+
+                inline size_t target() const {
+                    return target_;
+                }
+
+                /// Returns whether the data resides on a device of this node.
+                inline bool on_device() const {
+                    return static_cast<bool>(ref_.get());
+                }
+
+                /// Returns the buffer, uploading received data to `dev` first if it
+                /// still resides on the host.
+                expected<mem_ref<T>> get(const device_ptr &dev) {
+                    if (!on_device()) {
+                        if (auto err = upload(*dev)) {
+                            return err;
+                        }
+                    }
+                    return ref_;
+                }
+
+                /// Returns the buffer, uploading received data to the target device of
+                /// `mngr` first if it still resides on the host.
+                expected<mem_ref<T>> get(manager &mngr) {
+                    if (!on_device()) {
+                        if (auto err = upload(mngr)) {
+                            return err;
+                        }
+                    }
+                    return ref_;
+                }
+
+                template<class Inspector>
+                friend typename Inspector::result_type inspect(Inspector &f, remote_ref &x) {
+                    auto stage = [&]() -> error { return x.stage(); };
+                    auto unstage = [&]() -> error {
+                        // only drop chunks that still reside on a device
+                        if (x.on_device()) {
+                            x.chunks_.clear();
+                        }
+                        return none;
+                    };
+                    auto unpack = [&]() -> error {
+                        auto ctx = context_of(f, 0);
+                        if (x.size() == 0 || ctx == nullptr || !ctx->system().has_opencl_manager()) {
+                            return none;
+                        }
+                        return x.upload(ctx->system().opencl_manager());
+                    };
+                    return f(meta::type_name("remote_ref"), x.target_, x.num_elements_, meta::save_callback(stage),
+                             x.chunks_, meta::save_callback(unstage), meta::load_callback(unpack));
+                }
+
+            private:
+                template<class Inspector>
+                static auto context_of(Inspector &f, int) -> decltype(f.context()) {
+                    return f.context();
+                }
+
+                template<class Inspector>
+                static execution_unit *context_of(Inspector &, long) {
+                    return nullptr;
+                }
+
+                static size_t chunk_size() {
+                    return std::max(remote_chunk_bytes / sizeof(T), size_t {1});
+                }
+
+                error stage() {
+                    if (!on_device()) {
+                        return none;    // forwards received data as is
+                    }
+                    chunks_.clear();
+                    for (size_t offset = 0; offset < size(); offset += chunk_size()) {
+                        auto chunk = ref_.read(offset, std::min(chunk_size(), size() - offset));
+                        if (!chunk) {
+                            chunks_.clear();
+                            return std::move(chunk.error());
+                        }
+                        chunks_.emplace_back(std::move(*chunk));
+                    }
+                    return none;
+                }
+
+                error upload(manager &mngr) {
+                    auto dev = mngr.find_device(target_);
+                    if (!dev) {
+                        dev = mngr.find_device(0);
+                    }
+                    if (!dev) {
+                        return make_error(sec::runtime_error, "No device to upload a remote_ref to.");
+                    }
+                    return upload(**dev);
+                }
+
+                error upload(device &dev) {
+                    if (size() == 0) {
+                        return make_error(sec::runtime_error, "Cannot upload an empty remote_ref.");
+                    }
+                    // the size arrives separately from the data, hence a malformed
+                    // message must not cause an allocation on the device
+                    size_t received = 0;
+                    for (auto &chunk : chunks_) {
+                        received += chunk.size();
+                    }
+                    if (received != size()) {
+                        return make_error(sec::runtime_error, "Received chunks do not match the size.");
+                    }
+                    auto ref = dev.scratch_argument<T>(size(), buffer_type::input_output);
+                    size_t offset = 0;
+                    for (auto &chunk : chunks_) {
+                        if (auto err = ref.write(offset, chunk)) {
+                            return err;
+                        }
+                        offset += chunk.size();
+                        // releases host memory as soon as the chunk is on the device
+                        std::vector<T> {}.swap(chunk);
+                    }
+                    chunks_.clear();
+                    ref_ = std::move(ref);
+                    return none;
+                }
+
+                mem_ref<T> ref_;
+                uint32_t target_;
+                uint64_t num_elements_;
+                std::vector<std::vector<T>> chunks_;
+            };
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
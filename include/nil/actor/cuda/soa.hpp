@@ -0,0 +1,130 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <type_traits>
+#include <initializer_list>
+
+#include <nil/actor/meta/annotation.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// A field of a struct as passed to an inspector by `inspect`.
+            struct soa_field {
+                /// Position of the field in bytes from the start of the struct.
+                size_t offset;
+
+                /// Size of the field in bytes.
+                size_t size;
+            };
+
+            /// Inspector that records the position of every field that `inspect`
+            /// passes to it, skipping annotations such as the type name.
+            template<class T>
+            class soa_inspector {
+            public:
+                using result_type = void;
+
+                static constexpr bool reads_state = true;
+
+                static constexpr bool writes_state = false;
+
+                soa_inspector(const T &prototype, std::vector<soa_field> &fields) :
+                    base_(reinterpret_cast<const char *>(&prototype)), fields_(fields) {
+                    // nop
+                }
+
+                template<class... Ts>
+                void operator()(Ts &&... xs) {
+                    static_cast<void>(std::initializer_list<int> {(add(xs), 0)...});
+                }
+
+            private:
+                template<class U>
+                void add(const U &x) {
+                    add(x, std::is_base_of<meta::annotation, U> {});
+                }
+
+                template<class U>
+                void add(const U &, std::true_type) {
+                    // nop
+                }
+
+                template<class U>
+                void add(const U &x, std::false_type) {
+                    static_assert(std::is_trivially_copyable<U>::value,
+                                  "Fields of a struct in planar layout must be trivially copyable.");
+                    auto offset = reinterpret_cast<const char *>(&x) - base_;
+                    fields_.push_back(soa_field {static_cast<size_t>(offset), sizeof(U)});
+                }
+
+                const char *base_;
+                std::vector<soa_field> &fields_;
+            };
+
+            /// The planar (structure of arrays) layout of a struct on the device. Each
+            /// field reported by `inspect` gets its own plane, i.e., an array holding
+            /// this field of all elements. The planes of `n` elements are stored back
+            /// to back in field order and each plane has room for `stride(n)` values,
+            /// which keeps every plane aligned to 16 bytes. Field `k` of element `i`
+            /// is found at byte offset `stride(n) * (size of the fields before k) + i *
+            /// (size of field k)`.
+            class soa_layout {
+            public:
+                soa_layout(size_t element_size, std::vector<soa_field> fields);
+
+                /// Returns the layout of `T`, which must be default constructible and
+                /// trivially copyable and provide an `inspect` overload.
+                template<class T>
+                static soa_layout of() {
+                    static_assert(std::is_trivially_copyable<T>::value && std::is_default_constructible<T>::value,
+                                  "Structs in planar layout must be trivially copyable and default constructible.");
+                    T prototype {};
+                    std::vector<soa_field> fields;
+                    soa_inspector<T> f {prototype, fields};
+                    inspect(f, prototype);
+                    return {sizeof(T), std::move(fields)};
+                }
+
+                /// Returns the number of values in each plane for `n` elements.
+                static size_t stride(size_t n) {
+                    return (n + 15) / 16 * 16;
+                }
+
+                /// Returns the size of the planes for `n` elements in bytes.
+                size_t num_bytes(size_t n) const {
+                    return stride(n) * plane_size_;
+                }
+
+                const std::vector<soa_field> &fields() const {
+                    return fields_;
+                }
+
+                /// Copies the fields of `n` consecutive structs at `src` into the planes
+                /// at `dst`, which holds `num_bytes(n)` bytes.
+                void scatter(const void *src, size_t n, void *dst) const;
+
+                /// Copies the planes of `n` elements at `src` into consecutive structs
+                /// at `dst`.
+                void gather(const void *src, size_t n, void *dst) const;
+
+            private:
+                size_t element_size_;
+                size_t plane_size_;
+                std::vector<soa_field> fields_;
+            };
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
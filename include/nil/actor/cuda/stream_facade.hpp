@@ -0,0 +1,444 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <map>
+#include <array>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <exception>
+
+#include <nil/actor/all.hpp>
+
+#include <nil/actor/raise_error.hpp>
+
+#include <nil/actor/detail/raw_ptr.hpp>
+#include <nil/actor/detail/command_helper.hpp>
+
+#include <nil/actor/cuda/global.hpp>
+#include <nil/actor/cuda/device.hpp>
+#include <nil/actor/cuda/program.hpp>
+#include <nil/actor/cuda/nd_range.hpp>
+#include <nil/actor/cuda/arguments.hpp>
+#include <nil/actor/cuda/opencl_error.hpp>
+#include <nil/actor/cuda/completion_executor.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// Filter for arguments supported by the streaming facade.
+            template<class T>
+            struct is_stream_arg : std::false_type {};
+
+            template<class T>
+            struct is_stream_arg<in<T, val>> : std::true_type {};
+
+            template<class T, class F>
+            struct is_stream_arg<out<T, val, F>> : std::true_type {};
+
+            template<class T, class F>
+            struct is_stream_arg<local<T, F>> : std::true_type {};
+
+            template<class T, class Tag, class F>
+            struct is_stream_arg<priv<T, Tag, F>> : std::true_type {};
+
+            template<class T, size_t Dim>
+            struct is_stream_arg<real_size<T, Dim>> : std::true_type {};
+
+            /// An actor for processing a continuous stream of messages with the same
+            /// kernel. The facade rotates over a fixed number of buffer sets and uses
+            /// separate queues for uploads, kernels and downloads. Hence, uploading the
+            /// input of message n + 1 overlaps with the kernel of message n and with
+            /// reading back the results of message n - 1. Results are delivered in the
+            /// order the messages arrived. Messages arriving while all buffer sets are
+            /// in use are queued until a set becomes available again. Results are
+            /// mapped on the completion executor of the device if it has one.
+            template<class... Ts>
+            class stream_facade : public local_actor {
+            public:
+                static_assert(detail::tl_forall<detail::type_list<Ts...>, is_stream_arg>::value,
+                              "The streaming facade only accepts in<T, val>, out<T, val>, local<T> and priv<T> "
+                              "arguments.");
+
+                using arg_types = detail::type_list<Ts...>;
+                using unpacked_types = typename detail::tl_map<arg_types, extract_type>::type;
+
+                using input_wrapped_types = typename detail::tl_filter<arg_types, is_input_arg>::type;
+                using input_types = typename detail::tl_map<input_wrapped_types, extract_input_type>::type;
+
+                using output_wrapped_types = typename detail::tl_filter<arg_types, is_output_arg>::type;
+                using output_types = typename detail::tl_map<output_wrapped_types, extract_output_type>::type;
+
+                using processing_list = typename cl_arg_info_list<arg_types>::type;
+
+                using out_tup = typename detail::tuple_type_of<output_types>::type;
+
+                typename detail::il_indices<arg_types>::type indices;
+
+                static constexpr size_t num_args = sizeof...(Ts);
+
+                const char *name() const override {
+                    return "CUDA stream actor";
+                }
+
+                static actor create(actor_config actor_conf, const program_ptr prog, const char *kernel_name,
+                                    const nd_range &range, size_t depth, Ts &&... xs) {
+                    if (range.dimensions().empty())
+                        ACTOR_RAISE_ERROR("OpenCL kernel needs at least 1 global dimension");
+                    if (depth < 2)
+                        ACTOR_RAISE_ERROR("stream facade requires at least two buffer sets");
+                    auto &sys = actor_conf.host->system();
+                    detail::raw_kernel_ptr kernel;
+                    kernel.reset(v2get(ACTOR_CLF(clCreateKernel), prog->program_.get(), kernel_name), false);
+                    // a split range launches its remainders with smaller work-groups
+                    auto launches = range.launches();
+                    auto info = prog->info(kernel_name);
+                    if (info && !launches.empty()) {
+                        check_occupancy(kernel_name, *info, *prog->device(), launches.front());
+                    }
+                    return make_actor<stream_facade, actor>(sys.next_actor_id(), sys.node(), &sys,
+                                                            std::move(actor_conf), prog, kernel, range, depth,
+                                                            std::forward_as_tuple(xs...));
+                }
+
+                void enqueue(mailbox_element_ptr ptr, execution_unit *) override {
+                    ACTOR_ASSERT(ptr != nullptr);
+                    ACTOR_LOG_TRACE(ACTOR_ARG(*ptr));
+                    response_promise promise {ctrl(), *ptr};
+                    auto content = ptr->move_content_to_message();
+                    if (!content.match_elements(input_types {})) {
+                        ACTOR_LOG_ERROR("Message types do not match the expected signature.");
+                        return;
+                    }
+                    std::unique_lock<std::mutex> guard {mtx_};
+                    backlog_.emplace_back(std::move(content), std::move(promise));
+                    dispatch(guard);
+                }
+
+                void enqueue(strong_actor_ptr sender, message_id mid, message content, execution_unit *host) override {
+                    ACTOR_LOG_TRACE("");
+                    enqueue(make_mailbox_element(std::move(sender), mid, {}, std::move(content)), host);
+                }
+
+                stream_facade(actor_config actor_conf, const program_ptr prog, detail::raw_kernel_ptr kernel,
+                              nd_range range, size_t depth, std::tuple<Ts...> xs) :
+                    local_actor(actor_conf),
+                    kernel_(std::move(kernel)), device_(prog->device()), upload_queue_(device_->create_queue()),
+                    compute_queue_(device_->create_queue()), download_queue_(device_->create_queue()),
+                    executor_(prog->executor_), range_(std::move(range)), kernel_signature_(std::move(xs)),
+                    slots_(depth), next_slot_(0), next_seq_(0), next_delivery_(0) {
+                    ACTOR_LOG_TRACE(ACTOR_ARG(this->id()));
+                    auto &real_dims = range_.real_dimensions();
+                    default_length_ = std::accumulate(std::begin(real_dims), std::end(real_dims), size_t {1},
+                                                      std::multiplies<size_t> {});
+                    for (size_t i = 0; i < slots_.size(); ++i) {
+                        slots_[i].parent = this;
+                        slots_[i].capacity.fill(0);
+                        slots_[i].lengths.fill(0);
+                    }
+                }
+
+                void launch(execution_unit *, bool, bool) override {
+                    ACTOR_RAISE_ERROR("launch of the stream facade should not be called");
+                }
+
+            private:
+                /// A set of device buffers and the state of the message using them. Runs
+                /// as job on the completion executor once the results are available.
+                struct slot : completion_executor::job {
+                    void run() override {
+                        parent->complete(*this);
+                    }
+
+                    stream_facade *parent = nullptr;
+                    bool busy = false;
+                    size_t seq = 0;
+                    std::array<detail::raw_mem_ptr, num_args> buffers;
+                    std::array<size_t, num_args> capacity;
+                    std::array<size_t, num_args> lengths;
+                    std::vector<cl_event> uploads;
+                    std::vector<cl_event> downloads;
+                    detail::raw_event_ptr kernel_event;
+                    detail::raw_event_ptr done;
+                    strong_actor_ptr keep_alive;
+                    message msg;    // keeps the host data alive during the upload
+                    response_promise promise;
+                    out_tup results;
+
+                    void release_events() {
+                        for (auto e : uploads) {
+                            clReleaseEvent(e);
+                        }
+                        for (auto e : downloads) {
+                            clReleaseEvent(e);
+                        }
+                        uploads.clear();
+                        downloads.clear();
+                        kernel_event.reset();
+                        done.reset();
+                    }
+                };
+
+                // Issues queued messages while buffer sets are available. Buffer sets
+                // are taken in ring order to keep the stream in sequence. Releases
+                // `guard` while registering the completion callback of a message,
+                // because the callback may run right away on this thread, and while
+                // waiting for the commands of a failed message.
+                void dispatch(std::unique_lock<std::mutex> &guard) {
+                    while (!backlog_.empty() && !slots_[next_slot_].busy) {
+                        auto &s = slots_[next_slot_];
+                        next_slot_ = (next_slot_ + 1) % slots_.size();
+                        s.busy = true;
+                        s.seq = next_seq_++;
+                        s.msg = std::move(backlog_.front().first);
+                        s.promise = std::move(backlog_.front().second);
+                        backlog_.pop_front();
+                        auto err = guarded([&] { issue(s); });
+                        guard.unlock();
+                        if (!err) {
+                            err = guarded([&] { watch(s); });
+                        }
+                        if (err) {
+                            fail(s, std::move(err));
+                        }
+                        guard.lock();
+                    }
+                }
+
+                // Runs `f` and converts exceptions into an error.
+                template<class F>
+                error guarded(F f) {
+#ifndef ACTOR_NO_EXCEPTIONS
+                    try {
+                        f();
+                    } catch (std::exception &e) {
+                        return make_error(sec::runtime_error, std::string {e.what()});
+                    }
+#else
+                    f();
+#endif
+                    return none;
+                }
+
+                // Sets the arguments of the kernel and enqueues the commands of a
+                // message. Requires `mtx_` to be locked.
+                void issue(slot &s) {
+                    bind_arguments(s, indices);
+                    cl_event kernel_event;
+                    v1callcl(ACTOR_CLF(enqueue_nd_range), compute_queue_.get(), kernel_.get(), range_,
+                             static_cast<cl_uint>(s.uploads.size()), s.uploads.empty() ? nullptr : s.uploads.data(),
+                             &kernel_event);
+                    s.kernel_event.reset(kernel_event, false);
+                    enqueue_downloads(s, indices);
+                    if (s.downloads.empty()) {
+                        // nothing to read back, wait for the kernel instead
+                        clRetainEvent(kernel_event);
+                        s.downloads.push_back(kernel_event);
+                    }
+                    cl_event done;
+                    v1callcl(ACTOR_CLF(clEnqueueMarkerWithWaitList), download_queue_.get(),
+                             static_cast<cl_uint>(s.downloads.size()), s.downloads.data(), &done);
+                    s.done.reset(done, false);
+                }
+
+                // Hands the results of a message to `complete` once they are available.
+                void watch(slot &s) {
+                    s.keep_alive = ctrl();
+                    auto cb = [](cl_event, cl_int, void *data) {
+                        auto sp = reinterpret_cast<slot *>(data);
+                        if (sp->parent->executor_ != nullptr) {
+                            sp->parent->executor_->submit(sp);
+                        } else {
+                            sp->run();
+                        }
+                    };
+                    v1callcl(ACTOR_CLF(clSetEventCallback), s.done.get(), CL_COMPLETE, std::move(cb), &s);
+                    v3callcl(clFlush, upload_queue_.get());
+                    v3callcl(clFlush, compute_queue_.get());
+                    v3callcl(clFlush, download_queue_.get());
+                }
+
+                // Called once all results of a message are available on the host.
+                void complete(slot &s) {
+                    strong_actor_ptr keep_alive;
+                    std::unique_lock<std::mutex> guard {mtx_};
+                    s.release_events();
+                    s.msg = message {};
+                    ready_.emplace(s.seq, std::make_pair(std::move(s.promise), message_from_results {}(s.results)));
+                    keep_alive.swap(s.keep_alive);
+                    s.busy = false;
+                    deliver_ready();
+                    dispatch(guard);
+                }
+
+                // Called if issuing the commands of a message failed, answers it with
+                // `err` in sequence and frees its buffer set.
+                // Requires `mtx_` to be unlocked.
+                void fail(slot &s, error err) {
+                    ACTOR_LOG_ERROR("stream facade failed to issue a message:" << ACTOR_ARG(err));
+                    // commands issued before the failure still use the buffers
+                    std::vector<cl_event> issued {s.uploads};
+                    issued.insert(issued.end(), s.downloads.begin(), s.downloads.end());
+                    for (auto e : {s.kernel_event.get(), s.done.get()}) {
+                        if (e != nullptr) {
+                            issued.push_back(e);
+                        }
+                    }
+                    if (!issued.empty()) {
+                        v3callcl(clWaitForEvents, static_cast<cl_uint>(issued.size()), issued.data());
+                    }
+                    strong_actor_ptr keep_alive;
+                    std::lock_guard<std::mutex> guard {mtx_};
+                    s.release_events();
+                    s.msg = message {};
+                    keep_alive.swap(s.keep_alive);
+                    ready_.emplace(s.seq, std::make_pair(std::move(s.promise), make_message(std::move(err))));
+                    s.busy = false;
+                    deliver_ready();
+                }
+
+                // Delivers results in the order the messages arrived.
+                // Requires `mtx_` to be locked.
+                void deliver_ready() {
+                    while (!ready_.empty() && ready_.begin()->first == next_delivery_) {
+                        auto &front = ready_.begin()->second;
+                        front.first.deliver(std::move(front.second));
+                        ready_.erase(ready_.begin());
+                        ++next_delivery_;
+                    }
+                }
+
+                void bind_arguments(slot &, detail::int_list<>) {
+                    // nop
+                }
+
+                template<long I, long... Is>
+                void bind_arguments(slot &s, detail::int_list<I, Is...>) {
+                    using arg_type = typename detail::tl_at<processing_list, I>::type;
+                    bind<I, arg_type::in_pos>(std::get<I>(kernel_signature_), s);
+                    bind_arguments(s, detail::int_list<Is...> {});
+                }
+
+                // Returns the buffer for argument I, growing it if required.
+                template<long I>
+                cl_mem reserve(slot &s, size_t num_bytes, cl_mem_flags flags) {
+                    if (s.capacity[I] < num_bytes) {
+                        s.buffers[I].reset(device_->memory().create_buffer(flags, num_bytes), false);
+                        s.capacity[I] = num_bytes;
+                    }
+                    return s.buffers[I].get();
+                }
+
+                template<long I, int InPos, class T>
+                void bind(const in<T, val> &, slot &s) {
+                    using value_type = typename detail::tl_at<unpacked_types, I>::type;
+                    auto &container = s.msg.get_as<std::vector<value_type>>(InPos);
+                    auto num_bytes = sizeof(value_type) * container.size();
+                    auto buffer = reserve<I>(s, num_bytes, buffer_type::input);
+                    auto event = v1get<cl_event>(ACTOR_CLF(clEnqueueWriteBuffer), upload_queue_.get(), buffer,
+                                                 cl_bool {CL_FALSE}, size_t {0}, num_bytes, container.data());
+                    device_->counters().bytes_uploaded += num_bytes;
+                    s.uploads.push_back(event);
+                    v1callcl(ACTOR_CLF(clSetKernelArg), kernel_.get(), static_cast<unsigned>(I), sizeof(cl_mem),
+                             static_cast<const void *>(&buffer));
+                }
+
+                template<long I, int InPos, class T, class F>
+                void bind(const out<T, val, F> &wrapper, slot &s) {
+                    using value_type = typename detail::tl_at<unpacked_types, I>::type;
+                    auto length = wrapper(s.msg);
+                    auto len = length && *length > 0 ? *length : default_length_;
+                    s.lengths[I] = len;
+                    auto buffer = reserve<I>(s, sizeof(value_type) * len, buffer_type::output);
+                    v1callcl(ACTOR_CLF(clSetKernelArg), kernel_.get(), static_cast<unsigned>(I), sizeof(cl_mem),
+                             static_cast<const void *>(&buffer));
+                }
+
+                template<long I, int InPos, class T, class F>
+                void bind(const local<T, F> &wrapper, slot &s) {
+                    using value_type = typename detail::tl_at<unpacked_types, I>::type;
+                    auto num_bytes = sizeof(value_type) * wrapper(s.msg);
+                    v1callcl(ACTOR_CLF(clSetKernelArg), kernel_.get(), static_cast<unsigned>(I), num_bytes, nullptr);
+                }
+
+                template<long I, int InPos, class T, class F>
+                void bind(const priv<T, val, F> &, slot &s) {
+                    using value_type = typename detail::tl_at<unpacked_types, I>::type;
+                    auto &value = s.msg.get_as<value_type>(InPos);
+                    v1callcl(ACTOR_CLF(clSetKernelArg), kernel_.get(), static_cast<unsigned>(I), sizeof(value_type),
+                             static_cast<const void *>(&value));
+                }
+
+                template<long I, int InPos, class T, class F>
+                void bind(const priv<T, hidden, F> &wrapper, slot &s) {
+                    auto value = wrapper(s.msg);
+                    v1callcl(ACTOR_CLF(clSetKernelArg), kernel_.get(), static_cast<unsigned>(I), sizeof(T),
+                             static_cast<const void *>(&value));
+                }
+
+                template<long I, int InPos, class T, size_t Dim>
+                void bind(const real_size<T, Dim> &, slot &) {
+                    auto &dims = range_.real_dimensions();
+                    auto value = static_cast<T>(Dim < dims.size() ? dims[Dim] : 1);
+                    v1callcl(ACTOR_CLF(clSetKernelArg), kernel_.get(), static_cast<unsigned>(I), sizeof(T),
+                             static_cast<const void *>(&value));
+                }
+
+                void enqueue_downloads(slot &, detail::int_list<>) {
+                    // nop
+                }
+
+                template<long I, long... Is>
+                void enqueue_downloads(slot &s, detail::int_list<I, Is...>) {
+                    using arg_type = typename detail::tl_at<processing_list, I>::type;
+                    download<I, arg_type::out_pos>(std::get<I>(kernel_signature_), s);
+                    enqueue_downloads(s, detail::int_list<Is...> {});
+                }
+
+                template<long I, int OutPos, class T, class F>
+                void download(const out<T, val, F> &, slot &s) {
+                    auto &result = std::get<OutPos>(s.results);
+                    result.resize(s.lengths[I]);
+                    auto kernel_event = s.kernel_event.get();
+                    cl_event event;
+                    v1callcl(ACTOR_CLF(clEnqueueReadBuffer), download_queue_.get(), s.buffers[I].get(), CL_FALSE,
+                             size_t {0}, sizeof(T) * result.size(), result.data(), cl_uint {1}, &kernel_event, &event);
+                    device_->counters().bytes_downloaded += sizeof(T) * result.size();
+                    s.downloads.push_back(event);
+                }
+
+                template<long I, int OutPos, class Wrapper>
+                void download(const Wrapper &, slot &) {
+                    // nothing to read back
+                }
+
+                detail::raw_kernel_ptr kernel_;
+                device_ptr device_;
+                detail::raw_command_queue_ptr upload_queue_;
+                detail::raw_command_queue_ptr compute_queue_;
+                detail::raw_command_queue_ptr download_queue_;
+                completion_executor *executor_;
+                nd_range range_;
+                std::tuple<Ts...> kernel_signature_;
+                size_t default_length_;
+                std::mutex mtx_;
+                std::vector<slot> slots_;
+                size_t next_slot_;
+                size_t next_seq_;
+                size_t next_delivery_;
+                std::deque<std::pair<message, response_promise>> backlog_;
+                std::map<size_t, std::pair<response_promise, message>> ready_;
+            };
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,185 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+
+#include <nil/actor/sec.hpp>
+#include <nil/actor/actor.hpp>
+#include <nil/actor/logger.hpp>
+#include <nil/actor/stream.hpp>
+#include <nil/actor/scheduled_actor.hpp>
+#include <nil/actor/make_stage_result.hpp>
+#include <nil/actor/stream_stage_driver.hpp>
+#include <nil/actor/broadcast_downstream_manager.hpp>
+
+#include <nil/actor/detail/stream_stage_impl.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// Configures how a GPU stage coalesces stream elements into kernel launches.
+            struct stage_config {
+                /// Number of elements sent to the kernel actor per launch.
+                size_t batch_size = 1024;
+
+                /// Maximum number of launches in flight. Should match the number of
+                /// messages the kernel actor processes concurrently, e.g., the depth of
+                /// a streaming facade.
+                size_t max_in_flight = 2;
+            };
+
+            /// Stream driver for a stage that forwards batches of elements to an actor
+            /// running a kernel with the signature `in<In>, out<Out>`. Every batch has
+            /// exactly `batch_size` elements, a partial batch is padded with
+            /// value-initialized elements and its result trimmed to the elements sent.
+            /// Hence, workers with a range fixed at spawn time never read past their
+            /// input. Upstream credit is limited to the elements that fit into
+            /// `max_in_flight` launches, which bounds the memory held by the stage and
+            /// by the device. A failed launch aborts the stage.
+            template<class In, class Out>
+            class gpu_stage_driver final : public stream_stage_driver<In, broadcast_downstream_manager<Out>> {
+            public:
+                using super = stream_stage_driver<In, broadcast_downstream_manager<Out>>;
+
+                using batch_type = std::vector<In>;
+
+                using result_type = std::vector<Out>;
+
+                gpu_stage_driver(broadcast_downstream_manager<Out> &out, scheduled_actor *self, actor worker,
+                                 stage_config cfg) :
+                    super(out),
+                    self_(self), worker_(std::move(worker)), cfg_(cfg), in_flight_(0), next_seq_(0),
+                    next_delivery_(0), failed_(false) {
+                    cfg_.batch_size = std::max(cfg_.batch_size, size_t {1});
+                    cfg_.max_in_flight = std::max(cfg_.max_in_flight, size_t {1});
+                }
+
+                void process(downstream<Out> &, batch_type &batch) override {
+                    if (failed_) {
+                        return;
+                    }
+                    pending_.insert(pending_.end(), std::make_move_iterator(batch.begin()),
+                                    std::make_move_iterator(batch.end()));
+                    launch();
+                }
+
+                int32_t acquire_credit(inbound_path *, int32_t desired) override {
+                    auto capacity = cfg_.batch_size * cfg_.max_in_flight;
+                    auto used = pending_.size() + in_flight_ * cfg_.batch_size;
+                    if (used >= capacity) {
+                        return 0;
+                    }
+                    return static_cast<int32_t>(std::min(static_cast<size_t>(desired), capacity - used));
+                }
+
+            private:
+                // Launches full batches while the in-flight limit permits. A partial
+                // batch is only launched if the device would be idle otherwise.
+                void launch() {
+                    auto mgr = this->out_.parent();
+                    while (!pending_.empty() && in_flight_ < cfg_.max_in_flight &&
+                           (pending_.size() >= cfg_.batch_size || in_flight_ == 0)) {
+                        auto n = std::min(pending_.size(), cfg_.batch_size);
+                        auto first = pending_.begin();
+                        auto last = first + static_cast<std::ptrdiff_t>(n);
+                        batch_type chunk {std::make_move_iterator(first), std::make_move_iterator(last)};
+                        pending_.erase(first, last);
+                        // the worker always processes a full batch
+                        chunk.resize(cfg_.batch_size);
+                        auto seq = next_seq_++;
+                        ++in_flight_;
+                        // keep the stage alive until all results arrived
+                        mgr->continuous(true);
+                        stream_manager_ptr guard {mgr};
+                        self_->request(worker_, infinite, std::move(chunk))
+                            .then([this, guard, seq, n](result_type &res) { complete(seq, n, std::move(res)); },
+                                  [this, guard](error &err) { fail(std::move(err)); });
+                    }
+                }
+
+                void complete(size_t seq, size_t n, result_type res) {
+                    if (failed_) {
+                        return;
+                    }
+                    if (res.size() < n) {
+                        fail(make_error(sec::runtime_error, "GPU stage worker returned too few elements"));
+                        return;
+                    }
+                    // drop the results of padding elements
+                    res.resize(n);
+                    --in_flight_;
+                    ready_.emplace(seq, std::move(res));
+                    // results are emitted in the order of the launches
+                    while (!ready_.empty() && ready_.begin()->first == next_delivery_) {
+                        for (auto &x : ready_.begin()->second) {
+                            this->out_.push(std::move(x));
+                        }
+                        ready_.erase(ready_.begin());
+                        ++next_delivery_;
+                    }
+                    launch();
+                    auto mgr = this->out_.parent();
+                    if (in_flight_ == 0 && pending_.empty()) {
+                        mgr->continuous(false);
+                    }
+                    mgr->push();
+                }
+
+                // Aborts the stage, since a lost batch would leave a gap in the stream.
+                void fail(error err) {
+                    if (failed_) {
+                        return;
+                    }
+                    ACTOR_LOG_ERROR("GPU stage failed to process a batch:" << ACTOR_ARG(err));
+                    failed_ = true;
+                    pending_.clear();
+                    ready_.clear();
+                    auto mgr = this->out_.parent();
+                    mgr->continuous(false);
+                    mgr->abort(std::move(err));
+                }
+
+                scheduled_actor *self_;
+                actor worker_;
+                stage_config cfg_;
+                size_t in_flight_;
+                size_t next_seq_;
+                size_t next_delivery_;
+                bool failed_;
+                std::deque<In> pending_;
+                std::map<size_t, result_type> ready_;
+            };
+
+            /// Attaches a stream stage to `self` that processes the elements of `in` on
+            /// the device by sending them in batches to `worker`, an actor accepting a
+            /// `std::vector<In>` of `cfg.batch_size` elements and replying with a
+            /// `std::vector<Out>` of at least as many elements, usually an actor facade
+            /// or streaming facade with a range of `cfg.batch_size` work items.
+            /// Elements are emitted downstream in their original order.
+            template<class Out, class In>
+            make_stage_result_t<In, broadcast_downstream_manager<Out>>
+                attach_gpu_stage(scheduled_actor *self, const stream<In> &in, actor worker, stage_config cfg = {}) {
+                using driver = gpu_stage_driver<In, Out>;
+                auto mgr = detail::make_stream_stage<driver>(self, self, std::move(worker), cfg);
+                auto in_slot = mgr->add_inbound_path(in);
+                auto out_slot = mgr->add_outbound_path();
+                return {in_slot, out_slot, std::move(mgr)};
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
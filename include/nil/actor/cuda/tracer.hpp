@@ -0,0 +1,98 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+#include <nil/actor/cuda/global.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            /// Records spans on the timelines of the host and of the devices into a
+            /// ring buffer that overwrites the oldest spans once full. Recording is
+            /// lock-free and safe from any thread, a span is dropped if its slot is
+            /// still being written after the buffer wrapped around. Device spans are
+            /// taken from the profiling info of OpenCL events and converted to the
+            /// host clock. `write` produces the Chrome trace format, which
+            /// chrome://tracing and Perfetto display.
+            class tracer {
+            public:
+                /// The track of the host, the track of a device is its id + 1.
+                static constexpr uint32_t host_track = 0;
+
+                /// Creates a tracer that keeps the last `capacity` spans.
+                explicit tracer(size_t capacity);
+
+                tracer(const tracer &) = delete;
+
+                tracer &operator=(const tracer &) = delete;
+
+                /// Returns the time on the host clock in nanoseconds since the tracer
+                /// was created.
+                uint64_t now() const;
+
+                /// Returns a new id to correlate the spans of a command.
+                uint64_t next_id();
+
+                /// Records a span from `begin` to `end` on the host clock. Names are
+                /// truncated to 47 characters, `category` must be a string literal.
+                void record(const char *name, const char *category, uint32_t track, uint64_t begin, uint64_t end,
+                            uint64_t id);
+
+                /// Records the execution of `event` on the track of device `device_id`,
+                /// which must be complete. The device clock is converted with `offset`,
+                /// the difference between the host clock and the device clock. Names
+                /// the span after the command type of `event` if `name` is `nullptr`.
+                /// Does nothing if the event has no profiling info.
+                void record(cl_event event, const char *name, unsigned device_id, int64_t offset, uint64_t id);
+
+                /// Returns the difference between the host clock at `enqueued` and the
+                /// device clock at which `event` was queued, or 0 without profiling info.
+                static int64_t offset(cl_event event, uint64_t enqueued);
+
+                /// Returns the number of spans currently held.
+                size_t size() const;
+
+                /// Writes all spans held as a Chrome trace JSON object.
+                void write(std::ostream &out) const;
+
+            private:
+                struct span {
+                    char name[48];
+                    const char *category;
+                    uint32_t track;
+                    uint32_t thread;
+                    uint64_t begin;
+                    uint64_t end;
+                    uint64_t id;
+                };
+
+                // odd sequence numbers mark slots that are being written
+                struct slot {
+                    std::atomic<uint64_t> sequence;
+                    span value;
+                };
+
+                std::chrono::steady_clock::time_point start_;
+                size_t capacity_;
+                std::unique_ptr<slot[]> slots_;
+                std::atomic<uint64_t> next_;
+                std::atomic<uint64_t> ids_;
+            };
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,27 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace nil {
+    namespace actor {
+        namespace detail {
+
+            /// Computes a 64 bit content hash of `num_bytes` bytes starting at `data`.
+            /// The bulk of the input is consumed in four independent 64 bit lanes
+            /// (32 bytes per round), which lets the compiler keep all lanes in vector
+            /// registers. Not suitable for cryptographic purposes.
+            uint64_t hash_bytes(const void *data, size_t num_bytes, uint64_t seed = 0);
+
+        }    // namespace detail
+    }        // namespace actor
+}    // namespace nil
@@ -45,3 +45,5 @@ ACTOR_OPENCL_PTR_ALIAS(raw_program_ptr, cl_program, clRetainProgram, clReleasePr
 ACTOR_OPENCL_PTR_ALIAS(raw_device_ptr, cl_device_id, clRetainDeviceDummy, clReleaseDeviceDummy)
 
 ACTOR_OPENCL_PTR_ALIAS(raw_command_queue_ptr, cl_command_queue, clRetainCommandQueue, clReleaseCommandQueue)
+
+ACTOR_OPENCL_PTR_ALIAS(raw_sampler_ptr, cl_sampler, clRetainSampler, clReleaseSampler)
@@ -0,0 +1,156 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#pragma once
+
+#include <new>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+#include <nil/actor/config.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace detail {
+
+            /// A vector with a capacity fixed at compile time that keeps its elements
+            /// inline, i.e., never allocates. Used for the per-message bookkeeping of
+            /// OpenCL actors where the maximum number of elements follows from the
+            /// kernel signature.
+            template<class T, size_t N>
+            class static_vector {
+            public:
+                using value_type = T;
+                using iterator = T *;
+                using const_iterator = const T *;
+
+                static_vector() : size_(0) {
+                    // nop
+                }
+
+                static_vector(const static_vector &other) : size_(0) {
+                    for (auto &x : other) {
+                        push_back(x);
+                    }
+                }
+
+                static_vector(static_vector &&other) : size_(0) {
+                    for (auto &x : other) {
+                        push_back(std::move(x));
+                    }
+                    other.clear();
+                }
+
+                static_vector &operator=(const static_vector &other) {
+                    if (this != &other) {
+                        clear();
+                        for (auto &x : other) {
+                            push_back(x);
+                        }
+                    }
+                    return *this;
+                }
+
+                static_vector &operator=(static_vector &&other) {
+                    if (this != &other) {
+                        clear();
+                        for (auto &x : other) {
+                            push_back(std::move(x));
+                        }
+                        other.clear();
+                    }
+                    return *this;
+                }
+
+                ~static_vector() {
+                    clear();
+                }
+
+                template<class... Us>
+                T &emplace_back(Us &&... xs) {
+                    ACTOR_ASSERT(size_ < N);
+                    auto ptr = new (data() + size_) T(std::forward<Us>(xs)...);
+                    ++size_;
+                    return *ptr;
+                }
+
+                void push_back(const T &x) {
+                    emplace_back(x);
+                }
+
+                void push_back(T &&x) {
+                    emplace_back(std::move(x));
+                }
+
+                void clear() {
+                    for (size_t i = 0; i < size_; ++i) {
+                        data()[i].~T();
+                    }
+                    size_ = 0;
+                }
+
+                T *data() {
+                    return reinterpret_cast<T *>(&storage_[0]);
+                }
+
+                const T *data() const {
+                    return reinterpret_cast<const T *>(&storage_[0]);
+                }
+
+                size_t size() const {
+                    return size_;
+                }
+
+                static constexpr size_t capacity() {
+                    return N;
+                }
+
+                bool empty() const {
+                    return size_ == 0;
+                }
+
+                T &operator[](size_t pos) {
+                    return data()[pos];
+                }
+
+                const T &operator[](size_t pos) const {
+                    return data()[pos];
+                }
+
+                T &back() {
+                    return data()[size_ - 1];
+                }
+
+                iterator begin() {
+                    return data();
+                }
+
+                iterator end() {
+                    return data() + size_;
+                }
+
+                const_iterator begin() const {
+                    return data();
+                }
+
+                const_iterator end() const {
+                    return data() + size_;
+                }
+
+            private:
+                using storage_type = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+                storage_type storage_[N > 0 ? N : 1];
+                size_t size_;
+            };
+
+        }    // namespace detail
+    }        // namespace actor
+}    // namespace nil
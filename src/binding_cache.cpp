@@ -0,0 +1,62 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <cstring>
+
+#include <nil/actor/cuda/opencl_error.hpp>
+#include <nil/actor/cuda/binding_cache.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            binding_cache::binding_cache(size_t num_args, device_counters &counters) :
+                bindings_(num_args), counters_(&counters) {
+                // nop
+            }
+
+            void binding_cache::set(cl_kernel kernel, cl_uint index, size_t size, const void *value) {
+                auto &x = bindings_[index];
+                auto local = value == nullptr;
+                if (x.valid && x.local == local && x.size == size
+                    && (local || std::memcmp(x.bytes.data(), value, size) == 0)) {
+                    ++counters_->arg_sets_skipped;
+                    return;
+                }
+                // forget the old value first in case the call fails
+                x.valid = false;
+                v1callcl(ACTOR_CLF(clSetKernelArg), kernel, index, size, value);
+                ++counters_->arg_sets;
+                x.local = local;
+                x.size = size;
+                if (local) {
+                    // only the size of local memory matters
+                    x.bytes.clear();
+                } else {
+                    auto first = static_cast<const char *>(value);
+                    x.bytes.assign(first, first + size);
+                }
+                x.valid = true;
+            }
+
+            void binding_cache::set_mem(cl_kernel kernel, cl_uint index, cl_mem mem) {
+                bindings_[index].valid = false;
+                v1callcl(ACTOR_CLF(clSetKernelArg), kernel, index, sizeof(cl_mem), static_cast<const void *>(&mem));
+                ++counters_->arg_sets;
+            }
+
+            void binding_cache::clear() {
+                for (auto &x : bindings_) {
+                    x.valid = false;
+                }
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
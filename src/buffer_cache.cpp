@@ -0,0 +1,216 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <cstring>
+
+#include <nil/actor/logger.hpp>
+
+#include <nil/actor/detail/buffer_hash.hpp>
+
+#include <nil/actor/cuda/buffer_cache.hpp>
+#include <nil/actor/cuda/opencl_error.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace detail {
+
+            namespace {
+
+                constexpr uint64_t prime_1 = 0x9E3779B185EBCA87ULL;
+                constexpr uint64_t prime_2 = 0xC2B2AE3D27D4EB4FULL;
+                constexpr uint64_t prime_3 = 0x165667B19E3779F9ULL;
+                constexpr uint64_t prime_4 = 0x85EBCA77C2B2AE63ULL;
+                constexpr uint64_t prime_5 = 0x27D4EB2F165667C5ULL;
+
+                inline uint64_t rotl(uint64_t x, int r) {
+                    return (x << r) | (x >> (64 - r));
+                }
+
+                inline uint64_t load64(const unsigned char *p) {
+                    uint64_t x;
+                    memcpy(&x, p, sizeof(x));
+                    return x;
+                }
+
+                inline uint32_t load32(const unsigned char *p) {
+                    uint32_t x;
+                    memcpy(&x, p, sizeof(x));
+                    return x;
+                }
+
+                inline uint64_t mix_round(uint64_t acc, uint64_t input) {
+                    acc += input * prime_2;
+                    acc = rotl(acc, 31);
+                    return acc * prime_1;
+                }
+
+                inline uint64_t merge_round(uint64_t acc, uint64_t lane) {
+                    acc ^= mix_round(0, lane);
+                    return acc * prime_1 + prime_4;
+                }
+
+            }    // namespace
+
+            uint64_t hash_bytes(const void *data, size_t num_bytes, uint64_t seed) {
+                auto p = static_cast<const unsigned char *>(data);
+                auto end = p + num_bytes;
+                uint64_t h;
+                if (num_bytes >= 32) {
+                    uint64_t lanes[4] = {seed + prime_1 + prime_2, seed + prime_2, seed, seed - prime_1};
+                    auto limit = end - 32;
+                    do {
+                        // the lanes are independent, allowing the loop body to vectorize
+                        for (int i = 0; i < 4; ++i) {
+                            lanes[i] = mix_round(lanes[i], load64(p + 8 * i));
+                        }
+                        p += 32;
+                    } while (p <= limit);
+                    h = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+                    for (auto lane : lanes) {
+                        h = merge_round(h, lane);
+                    }
+                } else {
+                    h = seed + prime_5;
+                }
+                h += static_cast<uint64_t>(num_bytes);
+                for (; p + 8 <= end; p += 8) {
+                    h ^= mix_round(0, load64(p));
+                    h = rotl(h, 27) * prime_1 + prime_4;
+                }
+                if (p + 4 <= end) {
+                    h ^= static_cast<uint64_t>(load32(p)) * prime_1;
+                    h = rotl(h, 23) * prime_2 + prime_3;
+                    p += 4;
+                }
+                for (; p < end; ++p) {
+                    h ^= (*p) * prime_5;
+                    h = rotl(h, 11) * prime_1;
+                }
+                h ^= h >> 33;
+                h *= prime_2;
+                h ^= h >> 29;
+                h *= prime_3;
+                h ^= h >> 32;
+                return h;
+            }
+
+        }    // namespace detail
+
+        namespace cuda {
+
+            buffer_cache::buffer_cache(size_t budget) : budget_(budget), size_(0), hits_(0), misses_(0) {
+                // nop
+            }
+
+            buffer_cache::entry buffer_cache::lookup_or_upload(memory_accountant &memory,
+                                                               const detail::raw_command_queue_ptr &queue,
+                                                               const void *data, size_t num_bytes) {
+                key k {detail::hash_bytes(data, num_bytes), num_bytes};
+                std::unique_lock<std::mutex> guard {mtx_};
+                auto i = index_.find(k);
+                // the hash only narrows the search, the bytes decide
+                auto same = [&](const slot &x) { return std::memcmp(x.bytes.data(), data, num_bytes) == 0; };
+                if (i != index_.end() && same(*i->second)) {
+                    ++hits_;
+                    lru_.splice(lru_.begin(), lru_, i->second);
+                    auto &e = i->second->value;
+                    // stop tracking the upload once it is known to be done
+                    if (e.event) {
+                        cl_int status;
+                        auto err = clGetEventInfo(e.event.get(), CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int),
+                                                  &status, nullptr);
+                        if (err == CL_SUCCESS && status == CL_COMPLETE) {
+                            e.event.reset();
+                        }
+                    }
+                    return e;
+                }
+                ++misses_;
+                auto budget = budget_;
+                guard.unlock();
+                auto buffer = memory.create_buffer(cl_mem_flags {CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY}, num_bytes);
+                entry result {detail::raw_mem_ptr {buffer, false}, nullptr};
+                auto event = v1get<cl_event>(ACTOR_CLF(clEnqueueWriteBuffer), queue.get(), buffer, cl_bool {CL_FALSE},
+                                             size_t {0}, num_bytes, data);
+                result.event.reset(event, false);
+                if (num_bytes > budget) {
+                    // too large to ever fit, hand out without caching it
+                    return result;
+                }
+                guard.lock();
+                // another actor may have uploaded the same data in the meantime, data
+                // with a colliding hash keeps its slot
+                if (index_.count(k) == 0) {
+                    if (size_ + num_bytes > budget_) {
+                        evict_locked(size_ + num_bytes - budget_);
+                    }
+                    auto first = static_cast<const char *>(data);
+                    lru_.push_front(slot {k, result, std::vector<char>(first, first + num_bytes)});
+                    index_.emplace(k, lru_.begin());
+                    size_ += num_bytes;
+                }
+                return result;
+            }
+
+            size_t buffer_cache::evict(size_t num_bytes) {
+                std::lock_guard<std::mutex> guard {mtx_};
+                return evict_locked(num_bytes);
+            }
+
+            size_t buffer_cache::evict_locked(size_t num_bytes) {
+                size_t released = 0;
+                while (released < num_bytes && !lru_.empty()) {
+                    auto &last = lru_.back();
+                    released += last.id.num_bytes;
+                    index_.erase(last.id);
+                    lru_.pop_back();
+                }
+                size_ -= released;
+                ACTOR_LOG_DEBUG("evicted cached device buffers:" << ACTOR_ARG(released));
+                return released;
+            }
+
+            void buffer_cache::clear() {
+                std::lock_guard<std::mutex> guard {mtx_};
+                lru_.clear();
+                index_.clear();
+                size_ = 0;
+            }
+
+            void buffer_cache::budget(size_t num_bytes) {
+                std::lock_guard<std::mutex> guard {mtx_};
+                budget_ = num_bytes;
+                if (size_ > budget_) {
+                    evict_locked(size_ - budget_);
+                }
+            }
+
+            size_t buffer_cache::budget() const {
+                std::lock_guard<std::mutex> guard {mtx_};
+                return budget_;
+            }
+
+            size_t buffer_cache::size_in_bytes() const {
+                std::lock_guard<std::mutex> guard {mtx_};
+                return size_;
+            }
+
+            size_t buffer_cache::hits() const {
+                std::lock_guard<std::mutex> guard {mtx_};
+                return hits_;
+            }
+
+            size_t buffer_cache::misses() const {
+                std::lock_guard<std::mutex> guard {mtx_};
+                return misses_;
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,124 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+#include <nil/actor/raise_error.hpp>
+
+#include <nil/actor/cuda/chunk_scheduler.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            namespace {
+
+                // weight of a new measurement in the moving average
+                constexpr double throughput_alpha = 0.3;
+
+                double seconds(chunk_scheduler::clock::duration x) {
+                    return std::chrono::duration<double>(x).count();
+                }
+
+            }    // namespace
+
+            chunk_scheduler::chunk_scheduler(std::vector<double> weights, size_t min_chunk) :
+                weights_(std::move(weights)), throughput_(weights_.size(), 0.0),
+                min_chunk_(std::max(min_chunk, size_t {1})), next_id_(0), next_item_(0), num_items_(0), remaining_(0) {
+                if (weights_.empty()) {
+                    ACTOR_RAISE_ERROR("chunk_scheduler requires at least one worker");
+                }
+                for (auto &x : weights_) {
+                    x = std::max(x, 0.0);
+                }
+            }
+
+            void chunk_scheduler::reset(size_t num_items) {
+                chunks_.clear();
+                next_item_ = 0;
+                num_items_ = num_items;
+                remaining_ = num_items;
+            }
+
+            double chunk_scheduler::share(size_t worker) const {
+                auto measured = std::all_of(throughput_.begin(), throughput_.end(), [](double x) { return x > 0; });
+                auto &xs = measured ? throughput_ : weights_;
+                auto total = std::accumulate(xs.begin(), xs.end(), 0.0);
+                return total > 0 ? xs[worker] / total : 1.0 / static_cast<double>(xs.size());
+            }
+
+            optional<chunk_scheduler::chunk> chunk_scheduler::next(size_t worker, clock::time_point now) {
+                if (next_item_ < num_items_) {
+                    // guided self-scheduling: chunks shrink as the job drains, which
+                    // bounds the time the last chunk keeps the other workers waiting
+                    auto left = num_items_ - next_item_;
+                    auto size = static_cast<size_t>(static_cast<double>(left) * share(worker) / 2);
+                    size = std::min(std::max(size, min_chunk_), left);
+                    chunks_.push_back(entry {next_id_++, next_item_, size, {run {worker, now}}, false});
+                    next_item_ += size;
+                    auto &x = chunks_.back();
+                    return chunk {x.id, x.first, x.count};
+                }
+                // steal the chunk expected to finish last, if this worker is faster
+                entry *victim = nullptr;
+                double victim_left = 0;
+                for (auto &x : chunks_) {
+                    if (x.done || x.runs.size() != 1 || x.runs.front().worker == worker) {
+                        continue;
+                    }
+                    auto &owner = x.runs.front();
+                    auto rate = throughput_[owner.worker];
+                    auto left = rate > 0 ? static_cast<double>(x.count) / rate - seconds(now - owner.start) :
+                                           std::numeric_limits<double>::infinity();
+                    if (victim == nullptr || left > victim_left) {
+                        victim = &x;
+                        victim_left = left;
+                    }
+                }
+                if (victim == nullptr) {
+                    return none;
+                }
+                auto rate = throughput_[worker];
+                if (rate > 0 && static_cast<double>(victim->count) / rate >= victim_left) {
+                    return none;
+                }
+                victim->runs.push_back(run {worker, now});
+                return chunk {victim->id, victim->first, victim->count};
+            }
+
+            bool chunk_scheduler::complete(size_t worker, size_t id, clock::time_point now) {
+                auto i = std::find_if(chunks_.begin(), chunks_.end(), [&](const entry &x) { return x.id == id; });
+                if (i == chunks_.end()) {
+                    return false;
+                }
+                auto r = std::find_if(i->runs.begin(), i->runs.end(), [&](const run &x) { return x.worker == worker; });
+                if (r == i->runs.end()) {
+                    return false;
+                }
+                // the losing run of a stolen chunk still measures its worker
+                auto elapsed = seconds(now - r->start);
+                if (elapsed > 0) {
+                    auto rate = static_cast<double>(i->count) / elapsed;
+                    auto &x = throughput_[worker];
+                    x = x > 0 ? (1 - throughput_alpha) * x + throughput_alpha * rate : rate;
+                }
+                i->runs.erase(r);
+                if (i->done) {
+                    return false;
+                }
+                i->done = true;
+                remaining_ -= i->count;
+                return true;
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
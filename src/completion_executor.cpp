@@ -0,0 +1,187 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
+
+#include <nil/actor/logger.hpp>
+
+#include <nil/actor/cuda/completion_executor.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            namespace {
+
+                class stub_job : public completion_executor::job {
+                public:
+                    void run() override {
+                        // nop
+                    }
+                };
+
+            }    // namespace
+
+            completion_executor::job::job() : next_(nullptr) {
+                // nop
+            }
+
+            completion_executor::job::~job() {
+                // nop
+            }
+
+            /// A thread with an intrusive MPSC queue as described by Dmitry Vyukov.
+            struct completion_executor::worker {
+                std::atomic<job *> head;
+                job *tail;
+                stub_job stub;
+                std::atomic<bool> sleeping;
+                std::mutex mtx;
+                std::condition_variable cv;
+                std::thread thread;
+
+                worker() : head(&stub), tail(&stub), sleeping(false) {
+                    // nop
+                }
+
+                void push(job *x) {
+                    x->next_.store(nullptr, std::memory_order_relaxed);
+                    auto prev = head.exchange(x, std::memory_order_acq_rel);
+                    prev->next_.store(x, std::memory_order_release);
+                }
+
+                // Returns nullptr if the queue is empty or a push is in progress.
+                job *pop() {
+                    auto t = tail;
+                    auto next = t->next_.load(std::memory_order_acquire);
+                    if (t == &stub) {
+                        if (next == nullptr) {
+                            return nullptr;
+                        }
+                        tail = next;
+                        t = next;
+                        next = next->next_.load(std::memory_order_acquire);
+                    }
+                    if (next != nullptr) {
+                        tail = next;
+                        return t;
+                    }
+                    if (t != head.load(std::memory_order_acquire)) {
+                        return nullptr;
+                    }
+                    push(&stub);
+                    next = t->next_.load(std::memory_order_acquire);
+                    if (next != nullptr) {
+                        tail = next;
+                        return t;
+                    }
+                    return nullptr;
+                }
+            };
+
+            completion_executor::completion_executor(size_t num_threads) :
+                next_worker_(0), running_(false), submitters_(0) {
+                for (size_t i = 0; i < num_threads; ++i) {
+                    workers_.emplace_back(new worker);
+                }
+            }
+
+            completion_executor::~completion_executor() {
+                stop();
+            }
+
+            void completion_executor::start() {
+                if (running_.exchange(true)) {
+                    return;
+                }
+                for (auto &w : workers_) {
+                    auto ptr = w.get();
+                    w->thread = std::thread {[this, ptr] { run_worker(*ptr); }};
+                }
+            }
+
+            void completion_executor::stop() {
+                if (!running_.exchange(false)) {
+                    return;
+                }
+                // a submitter that saw the executor running must finish its push
+                // before the final drain, later submitters run their jobs inline
+                while (submitters_.load() != 0) {
+                    std::this_thread::yield();
+                }
+                for (auto &w : workers_) {
+                    {
+                        std::lock_guard<std::mutex> guard {w->mtx};
+                        w->cv.notify_one();
+                    }
+                    w->thread.join();
+                    // run leftovers, jobs hold references that must be released
+                    while (auto x = w->pop()) {
+                        x->run();
+                    }
+                }
+            }
+
+            void completion_executor::submit(job *x) {
+                if (workers_.empty()) {
+                    x->run();
+                    return;
+                }
+                // announce the submission before checking the flag, stop checks them
+                // in the opposite order, hence both use sequentially consistent ordering
+                ++submitters_;
+                if (!running_.load()) {
+                    --submitters_;
+                    x->run();
+                    return;
+                }
+                auto &w = *workers_[next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size()];
+                w.push(x);
+                if (w.sleeping.load()) {
+                    std::lock_guard<std::mutex> guard {w.mtx};
+                    w.cv.notify_one();
+                }
+                --submitters_;
+            }
+
+            size_t completion_executor::num_threads() const {
+                return workers_.size();
+            }
+
+            void completion_executor::run_worker(worker &w) {
+                ACTOR_LOG_TRACE("");
+                for (;;) {
+                    if (auto x = w.pop()) {
+                        x->run();
+                        continue;
+                    }
+                    if (!running_.load(std::memory_order_acquire)) {
+                        return;
+                    }
+                    std::unique_lock<std::mutex> guard {w.mtx};
+                    w.sleeping.store(true);
+                    // re-check after announcing the sleep to not miss a notification
+                    if (auto x = w.pop()) {
+                        w.sleeping.store(false);
+                        guard.unlock();
+                        x->run();
+                        continue;
+                    }
+                    // the timeout covers pushes that were still in progress above
+                    w.cv.wait_for(guard, std::chrono::milliseconds(10));
+                    w.sleeping.store(false);
+                }
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
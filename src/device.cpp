@@ -23,11 +23,12 @@ namespace nil {
         namespace cuda {
 
             device_ptr device::create(const detail::raw_context_ptr &context, const detail::raw_device_ptr &device_id,
-                                      unsigned id) {
+                                      unsigned id, tracer *trace) {
                 ACTOR_LOG_DEBUG("creating device for opencl device with id:" << ACTOR_ARG(id));
                 // look up properties we need to create the command queue
                 auto supported = info<cl_ulong>(device_id, CL_DEVICE_QUEUE_PROPERTIES);
-                bool profiling = false;    // (supported & CL_QUEUE_PROFILING_ENABLE) != 0u;
+                // profiling adds overhead to every command, hence only when tracing
+                bool profiling = trace != nullptr && (supported & CL_QUEUE_PROFILING_ENABLE) != 0u;
                 bool out_of_order = (supported & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) != 0u;
                 unsigned properties = profiling ? CL_QUEUE_PROFILING_ENABLE : 0;
                 if (out_of_order) {
@@ -38,6 +39,9 @@ namespace nil {
                     v2get(ACTOR_CLF(clCreateCommandQueue), context.get(), device_id.get(), properties), false};
                 // create the device
                 auto dev = make_counted<device>(device_id, std::move(command_queue), context, id);
+                dev->profiling_enabled_ = profiling;
+                dev->out_of_order_execution_ = out_of_order;
+                dev->trace_ = profiling ? trace : nullptr;
                 // device dev{device_id, std::move(command_queue), context, id};
                 // look up device properties
                 dev->address_bits_ = info<cl_uint>(device_id, CL_DEVICE_ADDRESS_BITS);
@@ -46,6 +50,15 @@ namespace nil {
                 dev->global_mem_cacheline_size_ = info<cl_uint>(device_id, CL_DEVICE_GLOBAL_MEM_CACHELINE_SIZE);
                 dev->global_mem_size_ = info<cl_ulong>(device_id, CL_DEVICE_GLOBAL_MEM_SIZE);
                 dev->host_unified_memory_ = info<cl_bool>(device_id, CL_DEVICE_HOST_UNIFIED_MEMORY);
+                dev->image_support_ = info<cl_bool>(device_id, CL_DEVICE_IMAGE_SUPPORT);
+#ifdef CL_VERSION_2_0
+                // devices before OpenCL 2.0 reject the query, leaving the capabilities empty
+                cl_device_svm_capabilities svm = 0;
+                clGetDeviceInfo(device_id.get(), CL_DEVICE_SVM_CAPABILITIES, sizeof(svm), &svm, nullptr);
+                dev->svm_atomics_ = (svm & CL_DEVICE_SVM_FINE_GRAIN_BUFFER) != 0 && (svm & CL_DEVICE_SVM_ATOMICS) != 0;
+#else
+                dev->svm_atomics_ = false;
+#endif
                 dev->local_mem_size_ = info<cl_ulong>(device_id, CL_DEVICE_LOCAL_MEM_SIZE);
                 dev->local_mem_type_ = info<cl_uint>(device_id, CL_DEVICE_LOCAL_MEM_TYPE);
                 dev->max_clock_frequency_ = info<cl_uint>(device_id, CL_DEVICE_MAX_CLOCK_FREQUENCY);
@@ -68,6 +81,10 @@ namespace nil {
                 dev->device_vendor_ = info_string(device_id, CL_DEVICE_VENDOR);
                 dev->device_version_ = info_string(device_id, CL_DEVICE_VERSION);
                 dev->name_ = info_string(device_id, CL_DEVICE_NAME);
+                dev->input_cache_.budget(static_cast<size_t>(dev->global_mem_size_ / 8));
+                dev->memory_.budget(dev->global_mem_size_, 0.9);
+                auto cache = &dev->input_cache_;
+                dev->memory_.add_evictor([cache](size_t num_bytes) { return cache->evict(num_bytes); });
                 return dev;
             }
 
@@ -75,6 +92,20 @@ namespace nil {
                 clFinish(queue_.get());
             }
 
+            device_metrics device::metrics() {
+                device_metrics result;
+                result.id = id_;
+                counters_.collect(result);
+                result.memory = memory_.stats();
+                return result;
+            }
+
+            detail::raw_command_queue_ptr device::create_queue() const {
+                auto queue = v2get(ACTOR_CLF(clCreateCommandQueue), context_.get(), device_id_.get(),
+                                   cl_command_queue_properties {0});
+                return detail::raw_command_queue_ptr {queue, false};
+            }
+
             std::string device::info_string(const detail::raw_device_ptr &device_id, unsigned info_flag) {
                 std::size_t size;
                 clGetDeviceInfo(device_id.get(), info_flag, 0, nullptr, &size);
@@ -86,7 +117,9 @@ namespace nil {
             device::device(detail::raw_device_ptr device_id, detail::raw_command_queue_ptr queue,
                            detail::raw_context_ptr context, unsigned id) :
                 device_id_(std::move(device_id)),
-                queue_(std::move(queue)), context_(std::move(context)), id_(id) {
+                queue_(std::move(queue)), context_(std::move(context)), id_(id),
+                memory_(context_, info<cl_uint>(device_id_, CL_DEVICE_MEM_BASE_ADDR_ALIGN) / 8),
+                flusher_(queue_.get()), trace_(nullptr) {
                 // nop
             }
 
@@ -0,0 +1,52 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+
+#include <nil/actor/cuda/elementwise.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            std::string elementwise_source(const char *type, const std::vector<elementwise_op> &ops) {
+                std::ostringstream out;
+                if (std::strcmp(type, "double") == 0) {
+                    out << "#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n";
+                }
+                out << "#define ACTOR_T " << type << "\n";
+                // one function per step keeps the names of the snippets apart
+                for (size_t k = 0; k < ops.size(); ++k) {
+                    out << "inline ACTOR_T actor_step_" << k << "(ACTOR_T x, uint i) {\n"
+                        << "  return (ACTOR_T) (" << ops[k].expression << ");\n"
+                        << "}\n\n";
+                }
+                out << "kernel void actor_elementwise(global ACTOR_T* restrict data, uint n) {\n"
+                    << "  uint i = get_global_id(0);\n"
+                    << "  if (i >= n)\n"
+                    << "    return;\n"
+                    << "  ACTOR_T x = data[i];\n";
+                for (size_t k = 0; k < ops.size(); ++k) {
+                    out << "  x = actor_step_" << k << "(x, i);\n";
+                }
+                out << "  data[i] = x;\n"
+                    << "}\n";
+                return out.str();
+            }
+
+            size_t elementwise_group_size(const device &dev) {
+                // large enough to hide latency, small enough to keep all units busy
+                return std::min(dev.max_work_group_size(), size_t {256});
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,466 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <sstream>
+
+#include <nil/actor/raise_error.hpp>
+
+#include <nil/actor/cuda/field.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            namespace {
+
+                constexpr const char *field_functions = R"__(
+typedef struct {
+  uint v[ACTOR_LIMBS];
+} actor_fe;
+
+/// The double-width product of two elements.
+typedef struct {
+  uint v[2 * ACTOR_LIMBS];
+} actor_fe_wide;
+
+constant uint actor_modulus[ACTOR_LIMBS] = {ACTOR_MODULUS};
+
+actor_fe actor_fe_zero() {
+  actor_fe r;
+#pragma unroll
+  for (uint l = 0; l < ACTOR_LIMBS; ++l)
+    r.v[l] = 0;
+  return r;
+}
+
+actor_fe actor_fe_constant(constant const uint* src) {
+  actor_fe r;
+#pragma unroll
+  for (uint l = 0; l < ACTOR_LIMBS; ++l)
+    r.v[l] = src[l];
+  return r;
+}
+
+actor_fe actor_fe_load(global const uint* src, uint i) {
+  actor_fe x;
+#pragma unroll
+  for (uint l = 0; l < ACTOR_LIMBS; ++l)
+    x.v[l] = src[i * ACTOR_LIMBS + l];
+  return x;
+}
+
+void actor_fe_store(global uint* dst, uint i, actor_fe x) {
+#pragma unroll
+  for (uint l = 0; l < ACTOR_LIMBS; ++l)
+    dst[i * ACTOR_LIMBS + l] = x.v[l];
+}
+
+actor_fe actor_fe_load_local(local const uint* src, uint i) {
+  actor_fe x;
+#pragma unroll
+  for (uint l = 0; l < ACTOR_LIMBS; ++l)
+    x.v[l] = src[i * ACTOR_LIMBS + l];
+  return x;
+}
+
+void actor_fe_store_local(local uint* dst, uint i, actor_fe x) {
+#pragma unroll
+  for (uint l = 0; l < ACTOR_LIMBS; ++l)
+    dst[i * ACTOR_LIMBS + l] = x.v[l];
+}
+
+/// Loads element `i` of `n` elements stored limb by limb, i.e., limb `l` of
+/// all elements is contiguous. Neighboring work items access neighboring words.
+actor_fe actor_fe_load_soa(global const uint* src, uint i, uint n) {
+  actor_fe x;
+#pragma unroll
+  for (uint l = 0; l < ACTOR_LIMBS; ++l)
+    x.v[l] = src[l * n + i];
+  return x;
+}
+
+void actor_fe_store_soa(global uint* dst, uint i, uint n, actor_fe x) {
+#pragma unroll
+  for (uint l = 0; l < ACTOR_LIMBS; ++l)
+    dst[l * n + i] = x.v[l];
+}
+
+/// Sets `*r` to a + b without reduction and returns the carry.
+uint actor_fe_add_carry(actor_fe* r, actor_fe a, actor_fe b) {
+  uint carry = 0;
+#pragma unroll
+  for (uint l = 0; l < ACTOR_LIMBS; ++l) {
+    ulong s = (ulong) a.v[l] + b.v[l] + carry;
+    r->v[l] = (uint) s;
+    carry = (uint) (s >> 32);
+  }
+  return carry;
+}
+
+/// Sets `*r` to a - b without reduction and returns the borrow.
+uint actor_fe_sub_borrow(actor_fe* r, actor_fe a, actor_fe b) {
+  uint borrow = 0;
+#pragma unroll
+  for (uint l = 0; l < ACTOR_LIMBS; ++l) {
+    ulong d = (ulong) a.v[l] - b.v[l] - borrow;
+    r->v[l] = (uint) d;
+    borrow = (uint) (d >> 63);
+  }
+  return borrow;
+}
+
+bool actor_fe_less_than_modulus(const actor_fe* x) {
+  for (int l = ACTOR_LIMBS - 1; l >= 0; --l) {
+    if (x->v[l] != actor_modulus[l])
+      return x->v[l] < actor_modulus[l];
+  }
+  return false;
+}
+
+actor_fe actor_fe_sub_modulus(actor_fe x) {
+  actor_fe_sub_borrow(&x, x, actor_fe_constant(actor_modulus));
+  return x;
+}
+
+actor_fe actor_fe_add(actor_fe a, actor_fe b) {
+  actor_fe r;
+  uint carry = actor_fe_add_carry(&r, a, b);
+  if (carry || !actor_fe_less_than_modulus(&r))
+    r = actor_fe_sub_modulus(r);
+  return r;
+}
+
+actor_fe actor_fe_sub(actor_fe a, actor_fe b) {
+  actor_fe r;
+  if (actor_fe_sub_borrow(&r, a, b))
+    actor_fe_add_carry(&r, r, actor_fe_constant(actor_modulus));
+  return r;
+}
+
+/// Returns the full product a * b without reduction.
+actor_fe_wide actor_fe_mul_wide(actor_fe a, actor_fe b) {
+  actor_fe_wide r;
+#pragma unroll
+  for (uint l = 0; l < 2 * ACTOR_LIMBS; ++l)
+    r.v[l] = 0;
+  for (uint i = 0; i < ACTOR_LIMBS; ++i) {
+    uint carry = 0;
+#pragma unroll
+    for (uint j = 0; j < ACTOR_LIMBS; ++j) {
+      ulong s = (ulong) a.v[j] * b.v[i] + r.v[i + j] + carry;
+      r.v[i + j] = (uint) s;
+      carry = (uint) (s >> 32);
+    }
+    r.v[i + ACTOR_LIMBS] = carry;
+  }
+  return r;
+}
+
+/// Montgomery reduction, returns t / R mod p for t < p * R. Sums of several
+/// products from `actor_fe_mul_wide` only need a single reduction as long as
+/// they stay below p * R.
+actor_fe actor_fe_reduce(actor_fe_wide t) {
+  uint top = 0;
+  for (uint i = 0; i < ACTOR_LIMBS; ++i) {
+    uint m = t.v[i] * ACTOR_INV;
+    uint carry = 0;
+#pragma unroll
+    for (uint j = 0; j < ACTOR_LIMBS; ++j) {
+      ulong s = (ulong) m * actor_modulus[j] + t.v[i + j] + carry;
+      t.v[i + j] = (uint) s;
+      carry = (uint) (s >> 32);
+    }
+    for (uint k = i + ACTOR_LIMBS; k < 2 * ACTOR_LIMBS; ++k) {
+      ulong s = (ulong) t.v[k] + carry;
+      t.v[k] = (uint) s;
+      carry = (uint) (s >> 32);
+    }
+    top += carry;
+  }
+  actor_fe r;
+#pragma unroll
+  for (uint l = 0; l < ACTOR_LIMBS; ++l)
+    r.v[l] = t.v[ACTOR_LIMBS + l];
+  if (top || !actor_fe_less_than_modulus(&r))
+    r = actor_fe_sub_modulus(r);
+  return r;
+}
+
+/// Montgomery multiplication (CIOS), returns a * b / R mod p.
+actor_fe actor_fe_mul(actor_fe a, actor_fe b) {
+  uint t[ACTOR_LIMBS + 2];
+#pragma unroll
+  for (uint l = 0; l < ACTOR_LIMBS + 2; ++l)
+    t[l] = 0;
+  for (uint i = 0; i < ACTOR_LIMBS; ++i) {
+    uint carry = 0;
+#pragma unroll
+    for (uint j = 0; j < ACTOR_LIMBS; ++j) {
+      ulong s = (ulong) a.v[j] * b.v[i] + t[j] + carry;
+      t[j] = (uint) s;
+      carry = (uint) (s >> 32);
+    }
+    ulong s = (ulong) t[ACTOR_LIMBS] + carry;
+    t[ACTOR_LIMBS] = (uint) s;
+    t[ACTOR_LIMBS + 1] = (uint) (s >> 32);
+    uint m = t[0] * ACTOR_INV;
+    s = (ulong) m * actor_modulus[0] + t[0];
+    carry = (uint) (s >> 32);
+#pragma unroll
+    for (uint j = 1; j < ACTOR_LIMBS; ++j) {
+      s = (ulong) m * actor_modulus[j] + t[j] + carry;
+      t[j - 1] = (uint) s;
+      carry = (uint) (s >> 32);
+    }
+    s = (ulong) t[ACTOR_LIMBS] + carry;
+    t[ACTOR_LIMBS - 1] = (uint) s;
+    t[ACTOR_LIMBS] = t[ACTOR_LIMBS + 1] + (uint) (s >> 32);
+  }
+  actor_fe r;
+#pragma unroll
+  for (uint l = 0; l < ACTOR_LIMBS; ++l)
+    r.v[l] = t[l];
+  if (t[ACTOR_LIMBS] || !actor_fe_less_than_modulus(&r))
+    r = actor_fe_sub_modulus(r);
+  return r;
+}
+
+bool actor_fe_is_zero(actor_fe x) {
+  uint acc = 0;
+#pragma unroll
+  for (uint l = 0; l < ACTOR_LIMBS; ++l)
+    acc |= x.v[l];
+  return acc == 0;
+}
+
+bool actor_fe_equal(actor_fe a, actor_fe b) {
+  uint acc = 0;
+#pragma unroll
+  for (uint l = 0; l < ACTOR_LIMBS; ++l)
+    acc |= a.v[l] ^ b.v[l];
+  return acc == 0;
+}
+)__";
+
+                using limbs = montgomery_field::limbs;
+
+                bool less_than(const limbs &x, const limbs &y) {
+                    for (auto i = x.size(); i > 0; --i) {
+                        if (x[i - 1] != y[i - 1]) {
+                            return x[i - 1] < y[i - 1];
+                        }
+                    }
+                    return false;
+                }
+
+                void subtract(limbs &x, const limbs &y) {
+                    cl_ulong borrow = 0;
+                    for (size_t i = 0; i < x.size(); ++i) {
+                        auto d = static_cast<cl_ulong>(x[i]) - y[i] - borrow;
+                        x[i] = static_cast<cl_uint>(d);
+                        borrow = d >> 63;
+                    }
+                }
+
+                // returns x + y mod 2^(32 * n)
+                limbs add_raw(limbs x, const limbs &y) {
+                    cl_ulong carry = 0;
+                    for (size_t i = 0; i < x.size(); ++i) {
+                        auto s = static_cast<cl_ulong>(x[i]) + y[i] + carry;
+                        x[i] = static_cast<cl_uint>(s);
+                        carry = s >> 32;
+                    }
+                    return x;
+                }
+
+                // returns 2x mod p for x < p
+                limbs mod_double(limbs x, const limbs &p) {
+                    cl_uint carry = 0;
+                    for (auto &limb : x) {
+                        auto next = limb >> 31;
+                        limb = (limb << 1) | carry;
+                        carry = next;
+                    }
+                    if (carry != 0 || !less_than(x, p)) {
+                        subtract(x, p);
+                    }
+                    return x;
+                }
+
+            }    // namespace
+
+            montgomery_field::montgomery_field(limbs modulus) : modulus_(std::move(modulus)), inverse_(0) {
+                if (modulus_.empty() || (modulus_[0] & 1) == 0) {
+                    ACTOR_RAISE_ERROR("the modulus of a field must be odd");
+                }
+                // Newton iteration doubles the number of correct bits per step
+                cl_uint inv = modulus_[0];
+                for (int i = 0; i < 4; ++i) {
+                    inv *= 2 - modulus_[0] * inv;
+                }
+                inverse_ = 0 - inv;
+            }
+
+            montgomery_field::limbs montgomery_field::to_montgomery(limbs x) const {
+                x.resize(size(), 0);
+                for (size_t i = 0; i < 32 * size(); ++i) {
+                    x = mod_double(std::move(x), modulus_);
+                }
+                return x;
+            }
+
+            montgomery_field::limbs montgomery_field::add(const limbs &a, const limbs &b) const {
+                limbs result(size());
+                cl_ulong carry = 0;
+                for (size_t i = 0; i < size(); ++i) {
+                    auto s = static_cast<cl_ulong>(a[i]) + b[i] + carry;
+                    result[i] = static_cast<cl_uint>(s);
+                    carry = s >> 32;
+                }
+                if (carry != 0 || !less_than(result, modulus_)) {
+                    subtract(result, modulus_);
+                }
+                return result;
+            }
+
+            montgomery_field::limbs montgomery_field::sub(const limbs &a, const limbs &b) const {
+                if (!less_than(a, b)) {
+                    auto result = a;
+                    subtract(result, b);
+                    return result;
+                }
+                // a + p - b wraps around 2^(32 * n) exactly once
+                auto result = add_raw(a, modulus_);
+                subtract(result, b);
+                return result;
+            }
+
+            montgomery_field::limbs montgomery_field::mul(const limbs &a, const limbs &b) const {
+                // CIOS, see `actor_fe_mul`
+                auto n = size();
+                auto &p = modulus_;
+                limbs t(n + 2, 0);
+                for (size_t i = 0; i < n; ++i) {
+                    cl_ulong carry = 0;
+                    for (size_t j = 0; j < n; ++j) {
+                        auto s = static_cast<cl_ulong>(a[j]) * b[i] + t[j] + carry;
+                        t[j] = static_cast<cl_uint>(s);
+                        carry = s >> 32;
+                    }
+                    auto s = static_cast<cl_ulong>(t[n]) + carry;
+                    t[n] = static_cast<cl_uint>(s);
+                    t[n + 1] = static_cast<cl_uint>(s >> 32);
+                    cl_uint m = t[0] * inverse_;
+                    s = static_cast<cl_ulong>(m) * p[0] + t[0];
+                    carry = s >> 32;
+                    for (size_t j = 1; j < n; ++j) {
+                        s = static_cast<cl_ulong>(m) * p[j] + t[j] + carry;
+                        t[j - 1] = static_cast<cl_uint>(s);
+                        carry = s >> 32;
+                    }
+                    s = static_cast<cl_ulong>(t[n]) + carry;
+                    t[n - 1] = static_cast<cl_uint>(s);
+                    t[n] = t[n + 1] + static_cast<cl_uint>(s >> 32);
+                }
+                limbs result(t.begin(), t.begin() + n);
+                if (t[n] != 0 || !less_than(result, p)) {
+                    subtract(result, p);
+                }
+                return result;
+            }
+
+            montgomery_field::limbs montgomery_field::pow(const limbs &x, const limbs &e) const {
+                auto result = one();
+                for (auto i = 32 * e.size(); i > 0; --i) {
+                    result = mul(result, result);
+                    if ((e[(i - 1) / 32] >> ((i - 1) % 32)) & 1) {
+                        result = mul(result, x);
+                    }
+                }
+                return result;
+            }
+
+            montgomery_field::limbs montgomery_field::one() const {
+                return to_montgomery(limbs {1});
+            }
+
+            montgomery_field::limbs montgomery_field::r2() const {
+                return to_montgomery(one());
+            }
+
+            montgomery_field::limbs montgomery_field::to_soa(const limbs &elements) const {
+                auto n = elements.size() / size();
+                limbs result(n * size());
+                for (size_t i = 0; i < n; ++i) {
+                    for (size_t l = 0; l < size(); ++l) {
+                        result[l * n + i] = elements[i * size() + l];
+                    }
+                }
+                return result;
+            }
+
+            montgomery_field::limbs montgomery_field::from_soa(const limbs &soa) const {
+                auto n = soa.size() / size();
+                limbs result(n * size());
+                for (size_t i = 0; i < n; ++i) {
+                    for (size_t l = 0; l < size(); ++l) {
+                        result[i * size() + l] = soa[l * n + i];
+                    }
+                }
+                return result;
+            }
+
+            mem_ref<cl_uint> montgomery_field::soa_argument(device &dev, const limbs &elements,
+                                                            cl_mem_flags flags) const {
+                if (elements.size() % size() != 0) {
+                    ACTOR_RAISE_ERROR("soa_argument: elements must consist of whole field elements");
+                }
+                // the transposed copy is temporary, hence the blocking write
+                return dev.global_argument(to_soa(elements), flags, none, CL_TRUE);
+            }
+
+            expected<montgomery_field::limbs> montgomery_field::soa_data(mem_ref<cl_uint> &ref) const {
+                if (ref.size() % size() != 0) {
+                    return make_error(sec::runtime_error, "Buffer does not hold whole field elements.");
+                }
+                auto data = ref.data();
+                if (!data) {
+                    return std::move(data.error());
+                }
+                return from_soa(*data);
+            }
+
+            std::string montgomery_field::options() const {
+                std::ostringstream out;
+                out << "-DACTOR_LIMBS=" << size() << " -DACTOR_INV=" << inverse_ << "u -DACTOR_MODULUS=";
+                for (size_t i = 0; i < size(); ++i) {
+                    out << (i == 0 ? "" : ",") << modulus_[i] << "u";
+                }
+                return out.str();
+            }
+
+            std::string montgomery_field::library() const {
+                return field_functions;
+            }
+
+            std::string montgomery_field::source() const {
+                std::ostringstream out;
+                out << "#define ACTOR_LIMBS " << size() << "\n"
+                    << "#define ACTOR_INV " << inverse_ << "u\n"
+                    << "#define ACTOR_MODULUS ";
+                for (size_t i = 0; i < size(); ++i) {
+                    out << (i == 0 ? "" : ", ") << modulus_[i] << "u";
+                }
+                out << "\n" << field_functions;
+                return out.str();
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,125 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <vector>
+#include <algorithm>
+
+#include <nil/actor/logger.hpp>
+
+#include <nil/actor/cuda/flush_batcher.hpp>
+#include <nil/actor/cuda/opencl_error.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            namespace {
+
+                struct burst_state {
+                    size_t depth = 0;
+                    std::vector<flush_batcher *> batchers;
+                };
+
+                thread_local burst_state burst;
+
+            }    // namespace
+
+            flush_batcher::scope::scope() {
+                ++burst.depth;
+            }
+
+            flush_batcher::scope::~scope() {
+                if (--burst.depth > 0) {
+                    return;
+                }
+                for (auto x : burst.batchers) {
+                    if (x->pending_.load() > 0) {
+                        x->flush();
+                    }
+                }
+                burst.batchers.clear();
+            }
+
+            flush_batcher::flush_batcher(cl_command_queue queue, size_t threshold) :
+                queue_(queue), threshold_(std::max(threshold, size_t {1})), pending_(0), scheduled_(false),
+                flushes_(0), requests_(0), stopping_(false) {
+                // nop
+            }
+
+            flush_batcher::~flush_batcher() {
+                {
+                    std::lock_guard<std::mutex> guard {mtx_};
+                    stopping_ = true;
+                    cv_.notify_one();
+                }
+                if (thread_.joinable()) {
+                    thread_.join();
+                } else if (pending_.load() > 0) {
+                    flush();
+                }
+            }
+
+            void flush_batcher::request() {
+                requests_.fetch_add(1, std::memory_order_relaxed);
+                if (pending_.fetch_add(1) + 1 >= threshold_) {
+                    flush();
+                    return;
+                }
+                if (burst.depth > 0) {
+                    if (std::find(burst.batchers.begin(), burst.batchers.end(), this) == burst.batchers.end()) {
+                        burst.batchers.push_back(this);
+                    }
+                    return;
+                }
+                // only the first request of a burst wakes the thread, the flag is
+                // cleared right before the flush that covers the burst
+                if (!scheduled_.exchange(true)) {
+                    std::lock_guard<std::mutex> guard {mtx_};
+                    // devices that never defer a flush do not need a thread
+                    if (!thread_.joinable() && !stopping_) {
+                        thread_ = std::thread {[this] { run(); }};
+                    }
+                    cv_.notify_one();
+                }
+            }
+
+            size_t flush_batcher::flushes() const {
+                return flushes_.load();
+            }
+
+            size_t flush_batcher::requests() const {
+                return requests_.load();
+            }
+
+            void flush_batcher::run() {
+                ACTOR_LOG_TRACE("");
+                std::unique_lock<std::mutex> guard {mtx_};
+                for (;;) {
+                    cv_.wait(guard, [this] { return stopping_ || scheduled_.load(); });
+                    scheduled_.store(false);
+                    if (pending_.load() > 0) {
+                        guard.unlock();
+                        flush();
+                        guard.lock();
+                    }
+                    if (stopping_) {
+                        return;
+                    }
+                }
+            }
+
+            void flush_batcher::flush() {
+                pending_.store(0);
+                flushes_.fetch_add(1, std::memory_order_relaxed);
+                v3callcl(clFlush, queue_);
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,49 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <algorithm>
+
+#include <nil/actor/cuda/host_kernel.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            host_args::host_args(nd_range range) : range_(std::move(range)) {
+                // nop
+            }
+
+            void host_args::add(void *data, size_t size) {
+                args_.emplace_back(data, size);
+            }
+
+            void *host_args::add_owned(size_t size, size_t elem_size) {
+                // operator new aligns for any scalar type
+                owned_.emplace_back(new char[std::max(size * elem_size, size_t {1})]());
+                args_.emplace_back(owned_.back().get(), size);
+                return owned_.back().get();
+            }
+
+            std::vector<std::pair<size_t, size_t>> host_chunks(size_t num_items, size_t num_threads) {
+                std::vector<std::pair<size_t, size_t>> result;
+                if (num_items == 0) {
+                    return result;
+                }
+                auto max_chunks = std::max(num_threads, size_t {1}) * 4;
+                auto num_chunks = std::min(max_chunks, (num_items + host_min_chunk - 1) / host_min_chunk);
+                auto chunk = (num_items + num_chunks - 1) / num_chunks;
+                for (size_t begin = 0; begin < num_items; begin += chunk) {
+                    result.emplace_back(begin, std::min(begin + chunk, num_items));
+                }
+                return result;
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
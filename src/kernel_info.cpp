@@ -0,0 +1,130 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <array>
+#include <sstream>
+#include <algorithm>
+
+#include <nil/actor/logger.hpp>
+
+#include <nil/actor/cuda/kernel_info.hpp>
+#include <nil/actor/cuda/opencl_error.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            namespace {
+
+                template<class T>
+                T work_group_info(cl_kernel kernel, cl_device_id device_id, cl_kernel_work_group_info name) {
+                    return v3get<T>(ACTOR_CLF(clGetKernelWorkGroupInfo), kernel, device_id, name);
+                }
+
+                template<class T>
+                std::string to_string(const T &x) {
+                    std::ostringstream out;
+                    out << x;
+                    return out.str();
+                }
+
+            }    // namespace
+
+            kernel_info kernel_info::query(cl_kernel kernel, cl_device_id device_id) {
+                kernel_info result;
+                result.work_group_size = work_group_info<size_t>(kernel, device_id, CL_KERNEL_WORK_GROUP_SIZE);
+                auto compile_size =
+                    work_group_info<std::array<size_t, 3>>(kernel, device_id, CL_KERNEL_COMPILE_WORK_GROUP_SIZE);
+                result.compile_work_group_size.assign(compile_size.begin(), compile_size.end());
+                result.local_mem_size = work_group_info<cl_ulong>(kernel, device_id, CL_KERNEL_LOCAL_MEM_SIZE);
+                result.private_mem_size = work_group_info<cl_ulong>(kernel, device_id, CL_KERNEL_PRIVATE_MEM_SIZE);
+                result.preferred_work_group_size_multiple =
+                    work_group_info<size_t>(kernel, device_id, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE);
+                return result;
+            }
+
+            occupancy_estimate estimate_occupancy(const kernel_info &info, const device &dev, const nd_range &range) {
+                occupancy_estimate result {true, 1.0, {}};
+                auto fail = [&](std::string what) {
+                    result.fits = false;
+                    result.issues.push_back(std::move(what));
+                };
+                if (info.local_mem_size > dev.local_mem_size()) {
+                    fail("uses " + to_string(info.local_mem_size) + " bytes of local memory, the device has " +
+                         to_string(dev.local_mem_size()));
+                }
+                auto &local = range.local_dimensions();
+                if (local.empty()) {
+                    return result;    // the runtime picks the work-group size
+                }
+                auto &global = range.dimensions();
+                auto &max_items = dev.max_work_item_sizes();
+                size_t group_size = 1;
+                size_t num_groups = 1;
+                bool required = std::any_of(info.compile_work_group_size.begin(), info.compile_work_group_size.end(),
+                                            [](size_t x) { return x != 0; });
+                for (size_t i = 0; i < local.size(); ++i) {
+                    group_size *= local[i];
+                    if (local[i] == 0) {
+                        fail("local dimension " + to_string(i) + " is zero");
+                        return result;
+                    }
+                    num_groups *= (global[i] + local[i] - 1) / local[i];
+                    if (i < max_items.size() && local[i] > max_items[i]) {
+                        fail("local dimension " + to_string(i) + " is " + to_string(local[i]) +
+                             ", the device allows " + to_string(max_items[i]));
+                    }
+                    if (global[i] % local[i] != 0) {
+                        fail("global dimension " + to_string(i) + " (" + to_string(global[i]) +
+                             ") is not a multiple of the local dimension (" + to_string(local[i]) + ")");
+                    }
+                    if (required && local[i] != info.compile_work_group_size[i]) {
+                        fail("local dimension " + to_string(i) + " differs from reqd_work_group_size (" +
+                             to_string(info.compile_work_group_size[i]) + ")");
+                    }
+                }
+                if (group_size > info.work_group_size) {
+                    fail("work-group size " + to_string(group_size) + " exceeds the kernel limit of " +
+                         to_string(info.work_group_size));
+                }
+                // lanes of the last SIMD unit of each work-group stay idle
+                auto multiple = std::max(info.preferred_work_group_size_multiple, size_t {1});
+                auto lanes = (group_size + multiple - 1) / multiple * multiple;
+                auto lane_share = static_cast<double>(group_size) / static_cast<double>(lanes);
+                if (group_size % multiple != 0) {
+                    result.issues.push_back("work-group size " + to_string(group_size) +
+                                            " is not a multiple of the preferred multiple " + to_string(multiple));
+                }
+                // compute units without a work-group stay idle
+                auto units = std::max(static_cast<size_t>(dev.max_compute_units()), size_t {1});
+                auto unit_share = std::min(1.0, static_cast<double>(num_groups) / static_cast<double>(units));
+                if (num_groups < units) {
+                    result.issues.push_back(to_string(num_groups) + " work-groups leave some of the " +
+                                            to_string(units) + " compute units idle");
+                }
+                result.occupancy = lane_share * unit_share;
+                return result;
+            }
+
+            occupancy_estimate check_occupancy(const char *kernel_name, const kernel_info &info, const device &dev,
+                                               const nd_range &range) {
+                auto result = estimate_occupancy(info, dev, range);
+                if (!result.fits || result.occupancy < poor_occupancy) {
+                    for (auto &issue : result.issues) {
+                        ACTOR_LOG_WARNING("kernel" << ACTOR_ARG(kernel_name) << issue);
+                    }
+                    ACTOR_LOG_WARNING("kernel" << ACTOR_ARG(kernel_name) << "has an estimated occupancy of"
+                                               << ACTOR_ARG(result.occupancy));
+                }
+                return result;
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
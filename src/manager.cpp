@@ -1,7 +1,12 @@
+#include <thread>
 #include <fstream>
+#include <numeric>
+#include <algorithm>
 
 #include <nil/actor/detail/type_list.hpp>
 #include <nil/actor/raise_error.hpp>
+#include <nil/actor/event_based_actor.hpp>
+#include <nil/actor/spawner_config.hpp>
 
 #include <nil/actor/cuda/device.hpp>
 #include <nil/actor/cuda/manager.hpp>
@@ -12,6 +17,13 @@ namespace nil {
     namespace actor {
         namespace cuda {
 
+            namespace {
+
+                // CL_PLATFORM_NOT_FOUND_KHR from cl_khr_icd
+                constexpr cl_int platform_not_found = -1001;
+
+            }    // namespace
+
             optional<device_ptr> manager::find_device(std::size_t dev_id) const {
                 if (platforms_.empty()) {
                     return none;
@@ -27,28 +39,99 @@ namespace nil {
                 return none;
             }
 
-            void manager::init(spawner_config &) {
-                // get number of available platforms
-                auto num_platforms = v1get<cl_uint>(ACTOR_CLF(clGetPlatformIDs));
+            void manager::init(spawner_config &cfg) {
+                // results of kernels are handled off the callback threads of OpenCL,
+                // zero threads restores handling them inside the callbacks
+                auto num_threads = get_or(cfg, "opencl.completion-threads", size_t {2});
+                executor_.reset(new completion_executor(num_threads));
+                // tracing requires profiling info, which only queues created with it
+                // provide, so it cannot be turned on later
+                trace_file_ = get_or(cfg, "opencl.trace-file", std::string {});
+                auto trace_capacity = get_or(cfg, "opencl.trace-capacity", size_t {0});
+                if (trace_capacity == 0 && !trace_file_.empty()) {
+                    trace_capacity = size_t {1} << 16;
+                }
+                if (trace_capacity > 0) {
+                    tracer_.reset(new tracer(trace_capacity));
+                }
+                // host kernels keep nodes without OpenCL devices usable, the threads
+                // start with the first host kernel actor
+                auto host_threads = get_or(cfg, "opencl.host-threads",
+                                           std::max(size_t {std::thread::hardware_concurrency()}, size_t {1}));
+                host_executor_.reset(new completion_executor(host_threads));
+                // get number of available platforms, the ICD loader reports missing
+                // platforms as an error
+                cl_uint num_platforms = 0;
+                auto err = clGetPlatformIDs(0, nullptr, &num_platforms);
+                if (err != platform_not_found) {
+                    throwcl("clGetPlatformIDs", err);
+                }
+                if (err != CL_SUCCESS || num_platforms == 0) {
+                    ACTOR_LOG_WARNING("no OpenCL platform found, only host kernels are available");
+                    return;
+                }
                 // get platform ids
                 std::vector<cl_platform_id> platform_ids(num_platforms);
                 v2callcl(ACTOR_CLF(clGetPlatformIDs), num_platforms, platform_ids.data());
-                if (platform_ids.empty())
-                    ACTOR_RAISE_ERROR("no OpenCL platform found");
                 // initialize platforms (device discovery)
                 unsigned current_device_id = 0;
                 for (auto &pl_id : platform_ids) {
-                    platforms_.push_back(platform::create(pl_id, current_device_id));
+                    platforms_.push_back(platform::create(pl_id, current_device_id, tracer_.get()));
                     current_device_id += static_cast<unsigned>(platforms_.back()->devices().size());
                 }
             }
 
             void manager::start() {
-                // nop
+                executor_->start();
             }
 
             void manager::stop() {
-                // nop
+                // persistent kernels never finish on their own
+                std::vector<persistent_kernel_ptr> kernels;
+                {
+                    std::lock_guard<std::mutex> guard {persistent_mtx_};
+                    kernels.swap(persistent_kernels_);
+                }
+                for (auto &kernel : kernels) {
+                    kernel->shutdown();
+                }
+                executor_->stop();
+                {
+                    std::lock_guard<std::mutex> guard {host_mtx_};
+                    host_stopped_ = true;
+                }
+                host_executor_->stop();
+                if (tracer_ && !trace_file_.empty()) {
+                    std::ofstream out {trace_file_};
+                    if (out) {
+                        tracer_->write(out);
+                    } else {
+                        ACTOR_LOG_ERROR("cannot write trace to" << ACTOR_ARG(trace_file_));
+                    }
+                }
+            }
+
+            metrics_snapshot manager::metrics() const {
+                metrics_snapshot result;
+                result.time = std::chrono::steady_clock::now();
+                for (auto &pl : platforms_) {
+                    for (auto &dev : pl->devices()) {
+                        result.devices.push_back(dev->metrics());
+                    }
+                }
+                return result;
+            }
+
+            tracer *manager::trace() const {
+                return tracer_.get();
+            }
+
+            bool manager::write_trace(std::ostream &out) const {
+                if (!tracer_) {
+                    return false;
+                }
+                tracer_->write(out);
+                return true;
             }
 
             spawner_module::id_t manager::id() const {
@@ -134,6 +217,7 @@ namespace nil {
                     }
                     ACTOR_RAISE_ERROR("clBuildProgram failed");
                 }
+                ++dev->counters().program_builds;
                 cl_uint number_of_kernels = 0;
                 clCreateKernelsInProgram(pptr.get(), 0u, nullptr, &number_of_kernels);
                 std::map<std::string, detail::raw_kernel_ptr> available_kernels;
@@ -160,10 +244,257 @@ namespace nil {
                         " on some platforms, we'll ignore this and try to build"
                         " each kernel individually by name.");
                 }
-                return make_counted<program>(dev->context_, dev->queue_, pptr, std::move(available_kernels));
+                return make_counted<program>(dev, dev->context_, dev->queue_, pptr, std::move(available_kernels),
+                                             executor_.get());
+            }
+
+            program_ptr manager::create_primitives_program(const device_ptr &dev, const char *type,
+                                                           const primitive_op &op, const std::string &predicate,
+                                                           bool exclusive) {
+                auto source = primitives_source(type, op, predicate, exclusive);
+                return create_program(source.c_str(), "", dev);
+            }
+
+            void manager::add_host_kernel(const std::string &name, host_kernel fun) {
+                auto ptr = std::make_shared<const host_kernel>(std::move(fun));
+                std::lock_guard<std::mutex> guard {host_mtx_};
+                host_kernels_[name] = std::move(ptr);
+            }
+
+            std::shared_ptr<const host_kernel> manager::find_host_kernel(const std::string &name) const {
+                std::lock_guard<std::mutex> guard {host_mtx_};
+                auto i = host_kernels_.find(name);
+                if (i == host_kernels_.end()) {
+                    ACTOR_RAISE_ERROR("no host kernel with this name");
+                }
+                return i->second;
+            }
+
+            completion_executor &manager::host_executor() {
+                std::lock_guard<std::mutex> guard {host_mtx_};
+                // a stopped executor runs the jobs of late messages inline
+                if (!host_stopped_) {
+                    host_executor_->start();
+                }
+                return *host_executor_;
+            }
+
+            program_ptr manager::create_elementwise_program(const device_ptr &dev, const char *type,
+                                                            const std::vector<elementwise_op> &ops) {
+                auto source = elementwise_source(type, ops);
+                std::lock_guard<std::mutex> guard {elementwise_mtx_};
+                auto &prog = elementwise_programs_[std::make_pair(dev->id(), source)];
+                if (!prog) {
+                    prog = create_program(source.c_str(), "", dev);
+                }
+                return prog;
+            }
+
+            program_ptr manager::create_ntt_program(const device_ptr &dev, const ntt_field &field) {
+                auto source = ntt_source(field);
+                return create_program(source.c_str(), "", dev);
+            }
+
+            actor manager::spawn_msm(const device_ptr &dev, const msm_curve &curve, size_t num_points,
+                                     size_t window_bits) {
+                if (window_bits == 0) {
+                    window_bits = msm_window_bits(*dev, curve, num_points);
+                }
+                auto source = msm_source(curve, window_bits);
+                return spawn_msm(dev, create_program(source.c_str(), "", dev), curve, window_bits);
+            }
+
+            actor manager::spawn_msm(const std::vector<device_ptr> &devs, const msm_curve &curve,
+                                     size_t num_points) {
+                if (devs.empty()) {
+                    ACTOR_RAISE_ERROR("spawn_msm requires at least one device");
+                }
+                if (devs.size() == 1) {
+                    return spawn_msm(devs.front(), curve, num_points);
+                }
+                using uvec = std::vector<cl_uint>;
+                std::vector<size_t> weights;
+                for (auto &dev : devs) {
+                    weights.push_back(std::max<size_t>(dev->max_compute_units(), 1));
+                }
+                auto total_weight = std::accumulate(weights.begin(), weights.end(), size_t {0});
+                std::vector<actor> workers;
+                program_ptr first_prog;
+                for (size_t i = 0; i < devs.size(); ++i) {
+                    auto window_bits = msm_window_bits(*devs[i], curve, num_points * weights[i] / total_weight);
+                    auto source = msm_source(curve, window_bits);
+                    auto prog = create_program(source.c_str(), "", devs[i]);
+                    if (i == 0) {
+                        first_prog = prog;
+                    }
+                    workers.push_back(spawn_msm(devs[i], prog, curve, window_bits));
+                }
+                auto limbs = curve.limbs();
+                auto scalar_limbs = curve.scalar_limbs();
+                // adds the partial results on the first device
+                auto sum = spawn(
+                    first_prog, "actor_msm_sum", nd_range {dim_vec {1}},
+                    [limbs](message &msg) -> optional<message> {
+                        if (!msg.match_elements<uvec>()) {
+                            return none;
+                        }
+                        auto count = static_cast<cl_uint>(msg.get_as<uvec>(0).size() / (2 * limbs));
+                        return message::concat(msg, make_message(count));
+                    },
+                    in<cl_uint> {}, make_out<cl_uint>([limbs](const uvec &, cl_uint) { return 2 * limbs; }),
+                    priv<cl_uint, val> {});
+                struct state {
+                    response_promise promise;
+                    uvec partials;
+                    size_t pending = 0;
+                    bool failed = false;
+                };
+                return system_.spawn([=](event_based_actor *self) -> behavior {
+                    return {
+                        [=](uvec &points, uvec &scalars) {
+                            auto st = std::make_shared<state>();
+                            st->promise = self->make_response_promise();
+                            auto m = scalars.size() / scalar_limbs;
+                            if (m == 0 || scalars.size() != m * scalar_limbs || points.size() != m * 2 * limbs) {
+                                st->promise.deliver(make_error(sec::invalid_argument));
+                                return st->promise;
+                            }
+                            size_t first = 0;
+                            for (size_t i = 0; i < workers.size(); ++i) {
+                                auto count = i + 1 == workers.size() ? m - first : m * weights[i] / total_weight;
+                                if (count == 0) {
+                                    continue;
+                                }
+                                uvec chunk_points(points.begin() + first * 2 * limbs,
+                                                  points.begin() + (first + count) * 2 * limbs);
+                                uvec chunk_scalars(scalars.begin() + first * scalar_limbs,
+                                                   scalars.begin() + (first + count) * scalar_limbs);
+                                first += count;
+                                ++st->pending;
+                                self->request(workers[i], infinite, std::move(chunk_points), std::move(chunk_scalars))
+                                    .then(
+                                        [=](uvec &partial) {
+                                            st->partials.insert(st->partials.end(), partial.begin(), partial.end());
+                                            if (--st->pending == 0 && !st->failed) {
+                                                st->promise.delegate(sum, std::move(st->partials));
+                                            }
+                                        },
+                                        [=](error &err) {
+                                            --st->pending;
+                                            if (!st->failed) {
+                                                st->failed = true;
+                                                st->promise.deliver(std::move(err));
+                                            }
+                                        });
+                            }
+                            return st->promise;
+                        }};
+                });
+            }
+
+            actor manager::spawn_msm(const device_ptr &dev, const program_ptr &prog, const msm_curve &curve,
+                                     size_t window_bits) {
+                using uvec = std::vector<cl_uint>;
+                using uref = mem_ref<cl_uint>;
+                auto limbs = curve.limbs();
+                auto scalar_limbs = curve.scalar_limbs();
+                auto windows = msm_num_windows(curve, window_bits);
+                auto buckets = size_t {1} << window_bits;
+                auto group = msm_group_size(*dev, curve, window_bits);
+                auto num_counts = windows * (buckets + 1);
+                // later stages recover the number of points from the mem_ref of the points
+                auto num_points = [limbs](message &msg) {
+                    return static_cast<cl_uint>(msg.get_as<uref>(0).size() / (2 * limbs));
+                };
+                // computes the digits of all scalars and counts the points per bucket
+                auto count = spawn(
+                    prog, "actor_msm_count", nd_range {dim_vec {1}},
+                    [=](nd_range &range, message &msg) -> optional<message> {
+                        if (!msg.match_elements<uvec, uvec>()) {
+                            return none;
+                        }
+                        auto m = msg.get_as<uvec>(1).size() / scalar_limbs;
+                        if (m == 0 || msg.get_as<uvec>(1).size() != m * scalar_limbs
+                            || msg.get_as<uvec>(0).size() != m * 2 * limbs) {
+                            return none;
+                        }
+                        range = nd_range {dim_vec {windows * m}};
+                        return message::concat(msg, make_message(uvec(num_counts, 0), static_cast<cl_uint>(m)));
+                    },
+                    in_out<cl_uint, val, mref> {}, in<cl_uint> {},
+                    make_out<cl_uint, mref>(
+                        [windows](const uvec &, const uvec &, const uvec &, cl_uint m) { return windows * m; }),
+                    in_out<cl_uint, val, mref> {}, priv<cl_uint, val> {});
+                // turns counts into offsets, one work item per window
+                auto offsets = spawn(
+                    prog, "actor_msm_offsets", nd_range {dim_vec {windows}}, in_out<cl_uint, mref, mref> {},
+                    in_out<cl_uint, mref, mref> {}, in_out<cl_uint, mref, mref> {},
+                    make_out<cl_uint, mref>(
+                        [num_counts](const uref &, const uref &, const uref &) { return num_counts; }));
+                // sorts the point indices by bucket
+                auto scatter = spawn(
+                    prog, "actor_msm_scatter", nd_range {dim_vec {1}},
+                    [=](nd_range &range, message &msg) -> optional<message> {
+                        auto m = num_points(msg);
+                        range = nd_range {dim_vec {windows * m}};
+                        return message::concat(msg, make_message(m));
+                    },
+                    in_out<cl_uint, mref, mref> {}, in<cl_uint, mref> {}, in_out<cl_uint, mref, mref> {},
+                    in<cl_uint, mref> {},
+                    make_out<cl_uint, mref>([windows](const uref &, const uref &, const uref &, const uref &,
+                                                      cl_uint m) { return windows * m; }),
+                    priv<cl_uint, val> {});
+                // sums the points of each bucket
+                auto bucket_sums = spawn(
+                    prog, "actor_msm_buckets", nd_range {dim_vec {windows * buckets}},
+                    [=](message &msg) -> optional<message> {
+                        return message::concat(msg, make_message(num_points(msg)));
+                    },
+                    in<cl_uint, mref> {}, in<cl_uint, mref> {}, in<cl_uint, mref> {},
+                    make_out<cl_uint, mref>([=](const uref &, const uref &, const uref &, cl_uint) {
+                        return windows * buckets * 3 * limbs;
+                    }),
+                    priv<cl_uint, val> {});
+                // reduces the buckets of each window in one work group
+                auto window_sums
+                    = spawn(prog, "actor_msm_windows", nd_range {dim_vec {windows * group}, {}, dim_vec {group}},
+                            in<cl_uint, mref> {},
+                            make_out<cl_uint, mref>([=](const uref &) { return windows * 3 * limbs; }),
+                            local<cl_uint> {group * 3 * limbs});
+                // combines the windows and converts the result to affine coordinates
+                auto combine = spawn(prog, "actor_msm_final", nd_range {dim_vec {1}}, in<cl_uint, mref> {},
+                                     make_out<cl_uint>([limbs](const uref &) { return 2 * limbs; }));
+                return combine * window_sums * bucket_sums * scatter * offsets * count;
+            }
+
+            actor manager::spawn_merkle(const device_ptr &dev, const merkle_hash &hash) {
+                auto source = merkle_source(hash);
+                auto prog = create_program(source.c_str(), "", dev);
+                // the builder sets the arguments of its kernels for each level
+                detail::raw_kernel_ptr level_kernel;
+                level_kernel.reset(v2get(ACTOR_CLF(clCreateKernel), prog->program_.get(), "actor_merkle_level"), false);
+                detail::raw_kernel_ptr paths_kernel;
+                paths_kernel.reset(v2get(ACTOR_CLF(clCreateKernel), prog->program_.get(), "actor_merkle_paths"), false);
+                return merkle_builder::create(actor_config {system_.dummy_execution_unit()}, prog->device_,
+                                              prog->queue_, prog->executor_, std::move(level_kernel),
+                                              std::move(paths_kernel), hash.words);
+            }
+
+            persistent_kernel_ptr manager::create_persistent_kernel(const program_ptr &prog, const char *fname,
+                                                                    size_t capacity, size_t input_size,
+                                                                    size_t output_size,
+                                                                    persistent_kernel::deliver_fun deliver) {
+                detail::raw_kernel_ptr kernel;
+                kernel.reset(v2get(ACTOR_CLF(clCreateKernel), prog->program_.get(), fname), false);
+                auto result = make_counted<persistent_kernel>(prog->device_, std::move(kernel), capacity, input_size,
+                                                              output_size, deliver);
+                result->start();
+                std::lock_guard<std::mutex> guard {persistent_mtx_};
+                persistent_kernels_.push_back(result);
+                return result;
             }
 
-            manager::manager(spawner &sys) : system_(sys) {
+            manager::manager(spawner &sys) : system_(sys), host_stopped_(false) {
                 // nop
             }
 
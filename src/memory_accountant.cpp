@@ -0,0 +1,142 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <limits>
+#include <algorithm>
+
+#include <nil/actor/logger.hpp>
+
+#include <nil/actor/cuda/memory_accountant.hpp>
+#include <nil/actor/cuda/opencl_error.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            memory_accountant::memory_accountant(detail::raw_context_ptr context, size_t granularity) :
+                context_(std::move(context)), granularity_(std::max(granularity, size_t {1})),
+                counters_(std::make_shared<counters>()), budget_(0), evicted_(0) {
+                // nop
+            }
+
+            cl_mem memory_accountant::create_buffer(cl_mem_flags flags, size_t num_bytes, void *host_ptr) {
+                return allocate("clCreateBuffer", num_bytes, [&](cl_int *err) {
+                    return clCreateBuffer(context_.get(), flags, num_bytes, host_ptr, err);
+                });
+            }
+
+            cl_mem memory_accountant::create_image(cl_mem_flags flags, const cl_image_format &format,
+                                                   const cl_image_desc &desc, size_t num_bytes) {
+                return allocate("clCreateImage", num_bytes, [&](cl_int *err) {
+                    return clCreateImage(context_.get(), flags, &format, &desc, nullptr, err);
+                });
+            }
+
+            cl_mem memory_accountant::allocate(const char *fname, size_t num_bytes,
+                                               const std::function<cl_mem(cl_int *)> &create) {
+                size_t budget;
+                {
+                    std::lock_guard<std::mutex> guard {mtx_};
+                    budget = budget_;
+                }
+                size_t current;
+                {
+                    std::lock_guard<std::mutex> guard {counters_->mtx};
+                    current = counters_->current;
+                }
+                if (budget > 0 && current + num_bytes > budget) {
+                    evict(current + num_bytes - budget);
+                }
+                cl_int err;
+                auto buffer = create(&err);
+                if (err == CL_MEM_OBJECT_ALLOCATION_FAILURE || err == CL_OUT_OF_RESOURCES) {
+                    ACTOR_LOG_WARNING("device allocation failed, evicting all caches:" << ACTOR_ARG(num_bytes));
+                    evict(std::numeric_limits<size_t>::max());
+                    buffer = create(&err);
+                }
+                throwcl(fname, err);
+                auto record = new allocation {counters_, num_bytes, reserved_size(num_bytes)};
+                {
+                    std::lock_guard<std::mutex> guard {counters_->mtx};
+                    counters_->current += record->num_bytes;
+                    counters_->reserved += record->reserved;
+                    counters_->allocations += 1;
+                    counters_->peak = std::max(counters_->peak, counters_->current);
+                }
+                err = clSetMemObjectDestructorCallback(buffer, release, record);
+                if (err != CL_SUCCESS) {
+                    ACTOR_LOG_WARNING("cannot track buffer:" << opencl_error(err));
+                    release(buffer, record);
+                }
+                return buffer;
+            }
+
+            void CL_CALLBACK memory_accountant::release(cl_mem, void *data) {
+                std::unique_ptr<allocation> record {static_cast<allocation *>(data)};
+                auto &c = *record->owner;
+                std::lock_guard<std::mutex> guard {c.mtx};
+                c.current -= record->num_bytes;
+                c.reserved -= record->reserved;
+                c.allocations -= 1;
+            }
+
+            void memory_accountant::add_evictor(evictor f) {
+                std::lock_guard<std::mutex> guard {mtx_};
+                evictors_.push_back(std::move(f));
+            }
+
+            void memory_accountant::budget(cl_ulong global_mem_size, double fraction) {
+                std::lock_guard<std::mutex> guard {mtx_};
+                budget_ = static_cast<size_t>(static_cast<double>(global_mem_size) * fraction);
+            }
+
+            memory_stats memory_accountant::stats() const {
+                memory_stats result;
+                {
+                    std::lock_guard<std::mutex> guard {mtx_};
+                    result.budget = budget_;
+                    result.evicted = evicted_;
+                }
+                std::lock_guard<std::mutex> guard {counters_->mtx};
+                result.current = counters_->current;
+                result.peak = counters_->peak;
+                result.allocations = counters_->allocations;
+                result.rounding_overhead =
+                    counters_->reserved > 0 ?
+                        1.0 - static_cast<double>(counters_->current) / static_cast<double>(counters_->reserved) :
+                        0.0;
+                return result;
+            }
+
+            size_t memory_accountant::evict(size_t num_bytes) {
+                // call evictors without holding the lock, they may allocate or release
+                std::vector<evictor> evictors;
+                {
+                    std::lock_guard<std::mutex> guard {mtx_};
+                    evictors = evictors_;
+                }
+                size_t released = 0;
+                for (auto &f : evictors) {
+                    if (released >= num_bytes) {
+                        break;
+                    }
+                    released += f(num_bytes - released);
+                }
+                std::lock_guard<std::mutex> guard {mtx_};
+                evicted_ += released;
+                return released;
+            }
+
+            size_t memory_accountant::reserved_size(size_t num_bytes) const {
+                return ((num_bytes + granularity_ - 1) / granularity_) * granularity_;
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
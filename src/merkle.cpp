@@ -0,0 +1,357 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <vector>
+#include <sstream>
+
+#include <nil/actor/sec.hpp>
+#include <nil/actor/logger.hpp>
+#include <nil/actor/raise_error.hpp>
+
+#include <nil/actor/cuda/merkle.hpp>
+#include <nil/actor/cuda/opencl_error.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            namespace {
+
+                constexpr const char *sha256_source = R"__(
+constant uint actor_sha256_k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+#define ACTOR_ROTR(x, n) rotate((uint) (x), (uint) (32 - (n)))
+
+void actor_sha256_compress(uint* state, const uint* block) {
+  uint w[64];
+  for (uint i = 0; i < 16; ++i)
+    w[i] = block[i];
+  for (uint i = 16; i < 64; ++i) {
+    uint s0 = ACTOR_ROTR(w[i - 15], 7) ^ ACTOR_ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint s1 = ACTOR_ROTR(w[i - 2], 17) ^ ACTOR_ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint a = state[0], b = state[1], c = state[2], d = state[3];
+  uint e = state[4], f = state[5], g = state[6], h = state[7];
+  for (uint i = 0; i < 64; ++i) {
+    uint t1 = h + (ACTOR_ROTR(e, 6) ^ ACTOR_ROTR(e, 11) ^ ACTOR_ROTR(e, 25)) + ((e & f) ^ (~e & g))
+              + actor_sha256_k[i] + w[i];
+    uint t2 = (ACTOR_ROTR(a, 2) ^ ACTOR_ROTR(a, 13) ^ ACTOR_ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+  state[5] += f;
+  state[6] += g;
+  state[7] += h;
+}
+
+void actor_merkle_hash(const uint* left, const uint* right, uint* out) {
+  uint block[16];
+  for (uint i = 0; i < 8; ++i) {
+    block[i] = left[i];
+    block[8 + i] = right[i];
+  }
+  out[0] = 0x6a09e667;
+  out[1] = 0xbb67ae85;
+  out[2] = 0x3c6ef372;
+  out[3] = 0xa54ff53a;
+  out[4] = 0x510e527f;
+  out[5] = 0x9b05688c;
+  out[6] = 0x1f83d9ab;
+  out[7] = 0x5be0cd19;
+  actor_sha256_compress(out, block);
+  // padding of a 64-byte message
+  block[0] = 0x80000000;
+  for (uint i = 1; i < 15; ++i)
+    block[i] = 0;
+  block[15] = 512;
+  actor_sha256_compress(out, block);
+}
+)__";
+
+                constexpr const char *merkle_kernels = R"__(
+/// Hashes the pairs of nodes starting at node `src` into the nodes starting
+/// at node `dst`.
+kernel void actor_merkle_level(global uint* arena, uint src, uint dst) {
+  uint i = get_global_id(0);
+  uint left[ACTOR_WORDS];
+  uint right[ACTOR_WORDS];
+  uint out[ACTOR_WORDS];
+  for (uint w = 0; w < ACTOR_WORDS; ++w) {
+    left[w] = arena[(src + 2 * i) * ACTOR_WORDS + w];
+    right[w] = arena[(src + 2 * i + 1) * ACTOR_WORDS + w];
+  }
+  actor_merkle_hash(left, right, out);
+  for (uint w = 0; w < ACTOR_WORDS; ++w)
+    arena[(dst + i) * ACTOR_WORDS + w] = out[w];
+}
+
+/// Gathers the sibling on each level for each leaf in `leaves`.
+kernel void actor_merkle_paths(global const uint* restrict arena,
+                               global const uint* restrict leaves,
+                               global uint* restrict paths,
+                               uint num_leaves, uint depth) {
+  uint gid = get_global_id(0);
+  uint level = gid % depth;
+  uint offset = 0;
+  uint width = num_leaves;
+  for (uint l = 0; l < level; ++l) {
+    offset += width;
+    width >>= 1;
+  }
+  uint sibling = (leaves[gid / depth] >> level) ^ 1;
+  for (uint w = 0; w < ACTOR_WORDS; ++w)
+    paths[gid * ACTOR_WORDS + w] = arena[(offset + sibling) * ACTOR_WORDS + w];
+}
+)__";
+
+                using uvec = std::vector<cl_uint>;
+
+                /// Keeps the buffers of a build alive and delivers its results once
+                /// the last read completed.
+                class merkle_job : public ref_counted, public completion_executor::job {
+                public:
+                    merkle_job(response_promise promise, message msg) :
+                        promise_(std::move(promise)), msg_(std::move(msg)), executor_(nullptr), with_paths_(false) {
+                        // nop
+                    }
+
+                    void run() override {
+                        if (!with_paths_) {
+                            promise_.deliver(std::move(root_));
+                        } else {
+                            promise_.deliver(std::move(root_), std::move(paths_));
+                        }
+                        this->deref();
+                    }
+
+                    /// Reserves the slot for the event of the next command.
+                    cl_event *add_event() {
+                        events_.emplace_back();
+                        return &events_.back();
+                    }
+
+                    ~merkle_job() override {
+                        for (auto e : events_) {
+                            if (e != nullptr) {
+                                clReleaseEvent(e);
+                            }
+                        }
+                    }
+
+                    response_promise promise_;
+                    message msg_;    // keeps the leaves alive for the async upload
+                    completion_executor *executor_;
+                    bool with_paths_;
+                    mem_ref<cl_uint> arena_;
+                    mem_ref<cl_uint> indices_;
+                    mem_ref<cl_uint> path_nodes_;
+                    uvec root_;
+                    uvec paths_;
+                    std::vector<cl_event> events_;
+                };
+
+            }    // namespace
+
+            merkle_hash sha256_merkle_hash() {
+                return {sha256_source, 8};
+            }
+
+            std::string merkle_source(const merkle_hash &hash) {
+                std::ostringstream out;
+                out << "#define ACTOR_WORDS " << hash.words << "\n" << hash.source << merkle_kernels;
+                return out.str();
+            }
+
+            actor merkle_builder::create(actor_config actor_conf, device_ptr dev, detail::raw_command_queue_ptr queue,
+                                         completion_executor *executor, detail::raw_kernel_ptr level_kernel,
+                                         detail::raw_kernel_ptr paths_kernel, size_t words) {
+                auto &sys = actor_conf.host->system();
+                return make_actor<merkle_builder, actor>(sys.next_actor_id(), sys.node(), &sys, std::move(actor_conf),
+                                                         std::move(dev), std::move(queue), executor,
+                                                         std::move(level_kernel), std::move(paths_kernel), words);
+            }
+
+            merkle_builder::merkle_builder(actor_config actor_conf, device_ptr dev,
+                                           detail::raw_command_queue_ptr queue, completion_executor *executor,
+                                           detail::raw_kernel_ptr level_kernel, detail::raw_kernel_ptr paths_kernel,
+                                           size_t words) :
+                local_actor(actor_conf),
+                device_(std::move(dev)), queue_(std::move(queue)), executor_(executor),
+                level_kernel_(std::move(level_kernel)), paths_kernel_(std::move(paths_kernel)), words_(words) {
+                ACTOR_LOG_TRACE(ACTOR_ARG(this->id()));
+            }
+
+            void merkle_builder::enqueue(mailbox_element_ptr ptr, execution_unit *) {
+                ACTOR_ASSERT(ptr != nullptr);
+                ACTOR_LOG_TRACE(ACTOR_ARG(*ptr));
+                response_promise promise {ctrl(), *ptr};
+                build(ptr->move_content_to_message(), std::move(promise));
+            }
+
+            void merkle_builder::enqueue(strong_actor_ptr sender, message_id mid, message content,
+                                         execution_unit *host) {
+                ACTOR_LOG_TRACE("");
+                enqueue(make_mailbox_element(std::move(sender), mid, {}, std::move(content)), host);
+            }
+
+            void merkle_builder::launch(execution_unit *, bool, bool) {
+                ACTOR_RAISE_ERROR("launch of the merkle builder should not be called");
+            }
+
+            void merkle_builder::build(message content, response_promise promise) {
+                auto with_paths = content.size() == 2 && content.match_element<uvec>(1);
+                auto by_value = (content.size() == 1 || with_paths) && content.match_element<uvec>(0);
+                auto by_ref = (content.size() == 1 || with_paths) && content.match_element<mem_ref<cl_uint>>(0);
+                if (!by_value && !by_ref) {
+                    ACTOR_LOG_ERROR("Message types do not match the expected signature.");
+                    promise.deliver(make_error(sec::unexpected_message));
+                    return;
+                }
+                auto num_words =
+                    by_value ? content.get_as<uvec>(0).size() : content.get_as<mem_ref<cl_uint>>(0).size();
+                auto num_leaves = num_words / words_;
+                auto valid =
+                    num_leaves >= 2 && (num_leaves & (num_leaves - 1)) == 0 && num_leaves * words_ == num_words;
+                if (valid && with_paths) {
+                    for (auto index : content.get_as<uvec>(1)) {
+                        valid = valid && index < num_leaves;
+                    }
+                }
+                if (!valid) {
+                    promise.deliver(make_error(sec::invalid_argument));
+                    return;
+                }
+                size_t depth = 0;
+                while ((size_t {1} << depth) < num_leaves) {
+                    ++depth;
+                }
+                auto job = make_counted<merkle_job>(std::move(promise), std::move(content));
+                job->with_paths_ = with_paths;
+                auto &msg = job->msg_;
+                auto word_size = sizeof(cl_uint);
+                job->arena_ = device_->scratch_argument<cl_uint>((2 * num_leaves - 1) * words_,
+                                                                   buffer_type::input_output);
+                auto arena = job->arena_.get().get();
+                // upload or copy the leaves to the front of the arena
+                if (by_value) {
+                    auto &leaves = msg.get_as<uvec>(0);
+                    v1callcl(ACTOR_CLF(clEnqueueWriteBuffer), queue_.get(), arena, cl_bool {CL_FALSE}, size_t {0},
+                             num_words * word_size, leaves.data(), cl_uint {0}, nullptr, job->add_event());
+                } else {
+                    auto leaves = msg.get_as<mem_ref<cl_uint>>(0);
+                    std::vector<cl_event> wait;
+                    auto e = leaves.take_event();
+                    if (e != nullptr) {
+                        wait.push_back(e);
+                        job->events_.push_back(e);
+                    }
+                    v1callcl(ACTOR_CLF(clEnqueueCopyBuffer), queue_.get(), leaves.get().get(), arena, size_t {0},
+                             size_t {0}, num_words * word_size, static_cast<cl_uint>(wait.size()),
+                             wait.empty() ? nullptr : wait.data(), job->add_event());
+                }
+                {
+                    std::lock_guard<std::mutex> guard {kernel_mtx_};
+                    // each level waits for the previous one on the out-of-order queue
+                    cl_uint src = 0;
+                    auto width = static_cast<cl_uint>(num_leaves);
+                    for (size_t level = 0; level < depth; ++level) {
+                        auto dst = src + width;
+                        size_t global = width / 2;
+                        auto prev = job->events_.back();
+                        v1callcl(ACTOR_CLF(clSetKernelArg), level_kernel_.get(), cl_uint {0}, sizeof(cl_mem),
+                                 static_cast<const void *>(&arena));
+                        v1callcl(ACTOR_CLF(clSetKernelArg), level_kernel_.get(), cl_uint {1}, sizeof(cl_uint),
+                                 static_cast<const void *>(&src));
+                        v1callcl(ACTOR_CLF(clSetKernelArg), level_kernel_.get(), cl_uint {2}, sizeof(cl_uint),
+                                 static_cast<const void *>(&dst));
+                        v1callcl(ACTOR_CLF(clEnqueueNDRangeKernel), queue_.get(), level_kernel_.get(), cl_uint {1},
+                                 nullptr, &global, nullptr, cl_uint {1}, &prev, job->add_event());
+                        src = dst;
+                        width /= 2;
+                    }
+                    job->root_.resize(words_);
+                    auto tree_event = job->events_.back();
+                    v1callcl(ACTOR_CLF(clEnqueueReadBuffer), queue_.get(), arena, cl_bool {CL_FALSE},
+                             (2 * num_leaves - 2) * words_ * word_size, words_ * word_size, job->root_.data(),
+                             cl_uint {1}, &tree_event, job->add_event());
+                    if (with_paths && !msg.get_as<uvec>(1).empty()) {
+                        auto &indices = msg.get_as<uvec>(1);
+                        job->indices_ = device_->global_argument(indices, buffer_type::input);
+                        auto upload = job->indices_.take_event();
+                        job->path_nodes_ = device_->scratch_argument<cl_uint>(indices.size() * depth * words_,
+                                                                              buffer_type::output);
+                        auto index_mem = job->indices_.get().get();
+                        auto path_mem = job->path_nodes_.get().get();
+                        auto leaves = static_cast<cl_uint>(num_leaves);
+                        auto levels = static_cast<cl_uint>(depth);
+                        size_t global = indices.size() * depth;
+                        job->events_.push_back(upload);
+                        cl_event wait[] = {tree_event, upload};
+                        v1callcl(ACTOR_CLF(clSetKernelArg), paths_kernel_.get(), cl_uint {0}, sizeof(cl_mem),
+                                 static_cast<const void *>(&arena));
+                        v1callcl(ACTOR_CLF(clSetKernelArg), paths_kernel_.get(), cl_uint {1}, sizeof(cl_mem),
+                                 static_cast<const void *>(&index_mem));
+                        v1callcl(ACTOR_CLF(clSetKernelArg), paths_kernel_.get(), cl_uint {2}, sizeof(cl_mem),
+                                 static_cast<const void *>(&path_mem));
+                        v1callcl(ACTOR_CLF(clSetKernelArg), paths_kernel_.get(), cl_uint {3}, sizeof(cl_uint),
+                                 static_cast<const void *>(&leaves));
+                        v1callcl(ACTOR_CLF(clSetKernelArg), paths_kernel_.get(), cl_uint {4}, sizeof(cl_uint),
+                                 static_cast<const void *>(&levels));
+                        v1callcl(ACTOR_CLF(clEnqueueNDRangeKernel), queue_.get(), paths_kernel_.get(), cl_uint {1},
+                                 nullptr, &global, nullptr, cl_uint {2}, wait, job->add_event());
+                        job->paths_.resize(global * words_);
+                        auto paths_event = job->events_.back();
+                        v1callcl(ACTOR_CLF(clEnqueueReadBuffer), queue_.get(), path_mem, cl_bool {CL_FALSE},
+                                 size_t {0}, job->paths_.size() * word_size, job->paths_.data(), cl_uint {1},
+                                 &paths_event, job->add_event());
+                    }
+                }
+                // completes once all commands of this build are done
+                cl_event marker;
+                v1callcl(ACTOR_CLF(clEnqueueMarkerWithWaitList), queue_.get(),
+                         static_cast<cl_uint>(job->events_.size()), job->events_.data(), &marker);
+                job->events_.push_back(marker);
+                job->executor_ = executor_;
+                job->ref();    // reference held by the OpenCL command queue
+                auto cb = [](cl_event, cl_int, void *data) {
+                    auto ptr = reinterpret_cast<merkle_job *>(data);
+                    if (ptr->executor_ != nullptr) {
+                        ptr->executor_->submit(ptr);
+                    } else {
+                        ptr->run();
+                    }
+                };
+                v1callcl(ACTOR_CLF(clSetEventCallback), marker, cl_int {CL_COMPLETE}, cb,
+                         static_cast<void *>(job.get()));
+                device_->flusher().request();
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
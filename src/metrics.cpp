@@ -0,0 +1,95 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <algorithm>
+
+#include <nil/actor/cuda/metrics.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            namespace {
+
+                const kernel_metrics *find_kernel(const metrics_snapshot &snapshot, actor_id id) {
+                    for (auto &dev : snapshot.devices) {
+                        for (auto &kernel : dev.kernels) {
+                            if (kernel.id == id) {
+                                return &kernel;
+                            }
+                        }
+                    }
+                    return nullptr;
+                }
+
+            }    // namespace
+
+            double metrics_snapshot::message_rate(const metrics_snapshot &earlier, actor_id id) const {
+                auto before = find_kernel(earlier, id);
+                auto after = find_kernel(*this, id);
+                std::chrono::duration<double> elapsed = time - earlier.time;
+                if (before == nullptr || after == nullptr || elapsed.count() <= 0) {
+                    return 0;
+                }
+                return static_cast<double>(after->messages - before->messages) / elapsed.count();
+            }
+
+            device_counters::device_counters() :
+                commands(0), in_flight(0), queue_depth(0), bytes_uploaded(0), bytes_downloaded(0), program_builds(0),
+                arg_sets(0), arg_sets_skipped(0), callbacks_(0), callback_latency_(0), max_callback_latency_(0) {
+                // nop
+            }
+
+            std::shared_ptr<device_counters::kernel_counter> device_counters::add_kernel(actor_id id,
+                                                                                         std::string name) {
+                auto result = std::make_shared<kernel_counter>(0);
+                std::unique_lock<std::mutex> guard {mtx_};
+                // drop the entries of terminated facades while we are at it
+                kernels_.erase(std::remove_if(kernels_.begin(), kernels_.end(),
+                                              [](const kernel_entry &x) { return x.counter.expired(); }),
+                               kernels_.end());
+                kernels_.push_back(kernel_entry {id, std::move(name), result});
+                return result;
+            }
+
+            void device_counters::record_callback(uint64_t latency) {
+                callbacks_.fetch_add(1, std::memory_order_relaxed);
+                callback_latency_.fetch_add(latency, std::memory_order_relaxed);
+                auto max = max_callback_latency_.load(std::memory_order_relaxed);
+                while (latency > max &&
+                       !max_callback_latency_.compare_exchange_weak(max, latency, std::memory_order_relaxed)) {
+                    // retry with the updated maximum
+                }
+            }
+
+            void device_counters::collect(device_metrics &result) const {
+                result.commands = commands.load(std::memory_order_relaxed);
+                result.in_flight = in_flight.load(std::memory_order_relaxed);
+                result.queue_depth = queue_depth.load(std::memory_order_relaxed);
+                result.bytes_uploaded = bytes_uploaded.load(std::memory_order_relaxed);
+                result.bytes_downloaded = bytes_downloaded.load(std::memory_order_relaxed);
+                result.program_builds = program_builds.load(std::memory_order_relaxed);
+                result.arg_sets = arg_sets.load(std::memory_order_relaxed);
+                result.arg_sets_skipped = arg_sets_skipped.load(std::memory_order_relaxed);
+                result.callbacks = callbacks_.load(std::memory_order_relaxed);
+                result.callback_latency = callback_latency_.load(std::memory_order_relaxed);
+                result.max_callback_latency = max_callback_latency_.load(std::memory_order_relaxed);
+                result.kernels.clear();
+                std::unique_lock<std::mutex> guard {mtx_};
+                for (auto &entry : kernels_) {
+                    if (auto counter = entry.counter.lock()) {
+                        result.kernels.push_back(
+                            kernel_metrics {entry.id, entry.name, counter->load(std::memory_order_relaxed)});
+                    }
+                }
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,419 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <algorithm>
+
+#include <nil/actor/raise_error.hpp>
+
+#include <nil/actor/cuda/msm.hpp>
+#include <nil/actor/cuda/field.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            namespace {
+
+                constexpr size_t max_window_bits = 16;
+
+                constexpr const char *msm_kernels = R"__(
+#define ACTOR_POINT_SIZE (3 * ACTOR_LIMBS)
+
+/// A point in Jacobian coordinates with all coordinates in Montgomery form,
+/// the point at infinity has z = 0.
+typedef struct {
+  actor_fe x;
+  actor_fe y;
+  actor_fe z;
+} actor_point;
+
+actor_point actor_point_infinity() {
+  actor_point r;
+  r.x = actor_fe_constant(actor_one);
+  r.y = actor_fe_constant(actor_one);
+  r.z = actor_fe_zero();
+  return r;
+}
+
+actor_point actor_point_load(global const uint* src, uint i) {
+  actor_point r;
+  r.x = actor_fe_load(src + i * ACTOR_POINT_SIZE, 0);
+  r.y = actor_fe_load(src + i * ACTOR_POINT_SIZE, 1);
+  r.z = actor_fe_load(src + i * ACTOR_POINT_SIZE, 2);
+  return r;
+}
+
+void actor_point_store(global uint* dst, uint i, actor_point p) {
+  actor_fe_store(dst + i * ACTOR_POINT_SIZE, 0, p.x);
+  actor_fe_store(dst + i * ACTOR_POINT_SIZE, 1, p.y);
+  actor_fe_store(dst + i * ACTOR_POINT_SIZE, 2, p.z);
+}
+
+actor_point actor_point_load_local(local const uint* src, uint i) {
+  actor_point r;
+  r.x = actor_fe_load_local(src + i * ACTOR_POINT_SIZE, 0);
+  r.y = actor_fe_load_local(src + i * ACTOR_POINT_SIZE, 1);
+  r.z = actor_fe_load_local(src + i * ACTOR_POINT_SIZE, 2);
+  return r;
+}
+
+void actor_point_store_local(local uint* dst, uint i, actor_point p) {
+  actor_fe_store_local(dst + i * ACTOR_POINT_SIZE, 0, p.x);
+  actor_fe_store_local(dst + i * ACTOR_POINT_SIZE, 1, p.y);
+  actor_fe_store_local(dst + i * ACTOR_POINT_SIZE, 2, p.z);
+}
+
+/// Loads the affine point `i` and converts it into Montgomery form, returns
+/// false for the point at infinity.
+bool actor_affine_load(global const uint* src, uint i, actor_fe* x, actor_fe* y) {
+  *x = actor_fe_load(src, 2 * i);
+  *y = actor_fe_load(src, 2 * i + 1);
+  if (actor_fe_is_zero(*x) && actor_fe_is_zero(*y))
+    return false;
+  actor_fe r2 = actor_fe_constant(actor_r2);
+  *x = actor_fe_mul(*x, r2);
+  *y = actor_fe_mul(*y, r2);
+  return true;
+}
+
+/// Doubling for a = 0 (dbl-2009-l).
+actor_point actor_point_double(actor_point p) {
+  if (actor_fe_is_zero(p.z))
+    return p;
+  actor_fe a = actor_fe_mul(p.x, p.x);
+  actor_fe b = actor_fe_mul(p.y, p.y);
+  actor_fe c = actor_fe_mul(b, b);
+  actor_fe t = actor_fe_add(p.x, b);
+  actor_fe d = actor_fe_sub(actor_fe_sub(actor_fe_mul(t, t), a), c);
+  d = actor_fe_add(d, d);
+  actor_fe e = actor_fe_add(actor_fe_add(a, a), a);
+  actor_fe c8 = actor_fe_add(c, c);
+  c8 = actor_fe_add(c8, c8);
+  c8 = actor_fe_add(c8, c8);
+  actor_point r;
+  r.x = actor_fe_sub(actor_fe_mul(e, e), actor_fe_add(d, d));
+  r.y = actor_fe_sub(actor_fe_mul(e, actor_fe_sub(d, r.x)), c8);
+  r.z = actor_fe_mul(p.y, p.z);
+  r.z = actor_fe_add(r.z, r.z);
+  return r;
+}
+
+/// Adds an affine point in Montgomery form (madd-2007-bl).
+actor_point actor_point_add_affine(actor_point p, actor_fe x, actor_fe y) {
+  actor_point r;
+  if (actor_fe_is_zero(p.z)) {
+    r.x = x;
+    r.y = y;
+    r.z = actor_fe_constant(actor_one);
+    return r;
+  }
+  actor_fe z1z1 = actor_fe_mul(p.z, p.z);
+  actor_fe u2 = actor_fe_mul(x, z1z1);
+  actor_fe s2 = actor_fe_mul(y, actor_fe_mul(p.z, z1z1));
+  actor_fe h = actor_fe_sub(u2, p.x);
+  actor_fe rr = actor_fe_sub(s2, p.y);
+  if (actor_fe_is_zero(h))
+    return actor_fe_is_zero(rr) ? actor_point_double(p) : actor_point_infinity();
+  rr = actor_fe_add(rr, rr);
+  actor_fe hh = actor_fe_mul(h, h);
+  actor_fe i = actor_fe_add(hh, hh);
+  i = actor_fe_add(i, i);
+  actor_fe j = actor_fe_mul(h, i);
+  actor_fe v = actor_fe_mul(p.x, i);
+  actor_fe y1j = actor_fe_mul(p.y, j);
+  r.x = actor_fe_sub(actor_fe_sub(actor_fe_mul(rr, rr), j), actor_fe_add(v, v));
+  r.y = actor_fe_sub(actor_fe_mul(rr, actor_fe_sub(v, r.x)), actor_fe_add(y1j, y1j));
+  actor_fe t = actor_fe_add(p.z, h);
+  r.z = actor_fe_sub(actor_fe_sub(actor_fe_mul(t, t), z1z1), hh);
+  return r;
+}
+
+/// Adds two points in Jacobian coordinates (add-2007-bl).
+actor_point actor_point_add(actor_point p, actor_point q) {
+  if (actor_fe_is_zero(p.z))
+    return q;
+  if (actor_fe_is_zero(q.z))
+    return p;
+  actor_fe z1z1 = actor_fe_mul(p.z, p.z);
+  actor_fe z2z2 = actor_fe_mul(q.z, q.z);
+  actor_fe u1 = actor_fe_mul(p.x, z2z2);
+  actor_fe u2 = actor_fe_mul(q.x, z1z1);
+  actor_fe s1 = actor_fe_mul(p.y, actor_fe_mul(q.z, z2z2));
+  actor_fe s2 = actor_fe_mul(q.y, actor_fe_mul(p.z, z1z1));
+  actor_fe h = actor_fe_sub(u2, u1);
+  actor_fe rr = actor_fe_sub(s2, s1);
+  if (actor_fe_is_zero(h))
+    return actor_fe_is_zero(rr) ? actor_point_double(p) : actor_point_infinity();
+  rr = actor_fe_add(rr, rr);
+  actor_fe i = actor_fe_add(h, h);
+  i = actor_fe_mul(i, i);
+  actor_fe j = actor_fe_mul(h, i);
+  actor_fe v = actor_fe_mul(u1, i);
+  actor_fe s1j = actor_fe_mul(s1, j);
+  actor_point r;
+  r.x = actor_fe_sub(actor_fe_sub(actor_fe_mul(rr, rr), j), actor_fe_add(v, v));
+  r.y = actor_fe_sub(actor_fe_mul(rr, actor_fe_sub(v, r.x)), actor_fe_add(s1j, s1j));
+  actor_fe t = actor_fe_add(p.z, q.z);
+  r.z = actor_fe_mul(actor_fe_sub(actor_fe_sub(actor_fe_mul(t, t), z1z1), z2z2), h);
+  return r;
+}
+
+actor_point actor_point_mul_small(actor_point p, uint k) {
+  actor_point r = actor_point_infinity();
+  for (int bit = 31; bit >= 0; --bit) {
+    r = actor_point_double(r);
+    if ((k >> bit) & 1)
+      r = actor_point_add(r, p);
+  }
+  return r;
+}
+
+actor_fe actor_fe_pow(actor_fe x, constant const uint* e) {
+  actor_fe r = actor_fe_constant(actor_one);
+  for (int bit = 32 * ACTOR_LIMBS - 1; bit >= 0; --bit) {
+    r = actor_fe_mul(r, r);
+    if ((e[bit / 32] >> (bit % 32)) & 1)
+      r = actor_fe_mul(r, x);
+  }
+  return r;
+}
+
+/// Stores `p` in affine coordinates and out of Montgomery form.
+void actor_point_store_affine(global uint* dst, uint i, actor_point p) {
+  actor_fe x = actor_fe_zero();
+  actor_fe y = actor_fe_zero();
+  if (!actor_fe_is_zero(p.z)) {
+    actor_fe one = actor_fe_zero();
+    one.v[0] = 1;
+    actor_fe zinv = actor_fe_pow(p.z, actor_p_minus_2);
+    actor_fe zinv2 = actor_fe_mul(zinv, zinv);
+    x = actor_fe_mul(actor_fe_mul(p.x, zinv2), one);
+    y = actor_fe_mul(actor_fe_mul(p.y, actor_fe_mul(zinv2, zinv)), one);
+  }
+  actor_fe_store(dst, 2 * i, x);
+  actor_fe_store(dst, 2 * i + 1, y);
+}
+
+/// Computes the digit of each scalar in each window and counts the points per
+/// bucket. Buckets of window `w` start at `counts[w * (ACTOR_BUCKETS + 1)]`.
+kernel void actor_msm_count(global uint* restrict points,
+                            global const uint* restrict scalars,
+                            global uint* restrict digits,
+                            global uint* restrict counts,
+                            uint num_points) {
+  uint gid = get_global_id(0);
+  uint w = gid / num_points;
+  uint i = gid % num_points;
+  uint bit = w * ACTOR_WINDOW;
+  uint limb = bit / 32;
+  ulong v = scalars[i * ACTOR_SCALAR_LIMBS + limb];
+  if (limb + 1 < ACTOR_SCALAR_LIMBS)
+    v |= (ulong) scalars[i * ACTOR_SCALAR_LIMBS + limb + 1] << 32;
+  uint d = (uint) (v >> (bit % 32)) & (ACTOR_BUCKETS - 1);
+  digits[gid] = d;
+  if (d != 0)
+    atomic_inc(counts + w * (ACTOR_BUCKETS + 1) + d);
+}
+
+/// Turns the counts of each window into the first index of each bucket.
+kernel void actor_msm_offsets(global uint* restrict points,
+                              global uint* restrict digits,
+                              global uint* restrict starts,
+                              global uint* restrict cursors) {
+  uint first = get_global_id(0) * (ACTOR_BUCKETS + 1);
+  uint acc = 0;
+  for (uint d = 0; d <= ACTOR_BUCKETS; ++d) {
+    uint x = starts[first + d];
+    starts[first + d] = acc;
+    cursors[first + d] = acc;
+    acc += x;
+  }
+}
+
+/// Sorts the point indices of each window by bucket. The order within a
+/// bucket is arbitrary, which does not affect the sum.
+kernel void actor_msm_scatter(global uint* restrict points,
+                              global const uint* restrict digits,
+                              global uint* restrict starts,
+                              global uint* restrict cursors,
+                              global uint* restrict indices,
+                              uint num_points) {
+  uint gid = get_global_id(0);
+  uint w = gid / num_points;
+  uint d = digits[gid];
+  if (d != 0) {
+    uint pos = atomic_inc(cursors + w * (ACTOR_BUCKETS + 1) + d);
+    indices[w * num_points + pos] = gid % num_points;
+  }
+}
+
+/// Sums the points of each bucket.
+kernel void actor_msm_buckets(global const uint* restrict points,
+                              global const uint* restrict starts,
+                              global const uint* restrict indices,
+                              global uint* restrict buckets,
+                              uint num_points) {
+  uint gid = get_global_id(0);
+  uint w = gid / ACTOR_BUCKETS;
+  uint d = gid % ACTOR_BUCKETS;
+  actor_point acc = actor_point_infinity();
+  if (d != 0) {
+    global const uint* first = starts + w * (ACTOR_BUCKETS + 1);
+    for (uint k = first[d]; k < first[d + 1]; ++k) {
+      actor_fe x;
+      actor_fe y;
+      if (actor_affine_load(points, indices[w * num_points + k], &x, &y))
+        acc = actor_point_add_affine(acc, x, y);
+    }
+  }
+  actor_point_store(buckets, gid, acc);
+}
+
+/// Computes the sum of d * bucket[d] for each window with one work group per
+/// window. Each work item reduces a contiguous slice of buckets with running
+/// sums before the group combines the slices in local memory.
+kernel void actor_msm_windows(global const uint* restrict buckets,
+                              global uint* restrict windows,
+                              local uint* scratch) {
+  uint w = get_group_id(0);
+  uint lid = get_local_id(0);
+  uint size = get_local_size(0);
+  uint per_item = (ACTOR_BUCKETS - 1 + size - 1) / size;
+  uint lo = min(1 + lid * per_item, (uint) ACTOR_BUCKETS);
+  uint hi = min(lo + per_item, (uint) ACTOR_BUCKETS);
+  actor_point running = actor_point_infinity();
+  actor_point sum = actor_point_infinity();
+  for (uint d = hi; d > lo; --d) {
+    running = actor_point_add(running, actor_point_load(buckets, w * ACTOR_BUCKETS + d - 1));
+    sum = actor_point_add(sum, running);
+  }
+  // the slice contributes (d - lo + 1) * bucket[d] so far
+  sum = actor_point_add(sum, actor_point_mul_small(running, lo - 1));
+  actor_point_store_local(scratch, lid, sum);
+  for (uint stride = size / 2; stride > 0; stride /= 2) {
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (lid < stride) {
+      actor_point a = actor_point_load_local(scratch, lid);
+      actor_point b = actor_point_load_local(scratch, lid + stride);
+      actor_point_store_local(scratch, lid, actor_point_add(a, b));
+    }
+  }
+  if (lid == 0)
+    actor_point_store(windows, w, actor_point_load_local(scratch, 0));
+}
+
+/// Combines the window sums and stores the result in affine coordinates.
+kernel void actor_msm_final(global const uint* restrict windows,
+                            global uint* restrict result) {
+  actor_point acc = actor_point_load(windows, ACTOR_WINDOWS - 1);
+  for (int w = ACTOR_WINDOWS - 2; w >= 0; --w) {
+    for (uint k = 0; k < ACTOR_WINDOW; ++k)
+      acc = actor_point_double(acc);
+    acc = actor_point_add(acc, actor_point_load(windows, w));
+  }
+  actor_point_store_affine(result, 0, acc);
+}
+
+/// Sums `count` affine points, e.g., the partial results of several devices.
+kernel void actor_msm_sum(global const uint* restrict points,
+                          global uint* restrict result,
+                          uint count) {
+  actor_point acc = actor_point_infinity();
+  for (uint i = 0; i < count; ++i) {
+    actor_fe x;
+    actor_fe y;
+    if (actor_affine_load(points, i, &x, &y))
+      acc = actor_point_add_affine(acc, x, y);
+  }
+  actor_point_store_affine(result, 0, acc);
+}
+)__";
+
+                void write_constant(std::ostream &out, const char *name, const montgomery_field::limbs &value) {
+                    out << "constant uint " << name << "[ACTOR_LIMBS] = {";
+                    for (size_t i = 0; i < value.size(); ++i) {
+                        out << (i == 0 ? "" : ", ") << value[i] << "u";
+                    }
+                    out << "};\n";
+                }
+
+                size_t log2_floor(size_t x) {
+                    size_t result = 0;
+                    while (x > 1) {
+                        x >>= 1;
+                        ++result;
+                    }
+                    return result;
+                }
+
+            }    // namespace
+
+            std::string msm_source(const msm_curve &curve, size_t window_bits) {
+                if (window_bits == 0 || window_bits > max_window_bits || curve.scalar_bits == 0) {
+                    ACTOR_RAISE_ERROR("unsupported MSM window size");
+                }
+                montgomery_field fp {curve.modulus};
+                auto p_minus_2 = fp.modulus();
+                for (size_t i = 0, borrow = 2; i < p_minus_2.size() && borrow != 0; ++i) {
+                    auto limb = p_minus_2[i];
+                    p_minus_2[i] = limb - static_cast<cl_uint>(borrow);
+                    borrow = limb < borrow ? 1 : 0;
+                }
+                std::ostringstream out;
+                out << fp.source();
+                out << "#define ACTOR_WINDOW " << window_bits << "\n"
+                    << "#define ACTOR_WINDOWS " << msm_num_windows(curve, window_bits) << "\n"
+                    << "#define ACTOR_BUCKETS " << (size_t {1} << window_bits) << "\n"
+                    << "#define ACTOR_SCALAR_LIMBS " << curve.scalar_limbs() << "\n";
+                write_constant(out, "actor_one", fp.one());
+                write_constant(out, "actor_r2", fp.r2());
+                write_constant(out, "actor_p_minus_2", p_minus_2);
+                out << msm_kernels;
+                return out.str();
+            }
+
+            size_t msm_group_size(const device &dev, const msm_curve &curve, size_t window_bits) {
+                auto bytes_per_point = 3 * curve.limbs() * sizeof(cl_uint);
+                auto limit = std::min({dev.max_work_group_size(),
+                                       static_cast<size_t>(dev.local_mem_size()) / bytes_per_point,
+                                       size_t {1} << window_bits});
+                return size_t {1} << log2_floor(std::max(limit, size_t {1}));
+            }
+
+            size_t msm_window_bits(const device &dev, const msm_curve &curve, size_t num_points) {
+                // rough number of work items that run concurrently
+                auto lanes = static_cast<double>(std::max(dev.max_compute_units(), cl_uint {1})) * 64;
+                auto points = static_cast<double>(std::max(num_points, size_t {1}));
+                size_t result = 1;
+                auto best = std::numeric_limits<double>::max();
+                for (size_t c = 1; c <= max_window_bits && c <= curve.scalar_bits; ++c) {
+                    auto windows = static_cast<double>(msm_num_windows(curve, c));
+                    auto buckets = static_cast<double>(size_t {1} << c);
+                    auto group = static_cast<double>(msm_group_size(dev, curve, c));
+                    // one work item per bucket adds points / buckets points on average
+                    auto accumulate = points / buckets * std::ceil(windows * buckets / lanes);
+                    // one group per window, two additions per bucket and a tree in local memory
+                    auto reduce = (2 * buckets / group + std::log2(group)) * std::ceil(windows * group / lanes);
+                    // the final combination doubles c times per window
+                    auto combine = windows * static_cast<double>(c + 1);
+                    auto cost = accumulate + reduce + combine;
+                    if (cost < best) {
+                        best = cost;
+                        result = c;
+                    }
+                }
+                return result;
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,129 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <nil/actor/raise_error.hpp>
+
+#include <nil/actor/cuda/nd_range.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            namespace {
+
+                void check_local(const dim_vec &dimensions, const dim_vec &local_dimensions) {
+                    if (local_dimensions.size() != dimensions.size()) {
+                        ACTOR_RAISE_ERROR("remainder policies require a local size for each dimension");
+                    }
+                    for (auto x : local_dimensions) {
+                        if (x == 0) {
+                            ACTOR_RAISE_ERROR("local dimensions must not be zero");
+                        }
+                    }
+                }
+
+                const size_t *data_or_nullptr(const dim_vec &vec) {
+                    return vec.empty() ? nullptr : vec.data();
+                }
+
+            }    // namespace
+
+            std::vector<nd_range> nd_range::launches() const {
+                std::vector<nd_range> result;
+                if (policy_ != remainder_policy::split) {
+                    result.push_back(*this);
+                    return result;
+                }
+                // each dimension has a full part and a remainder, both may be empty
+                auto n = dims_.size();
+                for (size_t mask = 0; mask < (size_t {1} << n); ++mask) {
+                    dim_vec dims;
+                    dim_vec offsets;
+                    dim_vec local;
+                    for (size_t i = 0; i < n; ++i) {
+                        auto full = dims_[i] / local_dims_[i] * local_dims_[i];
+                        auto offset = offset_.empty() ? size_t {0} : offset_[i];
+                        if ((mask & (size_t {1} << i)) == 0) {
+                            dims.push_back(full);
+                            offsets.push_back(offset);
+                            local.push_back(local_dims_[i]);
+                        } else {
+                            dims.push_back(dims_[i] - full);
+                            offsets.push_back(offset + full);
+                            local.push_back(dims_[i] - full);
+                        }
+                    }
+                    bool empty = false;
+                    for (auto x : dims) {
+                        empty = empty || x == 0;
+                    }
+                    if (!empty) {
+                        result.emplace_back(std::move(dims), std::move(offsets), std::move(local));
+                    }
+                }
+                return result;
+            }
+
+            nd_range nd_range::padded(const dim_vec &dimensions, const dim_vec &local_dimensions,
+                                      const dim_vec &offsets) {
+                check_local(dimensions, local_dimensions);
+                dim_vec dims;
+                for (size_t i = 0; i < dimensions.size(); ++i) {
+                    dims.push_back((dimensions[i] + local_dimensions[i] - 1) / local_dimensions[i] *
+                                   local_dimensions[i]);
+                }
+                nd_range result {dims, offsets, local_dimensions};
+                result.real_dims_ = dimensions;
+                result.policy_ = remainder_policy::pad;
+                return result;
+            }
+
+            nd_range nd_range::split(const dim_vec &dimensions, const dim_vec &local_dimensions,
+                                     const dim_vec &offsets) {
+                check_local(dimensions, local_dimensions);
+                nd_range result {dimensions, offsets, local_dimensions};
+                result.policy_ = remainder_policy::split;
+                return result;
+            }
+
+            cl_int enqueue_nd_range(cl_command_queue queue, cl_kernel kernel, const nd_range &range,
+                                    cl_uint num_events, const cl_event *events, cl_event *event) {
+                auto launch = [&](const nd_range &x, cl_event *launched) {
+                    return clEnqueueNDRangeKernel(queue, kernel, static_cast<cl_uint>(x.dimensions().size()),
+                                                  data_or_nullptr(x.offsets()), data_or_nullptr(x.dimensions()),
+                                                  data_or_nullptr(x.local_dimensions()), num_events,
+                                                  num_events > 0 ? events : nullptr, launched);
+                };
+                if (range.policy() != remainder_policy::split) {
+                    return launch(range, event);
+                }
+                auto tiles = range.launches();
+                std::vector<cl_event> launched;
+                cl_int err = CL_SUCCESS;
+                for (auto &tile : tiles) {
+                    cl_event e;
+                    err = launch(tile, &e);
+                    if (err != CL_SUCCESS) {
+                        break;
+                    }
+                    launched.push_back(e);
+                }
+                if (err == CL_SUCCESS) {
+                    err = clEnqueueMarkerWithWaitList(queue, static_cast<cl_uint>(launched.size()),
+                                                      launched.empty() ? nullptr : launched.data(), event);
+                }
+                for (auto e : launched) {
+                    clReleaseEvent(e);
+                }
+                return err;
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
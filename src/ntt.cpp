@@ -0,0 +1,210 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <algorithm>
+
+#include <nil/actor/raise_error.hpp>
+
+#include <nil/actor/cuda/ntt.hpp>
+#include <nil/actor/cuda/field.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            namespace {
+
+                constexpr const char *ntt_kernels = R"__(
+void actor_butterfly(actor_fe* a, actor_fe* b, actor_fe w) {
+  actor_fe t = actor_fe_mul(*b, w);
+  *b = actor_fe_sub(*a, t);
+  *a = actor_fe_add(*a, t);
+}
+
+uint actor_bit_reverse(uint x, uint bits) {
+  uint r = 0;
+  for (uint i = 0; i < bits; ++i) {
+    r = (r << 1) | (x & 1);
+    x >>= 1;
+  }
+  return r;
+}
+
+/// Loads a block in bit-reversed order and performs all radix-2 stages that
+/// stay within the block in local memory.
+kernel void actor_ntt_local(global const uint* restrict input,
+                            global const uint* restrict twiddles,
+                            global uint* restrict output,
+                            local uint* tmp, uint log_n) {
+  uint lid = get_local_id(0);
+  uint half = get_local_size(0);
+  uint block = 2 * half;
+  uint first = get_group_id(0) * block;
+  uint n = 1u << log_n;
+  for (uint e = lid; e < block; e += half)
+    actor_fe_store_local(tmp, e,
+                         actor_fe_load(input, actor_bit_reverse(first + e, log_n)));
+  for (uint h = 1; h < block; h <<= 1) {
+    barrier(CLK_LOCAL_MEM_FENCE);
+    uint j = lid & (h - 1);
+    uint a = (lid - j) * 2 + j;
+    actor_fe x = actor_fe_load_local(tmp, a);
+    actor_fe y = actor_fe_load_local(tmp, a + h);
+    actor_butterfly(&x, &y, actor_fe_load(twiddles, j * (n / (2 * h))));
+    actor_fe_store_local(tmp, a, x);
+    actor_fe_store_local(tmp, a + h, y);
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+  for (uint e = lid; e < block; e += half)
+    actor_fe_store(output, first + e, actor_fe_load_local(tmp, e));
+}
+
+/// Performs the radix-2 stage that combines blocks of `2^stage` elements.
+kernel void actor_ntt_radix2(global uint* restrict data,
+                             global const uint* restrict twiddles,
+                             uint log_n, uint stage) {
+  uint t = get_global_id(0);
+  uint h = 1u << stage;
+  uint j = t & (h - 1);
+  uint a = (t - j) * 2 + j;
+  actor_fe x = actor_fe_load(data, a);
+  actor_fe y = actor_fe_load(data, a + h);
+  actor_butterfly(&x, &y, actor_fe_load(twiddles, j << (log_n - stage - 1)));
+  actor_fe_store(data, a, x);
+  actor_fe_store(data, a + h, y);
+}
+
+/// Performs the two radix-2 stages that combine blocks of `2^stage` elements
+/// to blocks of `2^(stage + 2)` elements at once.
+kernel void actor_ntt_radix4(global uint* restrict data,
+                             global const uint* restrict twiddles,
+                             uint log_n, uint stage) {
+  uint t = get_global_id(0);
+  uint h = 1u << stage;
+  uint j = t & (h - 1);
+  uint a = (t - j) * 4 + j;
+  actor_fe x0 = actor_fe_load(data, a);
+  actor_fe x1 = actor_fe_load(data, a + h);
+  actor_fe x2 = actor_fe_load(data, a + 2 * h);
+  actor_fe x3 = actor_fe_load(data, a + 3 * h);
+  actor_fe w = actor_fe_load(twiddles, j << (log_n - stage - 1));
+  actor_butterfly(&x0, &x1, w);
+  actor_butterfly(&x2, &x3, w);
+  actor_butterfly(&x0, &x2, actor_fe_load(twiddles, j << (log_n - stage - 2)));
+  actor_butterfly(&x1, &x3, actor_fe_load(twiddles, (j + h) << (log_n - stage - 2)));
+  actor_fe_store(data, a, x0);
+  actor_fe_store(data, a + h, x1);
+  actor_fe_store(data, a + 2 * h, x2);
+  actor_fe_store(data, a + 3 * h, x3);
+}
+
+/// Multiplies each element with 2^-log_n, which is stored after the twiddles.
+kernel void actor_ntt_scale(global uint* restrict data,
+                            global const uint* restrict twiddles,
+                            uint log_n) {
+  uint i = get_global_id(0);
+  actor_fe factor = actor_fe_load(twiddles, 1u << (log_n - 1));
+  actor_fe_store(data, i, actor_fe_mul(actor_fe_load(data, i), factor));
+}
+
+/// Multiplies each element with `factor` in Montgomery form.
+kernel void actor_ntt_convert(global uint* restrict data,
+                              global const uint* restrict factor) {
+  uint i = get_global_id(0);
+  actor_fe_store(data, i, actor_fe_mul(actor_fe_load(data, i), actor_fe_load(factor, 0)));
+}
+)__";
+
+                montgomery_field make_field(const ntt_field &field) {
+                    montgomery_field result {field.modulus};
+                    if (field.root_of_unity.size() != field.limbs()) {
+                        ACTOR_RAISE_ERROR("invalid root of unity for the NTT");
+                    }
+                    return result;
+                }
+
+            }    // namespace
+
+            std::string ntt_source(const ntt_field &field) {
+                return make_field(field).source() + ntt_kernels;
+            }
+
+            std::vector<cl_uint> ntt_twiddles(const ntt_field &field, size_t log_size, bool inverse) {
+                auto fp = make_field(field);
+                if (log_size == 0 || log_size > field.two_adicity || log_size > 31) {
+                    ACTOR_RAISE_ERROR("unsupported NTT size");
+                }
+                // the root of unity of order 2^log_size
+                auto root = fp.to_montgomery(field.root_of_unity);
+                for (auto i = log_size; i < field.two_adicity; ++i) {
+                    root = fp.mul(root, root);
+                }
+                if (inverse) {
+                    // root^(2^log_size - 1) is the product of all root^(2^i) with i < log_size
+                    auto power = root;
+                    auto result = fp.one();
+                    for (size_t i = 0; i < log_size; ++i) {
+                        result = fp.mul(result, power);
+                        power = fp.mul(power, power);
+                    }
+                    root = std::move(result);
+                }
+                size_t half = size_t {1} << (log_size - 1);
+                std::vector<cl_uint> result;
+                result.reserve((half + 1) * fp.size());
+                auto x = fp.one();
+                for (size_t i = 0; i < half; ++i) {
+                    result.insert(result.end(), x.begin(), x.end());
+                    x = fp.mul(x, root);
+                }
+                if (inverse) {
+                    // 2^-1 = (p + 1) / 2 for odd p
+                    auto &p = fp.modulus();
+                    montgomery_field::limbs half_one(p.size(), 0);
+                    for (size_t i = 0; i < p.size(); ++i) {
+                        half_one[i] = (p[i] >> 1) | (i + 1 < p.size() ? p[i + 1] << 31 : 0);
+                    }
+                    for (size_t i = 0; i < p.size() && ++half_one[i] == 0; ++i) {
+                        // propagate the carry
+                    }
+                    auto factor = fp.to_montgomery(half_one);
+                    auto scale = factor;
+                    for (size_t i = 1; i < log_size; ++i) {
+                        scale = fp.mul(scale, factor);
+                    }
+                    result.insert(result.end(), scale.begin(), scale.end());
+                }
+                return result;
+            }
+
+            std::vector<cl_uint> ntt_conversion_factor(const ntt_field &field, bool to_montgomery) {
+                auto fp = make_field(field);
+                if (!to_montgomery) {
+                    montgomery_field::limbs result(fp.size(), 0);
+                    result[0] = 1;
+                    return result;
+                }
+                return fp.r2();
+            }
+
+            size_t ntt_block_size(const device &dev, const ntt_field &field, size_t n) {
+                auto bytes_per_element = field.limbs() * sizeof(cl_uint);
+                // each work item handles two elements of the block
+                auto limit = std::min(2 * dev.max_work_group_size(),
+                                      static_cast<size_t>(dev.local_mem_size()) / bytes_per_element);
+                size_t result = 2;
+                while (result * 2 <= limit && result * 2 <= n) {
+                    result *= 2;
+                }
+                return result;
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
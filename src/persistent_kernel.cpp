@@ -0,0 +1,249 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+#include <nil/actor/sec.hpp>
+#include <nil/actor/logger.hpp>
+#include <nil/actor/raise_error.hpp>
+
+#include <nil/actor/detail/scope_guard.hpp>
+
+#include <nil/actor/cuda/opencl_error.hpp>
+#include <nil/actor/cuda/persistent_kernel.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            const char *persistent_kernel_prelude = R"__(
+#define ACTOR_PERSISTENT_KERNEL(name, in_type, out_type, fn)                                       \
+  kernel void name(global atomic_uint* control, global atomic_uint* states,                        \
+                   global const in_type* inputs, global out_type* outputs, uint capacity) {        \
+    uint lanes = (uint) get_local_size(0);                                                         \
+    uint next = (uint) get_local_id(0);                                                            \
+    while (atomic_load_explicit(control, memory_order_acquire,                                     \
+                                memory_scope_all_svm_devices) == 0) {                              \
+      if (atomic_load_explicit(&states[next], memory_order_acquire,                                \
+                               memory_scope_all_svm_devices) != 1)                                 \
+        continue;                                                                                  \
+      fn(&inputs[next], &outputs[next]);                                                           \
+      atomic_store_explicit(&states[next], 2, memory_order_release,                                \
+                            memory_scope_all_svm_devices);                                         \
+      next = (next + lanes) % capacity;                                                            \
+    }                                                                                              \
+  }
+)__";
+
+            namespace {
+
+                // keeps the sections of the ring on separate cache lines
+                constexpr size_t ring_alignment = 128;
+
+                size_t align_up(size_t x) {
+                    return (x + ring_alignment - 1) / ring_alignment * ring_alignment;
+                }
+
+                // spins before the poller starts to sleep between checks
+                constexpr size_t max_idle_spins = 1024;
+
+                // returns the largest divisor of `capacity` that does not exceed
+                // `max_lanes`, i.e., each slot of the ring belongs to one lane
+                size_t num_lanes(size_t capacity, size_t max_lanes) {
+                    auto result = std::max(std::min(capacity, max_lanes), size_t {1});
+                    while (capacity % result != 0) {
+                        --result;
+                    }
+                    return result;
+                }
+
+            }    // namespace
+
+            persistent_kernel::persistent_kernel(device_ptr dev, detail::raw_kernel_ptr kernel, size_t capacity,
+                                                 size_t input_size, size_t output_size, deliver_fun deliver) :
+                device_(std::move(dev)),
+                kernel_(std::move(kernel)), capacity_(std::max(capacity, size_t {1})), input_size_(input_size),
+                output_size_(output_size), deliver_(deliver), ring_(nullptr), inputs_(nullptr), outputs_(nullptr),
+                running_(false), promises_(capacity_), submitted_(0), completed_(0) {
+                // nop
+            }
+
+            persistent_kernel::~persistent_kernel() {
+                shutdown();
+            }
+
+            void persistent_kernel::start() {
+#ifdef CL_VERSION_2_0
+                if (!device_->svm_atomics()) {
+                    ACTOR_RAISE_ERROR("persistent kernels require fine-grained SVM buffers with atomics");
+                }
+                auto states_offset = ring_alignment;
+                auto inputs_offset = states_offset + align_up(sizeof(cl_uint) * capacity_);
+                auto outputs_offset = inputs_offset + align_up(input_size_ * capacity_);
+                auto total = outputs_offset + align_up(output_size_ * capacity_);
+                ring_ = clSVMAlloc(device_->context_.get(),
+                                   CL_MEM_READ_WRITE | CL_MEM_SVM_FINE_GRAIN_BUFFER | CL_MEM_SVM_ATOMICS, total,
+                                   ring_alignment);
+                if (ring_ == nullptr) {
+                    ACTOR_RAISE_ERROR("clSVMAlloc failed");
+                }
+                std::memset(ring_, 0, total);
+                auto base = static_cast<char *>(ring_);
+                inputs_ = base + inputs_offset;
+                outputs_ = base + outputs_offset;
+                auto kernel = kernel_.get();
+                auto num_slots = static_cast<cl_uint>(capacity_);
+                bool launched = false;
+                // releases the ring if anything below fails
+                auto ring_guard = detail::make_scope_guard([&] {
+                    if (launched) {
+                        // the kernel may already poll the ring
+                        control().store(1, std::memory_order_release);
+                        clFinish(queue_.get());
+                    }
+                    clSVMFree(device_->context_.get(), ring_);
+                    ring_ = nullptr;
+                    inputs_ = nullptr;
+                    outputs_ = nullptr;
+                });
+                v1callcl(ACTOR_CLF(clSetKernelArgSVMPointer), kernel, 0u, static_cast<const void *>(base));
+                v1callcl(ACTOR_CLF(clSetKernelArgSVMPointer), kernel, 1u,
+                         static_cast<const void *>(base + states_offset));
+                v1callcl(ACTOR_CLF(clSetKernelArgSVMPointer), kernel, 2u, static_cast<const void *>(inputs_));
+                v1callcl(ACTOR_CLF(clSetKernelArgSVMPointer), kernel, 3u, static_cast<const void *>(outputs_));
+                v1callcl(ACTOR_CLF(clSetKernelArg), kernel, 4u, sizeof(cl_uint),
+                         static_cast<const void *>(&num_slots));
+                // the kernel occupies its queue until shutdown, hence it gets a queue of its own
+                queue_ = device_->create_queue();
+                // a single work-group, lane i serves the slots i, i + lanes, ... such
+                // that consecutive requests run side by side
+                auto max_lanes = v3get<size_t>(ACTOR_CLF(clGetKernelWorkGroupInfo), kernel, device_->device_id_.get(),
+                                               cl_kernel_work_group_info {CL_KERNEL_WORK_GROUP_SIZE});
+                size_t group_size = num_lanes(capacity_, max_lanes);
+                v1callcl(ACTOR_CLF(clEnqueueNDRangeKernel), queue_.get(), kernel, 1u, nullptr, &group_size,
+                         &group_size, 0u, nullptr, nullptr);
+                launched = true;
+                v1callcl(ACTOR_CLF(clFlush), queue_.get());
+                ring_guard.disable();
+                running_ = true;
+                poller_ = std::thread {[this] { poll_loop(); }};
+#else
+                ACTOR_RAISE_ERROR("persistent kernels require OpenCL 2.0");
+#endif
+            }
+
+            void persistent_kernel::submit(const void *input, response_promise promise) {
+                std::unique_lock<std::mutex> guard {mtx_};
+                if (!running_) {
+                    guard.unlock();
+                    promise.deliver(make_error(sec::runtime_error, "persistent kernel stopped"));
+                    return;
+                }
+                if (backlog_.empty() && submitted_ - completed_ < capacity_) {
+                    publish(input, std::move(promise));
+                    cv_.notify_one();
+                    return;
+                }
+                auto first = static_cast<const char *>(input);
+                backlog_.emplace_back(std::vector<char>(first, first + input_size_), std::move(promise));
+            }
+
+            void persistent_kernel::shutdown() {
+                if (!running_.exchange(false)) {
+                    return;
+                }
+                control().store(1, std::memory_order_release);
+                {
+                    std::lock_guard<std::mutex> guard {mtx_};
+                    cv_.notify_all();
+                }
+                poller_.join();
+                v3callcl(clFinish, queue_.get());
+                std::lock_guard<std::mutex> guard {mtx_};
+                for (; completed_ != submitted_; ++completed_) {
+                    auto &promise = promises_[completed_ % capacity_];
+                    promise.deliver(make_error(sec::runtime_error, "persistent kernel stopped"));
+                }
+                for (auto &x : backlog_) {
+                    x.second.deliver(make_error(sec::runtime_error, "persistent kernel stopped"));
+                }
+                backlog_.clear();
+#ifdef CL_VERSION_2_0
+                clSVMFree(device_->context_.get(), ring_);
+#endif
+                ring_ = nullptr;
+            }
+
+            bool persistent_kernel::running() const {
+                return running_;
+            }
+
+            size_t persistent_kernel::capacity() const {
+                return capacity_;
+            }
+
+            void persistent_kernel::publish(const void *input, response_promise promise) {
+                auto slot = submitted_ % capacity_;
+                std::memcpy(inputs_ + slot * input_size_, input, input_size_);
+                promises_[slot] = std::move(promise);
+                ++submitted_;
+                // makes the descriptor visible to the kernel
+                state(slot).store(slot_submitted, std::memory_order_release);
+            }
+
+            void persistent_kernel::poll_loop() {
+                ACTOR_LOG_TRACE("");
+                size_t idle = 0;
+                std::unique_lock<std::mutex> guard {mtx_};
+                while (running_) {
+                    if (submitted_ == completed_) {
+                        cv_.wait(guard, [&] { return !running_ || submitted_ != completed_; });
+                        continue;
+                    }
+                    auto slot = completed_ % capacity_;
+                    if (state(slot).load(std::memory_order_acquire) != slot_completed) {
+                        guard.unlock();
+                        if (++idle < max_idle_spins) {
+                            std::this_thread::yield();
+                        } else {
+                            std::this_thread::sleep_for(std::chrono::microseconds(20));
+                        }
+                        guard.lock();
+                        continue;
+                    }
+                    idle = 0;
+                    auto promise = std::move(promises_[slot]);
+                    // only this thread frees slots, i.e., the output stays valid
+                    guard.unlock();
+                    deliver_(promise, outputs_ + slot * output_size_);
+                    guard.lock();
+                    state(slot).store(slot_free, std::memory_order_release);
+                    ++completed_;
+                    if (!backlog_.empty()) {
+                        auto next = std::move(backlog_.front());
+                        backlog_.pop_front();
+                        publish(next.first.data(), std::move(next.second));
+                    }
+                }
+            }
+
+            std::atomic<cl_uint> &persistent_kernel::control() {
+                return *reinterpret_cast<std::atomic<cl_uint> *>(ring_);
+            }
+
+            std::atomic<cl_uint> &persistent_kernel::state(size_t slot) {
+                auto states = reinterpret_cast<std::atomic<cl_uint> *>(static_cast<char *>(ring_) + ring_alignment);
+                return states[slot];
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
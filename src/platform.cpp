@@ -18,7 +18,7 @@ namespace nil {
     namespace actor {
         namespace cuda {
 
-            platform_ptr platform::create(cl_platform_id platform_id, unsigned start_id) {
+            platform_ptr platform::create(cl_platform_id platform_id, unsigned start_id, tracer *trace) {
                 std::vector<unsigned> device_types = {CL_DEVICE_TYPE_GPU, CL_DEVICE_TYPE_ACCELERATOR,
                                                       CL_DEVICE_TYPE_CPU};
                 std::vector<cl_device_id> ids;
@@ -44,7 +44,7 @@ namespace nil {
                               false);
                 std::vector<device_ptr> device_information;
                 for (auto &device_id : devices) {
-                    device_information.push_back(device::create(context, device_id, start_id++));
+                    device_information.push_back(device::create(context, device_id, start_id++, trace));
                 }
                 if (device_information.empty())
                     ACTOR_RAISE_ERROR("no devices for the platform found");
@@ -0,0 +1,311 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+
+#include <nil/actor/cuda/primitives.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            namespace {
+
+                // Each group of the chunked kernels processes a contiguous chunk of the
+                // input in tiles of its size, which keeps the order of the elements for
+                // scans and allows inputs of any length with a fixed number of passes.
+                constexpr const char *primitives_kernels = R"__(
+uint actor_chunk_first(uint len) {
+  uint groups = get_num_groups(0);
+  uint chunk = (len + groups - 1) / groups;
+  return min((uint) get_group_id(0) * chunk, len);
+}
+
+uint actor_chunk_last(uint len) {
+  uint groups = get_num_groups(0);
+  uint chunk = (len + groups - 1) / groups;
+  return min(actor_chunk_first(len) + chunk, len);
+}
+
+/// Inclusive scan of `tmp`, called by all work items of a group.
+void actor_scan_local(local ACTOR_T* tmp, uint lid, uint n) {
+  for (uint offset = 1; offset < n; offset <<= 1) {
+    barrier(CLK_LOCAL_MEM_FENCE);
+    ACTOR_T x = lid >= offset ? tmp[lid - offset] : ACTOR_IDENTITY;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    tmp[lid] = ACTOR_OP(x, tmp[lid]);
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+void actor_scan_local_uint(local uint* tmp, uint lid, uint n) {
+  for (uint offset = 1; offset < n; offset <<= 1) {
+    barrier(CLK_LOCAL_MEM_FENCE);
+    uint x = lid >= offset ? tmp[lid - offset] : 0;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    tmp[lid] += x;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+/// Reduces `tmp` to its first element, `n` must be a power of two.
+void actor_reduce_local(local ACTOR_T* tmp, uint lid, uint n) {
+  for (uint stride = n / 2; stride > 0; stride >>= 1) {
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (lid < stride)
+      tmp[lid] = ACTOR_OP(tmp[lid], tmp[lid + stride]);
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+void actor_reduce_local_uint(local uint* tmp, uint lid, uint n) {
+  for (uint stride = n / 2; stride > 0; stride >>= 1) {
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (lid < stride)
+      tmp[lid] += tmp[lid + stride];
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+ACTOR_T actor_reduce_range(global const ACTOR_T* input, local ACTOR_T* tmp,
+                           uint first, uint last) {
+  uint lid = get_local_id(0);
+  uint n = get_local_size(0);
+  ACTOR_T acc = ACTOR_IDENTITY;
+  for (uint i = first + lid; i < last; i += n)
+    acc = ACTOR_OP(acc, input[i]);
+  tmp[lid] = acc;
+  actor_reduce_local(tmp, lid, n);
+  return tmp[0];
+}
+
+void actor_scan_range(global ACTOR_T* data, local ACTOR_T* tmp,
+                      uint first, uint last, ACTOR_T carry) {
+  uint lid = get_local_id(0);
+  uint n = get_local_size(0);
+  for (uint base = first; base < last; base += n) {
+    uint i = base + lid;
+    tmp[lid] = i < last ? data[i] : ACTOR_IDENTITY;
+    actor_scan_local(tmp, lid, n);
+#ifdef ACTOR_EXCLUSIVE
+    ACTOR_T x = lid == 0 ? carry : ACTOR_OP(carry, tmp[lid - 1]);
+#else
+    ACTOR_T x = ACTOR_OP(carry, tmp[lid]);
+#endif
+    if (i < last)
+      data[i] = x;
+    carry = ACTOR_OP(carry, tmp[n - 1]);
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+}
+
+/// Reduces the chunk of each group to `partials[group]`.
+kernel void actor_reduce(global const ACTOR_T* restrict input,
+                         global ACTOR_T* restrict partials,
+                         local ACTOR_T* tmp, uint len) {
+  ACTOR_T x = actor_reduce_range(input, tmp, actor_chunk_first(len),
+                                 actor_chunk_last(len));
+  if (get_local_id(0) == 0)
+    partials[get_group_id(0)] = x;
+}
+
+/// Exclusive scan of at most one group of partials, `data` is only passed on.
+kernel void actor_scan_partials(global ACTOR_T* restrict data,
+                                global ACTOR_T* restrict partials,
+                                local ACTOR_T* tmp, uint len) {
+  uint lid = get_local_id(0);
+  tmp[lid] = lid < len ? partials[lid] : ACTOR_IDENTITY;
+  actor_scan_local(tmp, lid, get_local_size(0));
+  if (lid < len)
+    partials[lid] = lid == 0 ? ACTOR_IDENTITY : tmp[lid - 1];
+}
+
+/// Scans the chunk of each group, starting at `partials[group]`.
+kernel void actor_scan_chunks(global ACTOR_T* restrict data,
+                              global const ACTOR_T* restrict partials,
+                              local ACTOR_T* tmp, uint len) {
+  actor_scan_range(data, tmp, actor_chunk_first(len), actor_chunk_last(len),
+                   partials[get_group_id(0)]);
+}
+
+/// Counts the elements selected by `ACTOR_PRED` in the chunk of each group.
+kernel void actor_count(global const ACTOR_T* restrict input,
+                        global uint* restrict counts,
+                        local uint* tmp, uint len) {
+  uint lid = get_local_id(0);
+  uint n = get_local_size(0);
+  uint last = actor_chunk_last(len);
+  uint acc = 0;
+  for (uint i = actor_chunk_first(len) + lid; i < last; i += n)
+    acc += ACTOR_PRED(input[i]) ? 1 : 0;
+  tmp[lid] = acc;
+  actor_reduce_local_uint(tmp, lid, n);
+  if (lid == 0)
+    counts[get_group_id(0)] = tmp[0];
+}
+
+/// Exclusive scan of `counts` by a single group, stores the total in
+/// `counts[len]`. `data` is only passed on.
+kernel void actor_scan_counts(global ACTOR_T* restrict data,
+                              global uint* restrict counts,
+                              local uint* tmp, uint len) {
+  uint lid = get_local_id(0);
+  uint n = get_local_size(0);
+  uint carry = 0;
+  for (uint base = 0; base < len; base += n) {
+    uint i = base + lid;
+    tmp[lid] = i < len ? counts[i] : 0;
+    actor_scan_local_uint(tmp, lid, n);
+    if (i < len)
+      counts[i] = carry + (lid == 0 ? 0 : tmp[lid - 1]);
+    carry += tmp[n - 1];
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+  if (lid == 0)
+    counts[len] = carry;
+}
+
+/// Writes the elements selected by `ACTOR_PRED` in their original order.
+kernel void actor_compact(global const ACTOR_T* restrict input,
+                          global const uint* restrict offsets,
+                          global ACTOR_T* restrict output,
+                          local uint* tmp, uint len) {
+  uint lid = get_local_id(0);
+  uint n = get_local_size(0);
+  uint last = actor_chunk_last(len);
+  uint carry = offsets[get_group_id(0)];
+  for (uint base = actor_chunk_first(len); base < last; base += n) {
+    uint i = base + lid;
+    ACTOR_T x = ACTOR_IDENTITY;
+    uint selected = 0;
+    if (i < last) {
+      x = input[i];
+      selected = ACTOR_PRED(x) ? 1 : 0;
+    }
+    tmp[lid] = selected;
+    actor_scan_local_uint(tmp, lid, n);
+    if (selected)
+      output[carry + tmp[lid] - 1] = x;
+    carry += tmp[n - 1];
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+}
+
+/// Counts the digits at `shift` in the chunk of each group. The counts are
+/// stored digit-major, i.e., a scan yields the offset of each group per digit.
+kernel void actor_radix_count(global const ACTOR_T* restrict keys,
+                              global uint* restrict counts,
+                              local uint* hist, uint len, uint shift) {
+  uint lid = get_local_id(0);
+  uint n = get_local_size(0);
+  for (uint d = lid; d < ACTOR_RADIX_DIGITS; d += n)
+    hist[d] = 0;
+  barrier(CLK_LOCAL_MEM_FENCE);
+  uint last = actor_chunk_last(len);
+  for (uint i = actor_chunk_first(len) + lid; i < last; i += n)
+    atomic_inc(&hist[(uint) (keys[i] >> shift) & (ACTOR_RADIX_DIGITS - 1)]);
+  barrier(CLK_LOCAL_MEM_FENCE);
+  for (uint d = lid; d < ACTOR_RADIX_DIGITS; d += n)
+    counts[d * get_num_groups(0) + get_group_id(0)] = hist[d];
+}
+
+/// Moves each key to its position for the digit at `shift`, keeping the
+/// order of keys with equal digits.
+kernel void actor_radix_scatter(global const ACTOR_T* restrict keys,
+                                global const uint* restrict offsets,
+                                global ACTOR_T* restrict output,
+                                local uint* tmp, uint len, uint shift) {
+  uint lid = get_local_id(0);
+  uint n = get_local_size(0);
+  uint groups = get_num_groups(0);
+  uint group = get_group_id(0);
+  uint last = actor_chunk_last(len);
+  uint carry[ACTOR_RADIX_DIGITS];
+  for (uint d = 0; d < ACTOR_RADIX_DIGITS; ++d)
+    carry[d] = offsets[d * groups + group];
+  for (uint base = actor_chunk_first(len); base < last; base += n) {
+    uint i = base + lid;
+    ACTOR_T key = i < last ? keys[i] : 0;
+    uint digit = (uint) (key >> shift) & (ACTOR_RADIX_DIGITS - 1);
+    for (uint d = 0; d < ACTOR_RADIX_DIGITS; ++d) {
+      uint selected = i < last && digit == d ? 1 : 0;
+      tmp[lid] = selected;
+      actor_scan_local_uint(tmp, lid, n);
+      if (selected)
+        output[carry[d] + tmp[lid] - 1] = key;
+      carry[d] += tmp[n - 1];
+      barrier(CLK_LOCAL_MEM_FENCE);
+    }
+  }
+}
+
+/// Reduces the segment of each group, `offsets` holds the first element of
+/// each segment followed by the total length.
+kernel void actor_segmented_reduce(global const ACTOR_T* restrict input,
+                                   global const uint* restrict offsets,
+                                   global ACTOR_T* restrict output,
+                                   local ACTOR_T* tmp) {
+  uint segment = get_group_id(0);
+  ACTOR_T x = actor_reduce_range(input, tmp, offsets[segment],
+                                 offsets[segment + 1]);
+  if (get_local_id(0) == 0)
+    output[segment] = x;
+}
+
+/// Scans the segment of each group.
+kernel void actor_segmented_scan(global ACTOR_T* restrict data,
+                                 global const uint* restrict offsets,
+                                 local ACTOR_T* tmp) {
+  uint segment = get_group_id(0);
+  actor_scan_range(data, tmp, offsets[segment], offsets[segment + 1],
+                   ACTOR_IDENTITY);
+}
+)__";
+
+            }    // namespace
+
+            std::string primitives_source(const char *type, const primitive_op &op, const std::string &predicate,
+                                          bool exclusive) {
+                std::ostringstream out;
+                if (std::strcmp(type, "double") == 0) {
+                    out << "#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n";
+                }
+                out << "#define ACTOR_T " << type << "\n"
+                    << "#define ACTOR_OP(a, b) (" << op.expression << ")\n"
+                    << "#define ACTOR_IDENTITY ((" << type << ") (" << op.identity << "))\n"
+                    << "#define ACTOR_PRED(x) (" << (predicate.empty() ? "1" : predicate) << ")\n"
+                    << "#define ACTOR_RADIX_DIGITS " << radix_digits << "\n";
+                if (exclusive) {
+                    out << "#define ACTOR_EXCLUSIVE\n";
+                }
+                out << primitives_kernels;
+                return out.str();
+            }
+
+            size_t primitives_group_size(const device &dev, size_t bytes_per_item) {
+                auto limit = dev.max_work_group_size();
+                auto local_mem = static_cast<size_t>(dev.local_mem_size());
+                // leaves room for the histogram of the radix sort
+                auto per_item = std::max(bytes_per_item, sizeof(cl_uint));
+                if (local_mem > radix_digits * sizeof(cl_uint)) {
+                    limit = std::min(limit, (local_mem - radix_digits * sizeof(cl_uint)) / per_item);
+                }
+                // groups smaller than the histogram count several digits per item
+                size_t result = 1;
+                while (result * 2 <= limit) {
+                    result *= 2;
+                }
+                return result;
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -21,17 +21,36 @@ namespace nil {
     namespace actor {
         namespace cuda {
 
-            program::program(detail::raw_context_ptr context, detail::raw_command_queue_ptr queue,
+            program::program(device_ptr dev, detail::raw_context_ptr context, detail::raw_command_queue_ptr queue,
                              detail::raw_program_ptr prog,
-                             std::map<std::string, detail::raw_kernel_ptr> available_kernels) :
-                context_(std::move(context)),
-                program_(std::move(prog)), queue_(std::move(queue)), available_kernels_(std::move(available_kernels)) {
+                             std::map<std::string, detail::raw_kernel_ptr> available_kernels,
+                             completion_executor *executor) :
+                device_(std::move(dev)),
+                context_(std::move(context)), program_(std::move(prog)), queue_(std::move(queue)),
+                available_kernels_(std::move(available_kernels)), executor_(executor) {
                 // nop
             }
 
             program::~program() {
                 // nop
             }
+
+            std::vector<std::string> program::kernel_names() const {
+                std::vector<std::string> result;
+                for (auto &kv : available_kernels_) {
+                    result.push_back(kv.first);
+                }
+                return result;
+            }
+
+            optional<kernel_info> program::info(const std::string &kernel_name) const {
+                auto i = available_kernels_.find(kernel_name);
+                if (i == available_kernels_.end()) {
+                    return none;
+                }
+                return kernel_info::query(i->second.get(), device_->device_id_.get());
+            }
+
         }    // namespace cuda
     }        // namespace actor
 }    // namespace nil
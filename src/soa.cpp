@@ -0,0 +1,78 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <cstring>
+
+#include <nil/actor/cuda/soa.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            namespace {
+
+                // A fixed size turns the copies into plain loads and stores, which lets
+                // the compiler vectorize the loops over the elements.
+                template<size_t Size>
+                void copy_fields(const char *src, size_t src_step, char *dst, size_t dst_step, size_t n) {
+                    for (size_t i = 0; i < n; ++i) {
+                        std::memcpy(dst + i * dst_step, src + i * src_step, Size);
+                    }
+                }
+
+                void copy_fields(const char *src, size_t src_step, char *dst, size_t dst_step, size_t size,
+                                 size_t n) {
+                    switch (size) {
+                        case 1:
+                            return copy_fields<1>(src, src_step, dst, dst_step, n);
+                        case 2:
+                            return copy_fields<2>(src, src_step, dst, dst_step, n);
+                        case 4:
+                            return copy_fields<4>(src, src_step, dst, dst_step, n);
+                        case 8:
+                            return copy_fields<8>(src, src_step, dst, dst_step, n);
+                        case 16:
+                            return copy_fields<16>(src, src_step, dst, dst_step, n);
+                        default:
+                            for (size_t i = 0; i < n; ++i) {
+                                std::memcpy(dst + i * dst_step, src + i * src_step, size);
+                            }
+                    }
+                }
+
+            }    // namespace
+
+            soa_layout::soa_layout(size_t element_size, std::vector<soa_field> fields) :
+                element_size_(element_size), plane_size_(0), fields_(std::move(fields)) {
+                for (auto &field : fields_) {
+                    plane_size_ += field.size;
+                }
+            }
+
+            void soa_layout::scatter(const void *src, size_t n, void *dst) const {
+                auto in = static_cast<const char *>(src);
+                auto out = static_cast<char *>(dst);
+                for (auto &field : fields_) {
+                    copy_fields(in + field.offset, element_size_, out, field.size, field.size, n);
+                    out += stride(n) * field.size;
+                }
+            }
+
+            void soa_layout::gather(const void *src, size_t n, void *dst) const {
+                auto in = static_cast<const char *>(src);
+                auto out = static_cast<char *>(dst);
+                for (auto &field : fields_) {
+                    copy_fields(in, field.size, out + field.offset, element_size_, field.size, n);
+                    in += stride(n) * field.size;
+                }
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -0,0 +1,194 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// Distributed under the terms and conditions of the BSD 3-Clause License or
+// (at your option) under the terms and conditions of the Boost Software
+// License 1.0. See accompanying files LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt.
+//---------------------------------------------------------------------------//
+
+#include <set>
+#include <cstring>
+#include <iomanip>
+#include <algorithm>
+
+#include <nil/actor/cuda/tracer.hpp>
+
+namespace nil {
+    namespace actor {
+        namespace cuda {
+
+            namespace {
+
+                // small ids keep the rows of the host track readable
+                uint32_t thread_index() {
+                    static std::atomic<uint32_t> threads {0};
+                    thread_local uint32_t index = threads.fetch_add(1, std::memory_order_relaxed);
+                    return index;
+                }
+
+                const char *command_name(cl_command_type type) {
+                    switch (type) {
+                        case CL_COMMAND_NDRANGE_KERNEL:
+                            return "kernel";
+                        case CL_COMMAND_READ_BUFFER:
+                            return "read";
+                        case CL_COMMAND_WRITE_BUFFER:
+                            return "write";
+                        case CL_COMMAND_COPY_BUFFER:
+                            return "copy";
+                        case CL_COMMAND_READ_BUFFER_RECT:
+                            return "read rect";
+                        case CL_COMMAND_WRITE_BUFFER_RECT:
+                            return "write rect";
+                        case CL_COMMAND_WRITE_IMAGE:
+                            return "write image";
+                        case CL_COMMAND_MAP_BUFFER:
+                            return "map";
+                        case CL_COMMAND_UNMAP_MEM_OBJECT:
+                            return "unmap";
+                        case CL_COMMAND_MARKER:
+                            return "marker";
+                        default:
+                            return "command";
+                    }
+                }
+
+                // the trace format expects microseconds
+                void write_micros(std::ostream &out, uint64_t ns) {
+                    out << ns / 1000 << '.' << std::setw(3) << std::setfill('0') << ns % 1000 << std::setfill(' ');
+                }
+
+                void write_string(std::ostream &out, const char *str) {
+                    out << '"';
+                    for (; *str != '\0'; ++str) {
+                        if (*str == '"' || *str == '\\') {
+                            out << '\\';
+                        }
+                        out << *str;
+                    }
+                    out << '"';
+                }
+
+            }    // namespace
+
+            tracer::tracer(size_t capacity) :
+                start_(std::chrono::steady_clock::now()), capacity_(std::max(capacity, size_t {1})),
+                slots_(new slot[capacity_]), next_(0), ids_(0) {
+                for (size_t i = 0; i < capacity_; ++i) {
+                    slots_[i].sequence.store(0, std::memory_order_relaxed);
+                }
+            }
+
+            uint64_t tracer::now() const {
+                auto elapsed = std::chrono::steady_clock::now() - start_;
+                return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+            }
+
+            uint64_t tracer::next_id() {
+                return ids_.fetch_add(1, std::memory_order_relaxed) + 1;
+            }
+
+            void tracer::record(const char *name, const char *category, uint32_t track, uint64_t begin, uint64_t end,
+                                uint64_t id) {
+                auto index = next_.fetch_add(1, std::memory_order_relaxed);
+                auto &s = slots_[index % capacity_];
+                // drops the span if a writer that wrapped around still holds the slot
+                auto sequence = s.sequence.load(std::memory_order_relaxed);
+                if (sequence % 2 == 1 || sequence > 2 * index ||
+                    !s.sequence.compare_exchange_strong(sequence, 2 * index + 1, std::memory_order_acquire)) {
+                    return;
+                }
+                std::atomic_thread_fence(std::memory_order_release);
+                std::strncpy(s.value.name, name, sizeof(s.value.name) - 1);
+                s.value.name[sizeof(s.value.name) - 1] = '\0';
+                s.value.category = category;
+                s.value.track = track;
+                s.value.thread = track == host_track ? thread_index() : 0;
+                s.value.begin = begin;
+                s.value.end = std::max(begin, end);
+                s.value.id = id;
+                s.sequence.store(2 * index + 2, std::memory_order_release);
+            }
+
+            void tracer::record(cl_event event, const char *name, unsigned device_id, int64_t offset, uint64_t id) {
+                cl_ulong start = 0;
+                cl_ulong end = 0;
+                if (clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, nullptr) !=
+                        CL_SUCCESS ||
+                    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, nullptr) !=
+                        CL_SUCCESS) {
+                    return;
+                }
+                if (name == nullptr) {
+                    cl_command_type type;
+                    if (clGetEventInfo(event, CL_EVENT_COMMAND_TYPE, sizeof(type), &type, nullptr) != CL_SUCCESS) {
+                        return;
+                    }
+                    name = command_name(type);
+                }
+                auto convert = [&](cl_ulong x) {
+                    auto result = static_cast<int64_t>(x) + offset;
+                    return result < 0 ? uint64_t {0} : static_cast<uint64_t>(result);
+                };
+                record(name, "device", device_id + 1, convert(start), convert(end), id);
+            }
+
+            int64_t tracer::offset(cl_event event, uint64_t enqueued) {
+                cl_ulong queued = 0;
+                if (clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong), &queued, nullptr) !=
+                    CL_SUCCESS) {
+                    return 0;
+                }
+                return static_cast<int64_t>(enqueued) - static_cast<int64_t>(queued);
+            }
+
+            size_t tracer::size() const {
+                return static_cast<size_t>(std::min(next_.load(std::memory_order_acquire), uint64_t {capacity_}));
+            }
+
+            void tracer::write(std::ostream &out) const {
+                auto last = next_.load(std::memory_order_acquire);
+                auto first = last > capacity_ ? last - capacity_ : 0;
+                std::set<uint32_t> tracks;
+                out << "{\"traceEvents\":[";
+                bool separate = false;
+                for (auto index = first; index < last; ++index) {
+                    auto &s = slots_[index % capacity_];
+                    auto sequence = s.sequence.load(std::memory_order_acquire);
+                    if (sequence != 2 * index + 2) {
+                        continue;    // still being written or already overwritten
+                    }
+                    auto value = s.value;
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (s.sequence.load(std::memory_order_relaxed) != sequence) {
+                        continue;
+                    }
+                    tracks.insert(value.track);
+                    out << (separate ? ",\n" : "\n") << "{\"name\":";
+                    write_string(out, value.name);
+                    out << ",\"cat\":\"" << value.category << "\",\"ph\":\"X\",\"pid\":" << value.track
+                        << ",\"tid\":" << value.thread << ",\"ts\":";
+                    write_micros(out, value.begin);
+                    out << ",\"dur\":";
+                    write_micros(out, value.end - value.begin);
+                    out << ",\"args\":{\"id\":" << value.id << "}}";
+                    separate = true;
+                }
+                for (auto track : tracks) {
+                    out << (separate ? ",\n" : "\n") << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << track
+                        << ",\"args\":{\"name\":\"";
+                    if (track == host_track) {
+                        out << "host";
+                    } else {
+                        out << "device " << track - 1;
+                    }
+                    out << "\"}}";
+                    separate = true;
+                }
+                out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+            }
+
+        }    // namespace cuda
+    }        // namespace actor
+}    // namespace nil
@@ -11,9 +11,15 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <vector>
 #include <iomanip>
 #include <cassert>
+#include <cstddef>
+#include <numeric>
+#include <sstream>
 #include <iostream>
 #include <algorithm>
 
@@ -49,6 +55,11 @@ namespace {
     constexpr const char *kn_order = "test_order";
     constexpr const char *kn_private = "use_private";
     constexpr const char *kn_varying = "varying";
+    constexpr const char *kn_image = "image_scale";
+    constexpr const char *kn_rect = "rect_scale";
+    constexpr const char *kn_soa = "soa_step";
+    constexpr const char *kn_checked = "add_index_checked";
+    constexpr const char *kn_unchecked = "add_index";
 
     constexpr const char *compiler_flag = "-D ACTOR_OPENCL_TEST_FLAG";
 
@@ -167,6 +178,40 @@ namespace {
     out1[idx] = in1[idx];
     out2[idx] = in2[idx];
   }
+
+  kernel void rect_scale(global const int* restrict tile,
+                         global       int* restrict matrix,
+                         private int x_offset, private int y_offset,
+                         private int width) {
+    size_t x = get_global_id(0);
+    size_t y = get_global_id(1);
+    matrix[(y + y_offset) * width + x + x_offset] = tile[y * get_global_size(0) + x] * 2;
+  }
+
+  // planes of soa_point: x, id, y
+  kernel void soa_step(global const float* restrict input,
+                       global       float* restrict output) {
+    size_t i = get_global_id(0);
+    size_t stride = (get_global_size(0) + 15) / 16 * 16;
+    global const int* ids = (global const int*) (input + stride);
+    output[i] = input[i] + 1.0f;
+    ((global int*) (output + stride))[i] = ids[i] * 2;
+    output[2 * stride + i] = input[2 * stride + i] * 3.0f;
+  }
+
+  kernel void add_index_checked(global const int* restrict input,
+                                global       int* restrict output,
+                                uint n) {
+    size_t i = get_global_id(0);
+    if (i < n)
+      output[i] = input[i] + (int) i;
+  }
+
+  kernel void add_index(global const int* restrict input,
+                        global       int* restrict output) {
+    size_t i = get_global_id(0);
+    output[i] = input[i] + (int) i;
+  }
 )__";
 
 #ifndef ACTOR_NO_EXCEPTIONS
@@ -189,6 +234,14 @@ namespace {
   }
 )__";
 
+    constexpr const char *image_source = R"__(
+  kernel void image_scale(read_only image2d_t input, sampler_t smp,
+                          write_only image2d_t output) {
+    int2 pos = (int2)(get_global_id(0), get_global_id(1));
+    write_imagef(output, pos, read_imagef(input, smp, pos) * 2.0f);
+  }
+)__";
+
 }    // namespace
 
 template<size_t Size>
@@ -562,6 +615,26 @@ BOOST_AUTO_TEST_CASE(opencl_mem_refs_test) {
     buf_2.reset();
     auto res_5 = buf_2.data();
     BOOST_CHECK(!res_5);
+    // memory accounting
+    auto before = dev->memory().stats();
+    auto buf_3 = dev->scratch_argument<uint32_t>(problem_size);
+    auto after = dev->memory().stats();
+    BOOST_CHECK_EQUAL(after.allocations, before.allocations + 1);
+    BOOST_CHECK_GE(after.current, before.current + problem_size * sizeof(uint32_t));
+    BOOST_CHECK_GE(after.peak, after.current);
+    BOOST_CHECK_LE(after.current, after.budget);
+    // rectangular transfers on a 4x4 matrix
+    auto buf_4 = dev->global_argument(make_iota_vector<uint32_t>(16), buffer_type::input_output);
+    buffer_rect center {dims {1, 1}, dims {2, 2}, 4};
+    auto res_6 = buf_4.read_rect(center);
+    BOOST_REQUIRE(res_6);
+    check_vector_results("Testing mem_ref::read_rect", std::vector<uint32_t> {5, 6, 9, 10}, *res_6);
+    BOOST_CHECK(!buf_4.write_rect(center, std::vector<uint32_t> {0, 0, 0, 0}));
+    auto res_7 = buf_4.data();
+    BOOST_REQUIRE(res_7);
+    check_vector_results("Testing mem_ref::write_rect",
+                         std::vector<uint32_t> {0, 1, 2, 3, 4, 0, 0, 7, 8, 0, 0, 11, 12, 13, 14, 15}, *res_7);
+    BOOST_CHECK(!buf_4.read_rect(buffer_rect {dims {3, 3}, dims {2, 2}, 4}));
 }
 
 BOOST_AUTO_TEST_CASE(opencl_argument_info_test) {
@@ -606,6 +679,241 @@ BOOST_AUTO_TEST_CASE(opencl_argument_info_test) {
     BOOST_CHECK_EQUAL(true, true);
 }
 
+BOOST_AUTO_TEST_CASE(completion_executor_test) {
+    struct counting_job : completion_executor::job {
+        std::atomic<size_t> *count;
+        void run() override {
+            ++*count;
+        }
+    };
+    constexpr size_t num_producers = 4;
+    constexpr size_t jobs_per_producer = 1000;
+    std::atomic<size_t> count {0};
+    std::vector<counting_job> jobs(num_producers * jobs_per_producer);
+    for (auto &x : jobs) {
+        x.count = &count;
+    }
+    completion_executor exec {3};
+    exec.start();
+    std::vector<std::thread> producers;
+    for (size_t i = 0; i < num_producers; ++i) {
+        producers.emplace_back([&, i] {
+            for (size_t j = 0; j < jobs_per_producer; ++j) {
+                exec.submit(&jobs[i * jobs_per_producer + j]);
+            }
+        });
+    }
+    for (auto &t : producers) {
+        t.join();
+    }
+    exec.stop();
+    BOOST_CHECK_EQUAL(count.load(), jobs.size());
+    // stopping while producers submit runs every job exactly once
+    count = 0;
+    completion_executor racing {3};
+    racing.start();
+    producers.clear();
+    for (size_t i = 0; i < num_producers; ++i) {
+        producers.emplace_back([&, i] {
+            for (size_t j = 0; j < jobs_per_producer; ++j) {
+                racing.submit(&jobs[i * jobs_per_producer + j]);
+            }
+        });
+    }
+    racing.stop();
+    for (auto &t : producers) {
+        t.join();
+    }
+    BOOST_CHECK_EQUAL(count.load(), jobs.size());
+}
+
+BOOST_AUTO_TEST_CASE(nd_range_test) {
+    auto padded = nd_range::padded(dims {100, 50}, dims {32, 16});
+    BOOST_CHECK(padded.policy() == remainder_policy::pad);
+    BOOST_CHECK(padded.dimensions() == (dims {128, 64}));
+    BOOST_CHECK(padded.real_dimensions() == (dims {100, 50}));
+    BOOST_CHECK_EQUAL(padded.launches().size(), 1u);
+    auto split = nd_range::split(dims {100, 50}, dims {32, 16}, dims {1, 2});
+    BOOST_CHECK(split.real_dimensions() == (dims {100, 50}));
+    auto launches = split.launches();
+    BOOST_REQUIRE_EQUAL(launches.size(), 4u);
+    BOOST_CHECK(launches[0].dimensions() == (dims {96, 48}));
+    BOOST_CHECK(launches[0].offsets() == (dims {1, 2}));
+    BOOST_CHECK(launches[0].local_dimensions() == (dims {32, 16}));
+    BOOST_CHECK(launches[1].dimensions() == (dims {4, 48}));
+    BOOST_CHECK(launches[1].offsets() == (dims {97, 2}));
+    BOOST_CHECK(launches[1].local_dimensions() == (dims {4, 16}));
+    BOOST_CHECK(launches[3].dimensions() == (dims {4, 2}));
+    BOOST_CHECK(launches[3].offsets() == (dims {97, 50}));
+    size_t items = 0;
+    for (auto &x : launches) {
+        items += x.dimensions()[0] * x.dimensions()[1];
+    }
+    BOOST_CHECK_EQUAL(items, 100u * 50u);
+    // no remainder, a single launch
+    BOOST_CHECK_EQUAL(nd_range::split(dims {64}, dims {32}).launches().size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(chunk_scheduler_test) {
+    using std::chrono::milliseconds;
+    chunk_scheduler scheduler {{1.0, 1.0}, 100};
+    auto now = chunk_scheduler::clock::time_point {};
+    scheduler.reset(10000);
+    // equal weights before any measurement
+    auto a = scheduler.next(0, now);
+    auto b = scheduler.next(1, now);
+    BOOST_REQUIRE(a && b);
+    BOOST_CHECK_EQUAL(a->first, 0u);
+    BOOST_CHECK_EQUAL(a->count, 2500u);
+    BOOST_CHECK_EQUAL(b->first, 2500u);
+    now += milliseconds(10);
+    BOOST_CHECK(scheduler.complete(0, a->id, now));
+    BOOST_CHECK(scheduler.throughput(0) > 0);
+    BOOST_CHECK_EQUAL(scheduler.throughput(1), 0);
+    // the first worker drains the remaining items and then steals the late chunk
+    size_t drained = 0;
+    auto next = scheduler.next(0, now);
+    while (next && next->id != b->id) {
+        drained += next->count;
+        now += milliseconds(1);
+        BOOST_CHECK(scheduler.complete(0, next->id, now));
+        next = scheduler.next(0, now);
+    }
+    BOOST_REQUIRE(next);
+    BOOST_CHECK_EQUAL(next->first, b->first);
+    BOOST_CHECK_EQUAL(drained, 10000 - a->count - b->count);
+    BOOST_CHECK(scheduler.complete(0, b->id, now));
+    BOOST_CHECK(scheduler.done());
+    // the result of the slower run is dropped but still measured
+    BOOST_CHECK(!scheduler.complete(1, b->id, now));
+    BOOST_CHECK(scheduler.throughput(1) > 0);
+    // stealing does not pay off for the slower worker
+    scheduler.reset(10);
+    auto c = scheduler.next(0, now);
+    BOOST_REQUIRE(c);
+    BOOST_CHECK_EQUAL(c->count, 10u);
+    BOOST_CHECK(!scheduler.next(1, now));
+    BOOST_CHECK(!scheduler.complete(0, a->id, now));
+    BOOST_CHECK(scheduler.complete(0, c->id, now + milliseconds(1)));
+    BOOST_CHECK(scheduler.done());
+}
+
+BOOST_AUTO_TEST_CASE(tracer_test) {
+    tracer trace {4};
+    for (int i = 0; i < 10; ++i) {
+        auto name = "span " + std::to_string(i);
+        auto begin = trace.now();
+        trace.record(name.c_str(), "host", tracer::host_track, begin, trace.now(), trace.next_id());
+    }
+    BOOST_CHECK_EQUAL(trace.size(), 4u);
+    std::ostringstream out;
+    trace.write(out);
+    auto json = out.str();
+    BOOST_CHECK(json.find("\"traceEvents\"") != std::string::npos);
+    BOOST_CHECK(json.find("\"span 5\"") == std::string::npos);
+    for (int i = 6; i < 10; ++i) {
+        BOOST_CHECK(json.find("\"span " + std::to_string(i) + "\"") != std::string::npos);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(remote_ref_test) {
+    // three nodes in one process, the last one without an OpenCL manager
+    spawner_config sender_cfg;
+    sender_cfg.load<opencl::manager>().add_message_type<remote_ref<int>>("remote_int_ref");
+    spawner sender {sender_cfg};
+    spawner_config receiver_cfg;
+    receiver_cfg.load<opencl::manager>().add_message_type<remote_ref<int>>("remote_int_ref");
+    spawner receiver {receiver_cfg};
+    spawner_config host_cfg;
+    spawner host {host_cfg};
+    auto opt = sender.opencl_manager().find_device(0);
+    BOOST_REQUIRE(opt);
+    // spans more than one chunk
+    const size_t n = remote_chunk_bytes / sizeof(int) + 1000;
+    auto input = make_iota_vector<int>(n);
+    remote_ref<int> x {(*opt)->global_argument(input)};
+    std::vector<char> buf;
+    binary_serializer sink {sender, buf};
+    BOOST_REQUIRE(!sink(x));
+    // the receiver uploads while deserializing
+    remote_ref<int> y;
+    binary_deserializer source {receiver, buf};
+    BOOST_REQUIRE(!source(y));
+    BOOST_CHECK(y.on_device());
+    BOOST_CHECK_EQUAL(y.size(), n);
+    auto ref = y.get(receiver.opencl_manager());
+    BOOST_REQUIRE(ref);
+    auto data = ref->data();
+    BOOST_REQUIRE(data);
+    check_vector_results("Testing remote_ref on the receiver", input, *data);
+    // without a manager the data waits on the host
+    remote_ref<int> z;
+    binary_deserializer host_source {host, buf};
+    BOOST_REQUIRE(!host_source(z));
+    BOOST_CHECK(!z.on_device());
+    auto uploaded = z.get(*opt);
+    BOOST_REQUIRE(uploaded);
+    data = uploaded->data();
+    BOOST_REQUIRE(data);
+    check_vector_results("Testing remote_ref uploaded on demand", input, *data);
+    // a size that does not match the chunks fails before allocating
+    auto forged = buf;
+    std::fill(forged.begin() + sizeof(uint32_t), forged.begin() + sizeof(uint32_t) + sizeof(uint64_t), '\xff');
+    remote_ref<int> w;
+    binary_deserializer forged_source {receiver, forged};
+    BOOST_CHECK(forged_source(w));
+    BOOST_CHECK(!w.on_device());
+    // a message carries the buffer to an actor of the receiver
+    std::vector<char> msg_buf;
+    binary_serializer msg_sink {sender, msg_buf};
+    auto msg = make_message(x);
+    BOOST_REQUIRE(!msg_sink(msg));
+    message received;
+    binary_deserializer msg_source {receiver, msg_buf};
+    BOOST_REQUIRE(!msg_source(received));
+    BOOST_REQUIRE(received.match_elements<remote_ref<int>>());
+    auto reader = receiver.spawn([&](remote_ref<int> &in) -> result<ivec> {
+        auto in_ref = in.get(receiver.opencl_manager());
+        if (!in_ref) {
+            return std::move(in_ref.error());
+        }
+        auto in_data = in_ref->data();
+        if (!in_data) {
+            return std::move(in_data.error());
+        }
+        return std::move(*in_data);
+    });
+    scoped_actor self {receiver};
+    self->send(reader, std::move(received));
+    self->receive([&](const ivec &result) { check_vector_results("Testing remote_ref messages", input, result); },
+                  [&](const error &err) { BOOST_ERROR("reading a remote_ref failed: " << receiver.render(err)); });
+}
+
+BOOST_AUTO_TEST_CASE(host_kernel_test) {
+    // runs on nodes without OpenCL devices, hence never asks for one
+    spawner_config cfg;
+    cfg.load<opencl::manager>();
+    spawner sys {cfg};
+    auto &mngr = sys.opencl_manager();
+    scoped_actor self {sys};
+    mngr.add_host_kernel("host_square", [](const host_args &args, size_t begin, size_t end) {
+        auto input = args.get<int>(0);
+        auto output = args.get<int>(1);
+        for (size_t i = begin; i < end; ++i) {
+            output[i] = input[i] * input[i];
+        }
+    });
+    const size_t n = 3 * host_min_chunk + 5;
+    auto input = make_iota_vector<int>(n);
+    ivec expected(n);
+    std::transform(input.begin(), input.end(), expected.begin(), [](int x) { return x * x; });
+    auto worker = mngr.spawn_host("host_square", nd_range {dims {n}}, in<int> {}, out<int> {});
+    self->send(worker, input);
+    self->receive(
+        [&](const ivec &result) { check_vector_results("Testing host kernel without device", expected, result); },
+        [&](const error &err) { BOOST_ERROR("host kernel failed: " << sys.render(err)); });
+}
+
 void test_in_val_out_val(spawner &sys) {
     BOOST_TEST_MESSAGE("Testing in: val  -> out: val ");
     auto &mngr = sys.opencl_manager();
@@ -980,6 +1288,24 @@ void test_priv(spawner &sys) {
     self->send(w2, input, value);
     self->receive([&](const ivec &result) { check_vector_results("Testing val private arugment", res, result); },
                   others >> wrong_msg);
+    // an unchanged value stays bound, a new one replaces it
+    auto before = mngr.metrics();
+    self->send(w2, input, value);
+    self->receive([&](const ivec &result) { check_vector_results("Testing unchanged private argument", res, result); },
+                  others >> wrong_msg);
+    auto after = mngr.metrics();
+    BOOST_CHECK_EQUAL(after.devices.front().arg_sets_skipped, before.devices.front().arg_sets_skipped + 1);
+    BOOST_CHECK_EQUAL(after.devices.front().arg_sets, before.devices.front().arg_sets + 1);
+    int other = 7;
+    ivec other_res {input};
+    for_each(begin(other_res), end(other_res), [&](int &val) { val += other; });
+    self->send(w2, input, other);
+    self->receive(
+        [&](const ivec &result) { check_vector_results("Testing changed private argument", other_res, result); },
+        others >> wrong_msg);
+    auto last = mngr.metrics();
+    BOOST_CHECK_EQUAL(last.devices.front().arg_sets_skipped, after.devices.front().arg_sets_skipped);
+    BOOST_CHECK_EQUAL(last.devices.front().arg_sets, after.devices.front().arg_sets + 2);
 }
 
 void test_local(spawner &sys) {
@@ -1020,6 +1346,1018 @@ void test_local(spawner &sys) {
                   others >> wrong_msg);
 }
 
+void test_cached(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing cached input argument");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    auto opt = mngr.find_device(0);
+    BOOST_REQUIRE(opt);
+    auto dev = *opt;
+    auto prog = mngr.create_program(kernel_source, "", dev);
+    scoped_actor self {sys};
+    auto wrong_msg = [&](message_view &x) -> result<message> {
+        BOOST_ERROR("unexpected message" << x.content().stringify());
+        return sec::unexpected_message;
+    };
+    // tests
+    const ivec expected {56, 62, 68, 74, 152, 174, 196, 218, 248, 286, 324, 362, 344, 398, 452, 506};
+    auto input = make_iota_vector<int>(matrix_size * matrix_size);
+    auto hits = dev->input_cache().hits();
+    auto w = mngr.spawn(prog, kn_matrix, nd_range {dims {matrix_size, matrix_size}}, in<int, cached> {}, out<int> {});
+    self->send(w, input);
+    self->receive([&](const ivec &result) { check_vector_results("Testing cached (upload)", expected, result); },
+                  others >> wrong_msg);
+    self->send(w, input);
+    self->receive([&](const ivec &result) { check_vector_results("Testing cached (reuse)", expected, result); },
+                  others >> wrong_msg);
+    BOOST_CHECK_EQUAL(dev->input_cache().hits(), hits + 1);
+}
+
+void test_flush_batching(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing batched flushes");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    auto opt = mngr.find_device(0);
+    BOOST_REQUIRE(opt);
+    auto dev = *opt;
+    auto prog = mngr.create_program(kernel_source, "", dev);
+    scoped_actor self {sys};
+    auto wrong_msg = [&](message_view &x) -> result<message> {
+        BOOST_ERROR("unexpected message" << x.content().stringify());
+        return sec::unexpected_message;
+    };
+    // tests
+    constexpr size_t num_commands = 8;
+    const ivec expected {56, 62, 68, 74, 152, 174, 196, 218, 248, 286, 324, 362, 344, 398, 452, 506};
+    auto input = make_iota_vector<int>(matrix_size * matrix_size);
+    auto requests = dev->flusher().requests();
+    auto flushes = dev->flusher().flushes();
+    auto w = mngr.spawn(prog, kn_matrix, nd_range {dims {matrix_size, matrix_size}}, in<int> {}, out<int> {});
+    {
+        // the facade enqueues on the sending thread, hence the sends form a burst
+        flush_batcher::scope burst;
+        for (size_t i = 0; i < num_commands; ++i) {
+            self->send(w, input);
+        }
+    }
+    for (size_t i = 0; i < num_commands; ++i) {
+        self->receive([&](const ivec &result) { check_vector_results("Testing batched flushes", expected, result); },
+                      others >> wrong_msg);
+    }
+    BOOST_CHECK_EQUAL(dev->flusher().requests(), requests + num_commands);
+    BOOST_CHECK_GT(dev->flusher().flushes(), flushes);
+    BOOST_CHECK_LT(dev->flusher().flushes(), flushes + num_commands);
+    // a single request outside of a burst is flushed by the dedicated thread
+    flushes = dev->flusher().flushes();
+    self->send(w, input);
+    self->receive([&](const ivec &result) { check_vector_results("Testing single flush", expected, result); },
+                  others >> wrong_msg);
+    for (int i = 0; i < 1000 && dev->flusher().flushes() == flushes; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    BOOST_CHECK_EQUAL(dev->flusher().flushes(), flushes + 1);
+}
+
+void test_stream(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing streaming facade");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    auto opt = mngr.find_device(0);
+    BOOST_REQUIRE(opt);
+    auto dev = *opt;
+    auto prog = mngr.create_program(kernel_source, "", dev);
+    scoped_actor self {sys};
+    auto wrong_msg = [&](message_view &x) -> result<message> {
+        BOOST_ERROR("unexpected message" << x.content().stringify());
+        return sec::unexpected_message;
+    };
+    // tests
+    constexpr int num_chunks = 7;
+    nd_range range {dims {problem_size}};
+    auto w = mngr.spawn_stream(prog, kn_varying, range, 3, in<int> {}, out<int> {}, in<int> {}, out<int> {});
+    for (int i = 0; i < num_chunks; ++i) {
+        self->send(w, ivec(problem_size, i), ivec(problem_size, -i));
+    }
+    for (int i = 0; i < num_chunks; ++i) {
+        self->receive(
+            [&](const ivec &res1, const ivec &res2) {
+                check_vector_results("Streaming facade, output 1", ivec(problem_size, i), res1);
+                check_vector_results("Streaming facade, output 2", ivec(problem_size, -i), res2);
+            },
+            others >> wrong_msg);
+    }
+}
+
+void test_stream_stage(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing GPU stream stage");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    auto opt = mngr.find_device(0);
+    BOOST_REQUIRE(opt);
+    auto dev = *opt;
+    auto prog = mngr.create_program(kernel_source, "", dev);
+    scoped_actor self {sys};
+    auto wrong_msg = [&](message_view &x) -> result<message> {
+        BOOST_ERROR("unexpected message" << x.content().stringify());
+        return sec::unexpected_message;
+    };
+    stage_config cfg;
+    cfg.batch_size = 64;
+    cfg.max_in_flight = 2;
+    // not a multiple of the batch size, hence the last batch is partial
+    const int n = 1000;
+    // the range is fixed to one batch, each element gets its index in the batch added
+    auto worker = mngr.spawn(prog, kn_unchecked, nd_range {dims {cfg.batch_size}}, in<int> {}, out<int> {});
+    auto src = sys.spawn([=](event_based_actor *src_self) -> behavior {
+        return {[=](open_atom) {
+            return attach_stream_source(
+                src_self, [](int &x) { x = 0; },
+                [=](int &x, downstream<int> &out, size_t hint) {
+                    auto last = std::min(n, x + static_cast<int>(hint));
+                    for (; x < last; ++x) {
+                        out.push(x);
+                    }
+                },
+                [=](const int &x) { return x == n; });
+        }};
+    });
+    auto stg = sys.spawn([=](event_based_actor *stg_self) -> behavior {
+        return {[=](const stream<int> &in) { return attach_gpu_stage<int>(stg_self, in, worker, cfg); }};
+    });
+    auto receiver = actor_cast<actor>(self);
+    auto snk = sys.spawn([=](event_based_actor *snk_self) -> behavior {
+        return {[=](const stream<int> &in) {
+            return attach_stream_sink(
+                snk_self, in, [](ivec &) {}, [](ivec &xs, int x) { xs.push_back(x); },
+                [=](ivec &xs, const error &err) {
+                    if (err) {
+                        anon_send(receiver, err);
+                    } else {
+                        anon_send(receiver, std::move(xs));
+                    }
+                });
+        }};
+    });
+    ivec expected(n);
+    for (int i = 0; i < n; ++i) {
+        expected[i] = i + i % static_cast<int>(cfg.batch_size);
+    }
+    // tests
+    anon_send(snk * stg * src, open_atom::value);
+    self->receive(
+        [&](const ivec &result) {
+            BOOST_CHECK_EQUAL(result.size(), expected.size());
+            check_vector_results("Testing GPU stream stage", expected, result);
+        },
+        [&](const error &err) { BOOST_ERROR("GPU stream stage failed: " << sys.render(err)); }, others >> wrong_msg);
+}
+
+void test_persistent(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing persistent kernels");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    auto opt = mngr.find_device(0);
+    BOOST_REQUIRE(opt);
+    auto dev = *opt;
+    if (!dev->svm_atomics()) {
+        BOOST_TEST_MESSAGE("Device does not support fine-grained SVM atomics, skipping test");
+        return;
+    }
+    scoped_actor self {sys};
+    auto wrong_msg = [&](message_view &x) -> result<message> {
+        BOOST_ERROR("unexpected message" << x.content().stringify());
+        return sec::unexpected_message;
+    };
+    std::string source = persistent_kernel_prelude;
+    source += R"__(
+  void square(const global int* in, global int* out) {
+    *out = *in * *in;
+  }
+  ACTOR_PERSISTENT_KERNEL(actor_square, int, int, square)
+)__";
+    auto prog = mngr.create_program(source.c_str(), "-cl-std=CL2.0", dev);
+    // fewer slots than requests, hence some requests wait in the backlog
+    const int num_requests = 10;
+    auto worker = mngr.spawn_persistent<int, int>(prog, "actor_square", 4);
+    // tests
+    for (int i = 0; i < num_requests; ++i) {
+        self->send(worker, i);
+    }
+    for (int i = 0; i < num_requests; ++i) {
+        self->receive([&](int result) { BOOST_CHECK_EQUAL(result, i * i); }, others >> wrong_msg);
+    }
+}
+
+void test_rect(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing rectangular transfers");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    auto opt = mngr.find_device(0);
+    BOOST_REQUIRE(opt);
+    auto dev = *opt;
+    auto prog = mngr.create_program(kernel_source, "", dev);
+    scoped_actor self {sys};
+    auto wrong_msg = [&](message_view &x) -> result<message> {
+        BOOST_ERROR("unexpected message" << x.content().stringify());
+        return sec::unexpected_message;
+    };
+    // tests
+    constexpr int width = 8;
+    constexpr size_t tile_width = 4;
+    constexpr size_t tile_height = 3;
+    // a 4x3 tile at column 2 and row 1 of an 8x8 matrix
+    buffer_rect tile {dims {2, 1}, dims {tile_width, tile_height}, width};
+    auto w = mngr.spawn(prog, kn_rect, nd_range {dims {tile_width, tile_height}}, in_rect<int> {tile},
+                        out_rect<int> {tile}, priv<int> {2}, priv<int> {1}, priv<int> {width});
+    auto matrix = make_iota_vector<int>(width * width);
+    ivec expected;
+    for (size_t y = 0; y < tile_height; ++y) {
+        for (size_t x = 0; x < tile_width; ++x) {
+            expected.push_back(matrix[(y + 1) * width + x + 2] * 2);
+        }
+    }
+    self->send(w, matrix);
+    self->receive([&](const ivec &result) { check_vector_results("Testing in_rect and out_rect", expected, result); },
+                  others >> wrong_msg);
+}
+
+struct soa_point {
+    float x;
+    int id;
+    float y;
+
+    template<class Inspector>
+    friend typename Inspector::result_type inspect(Inspector &f, soa_point &p) {
+        return f(meta::type_name("soa_point"), p.x, p.id, p.y);
+    }
+};
+
+void test_soa(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing planar struct transfers");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    auto opt = mngr.find_device(0);
+    BOOST_REQUIRE(opt);
+    auto dev = *opt;
+    auto prog = mngr.create_program(kernel_source, "", dev);
+    scoped_actor self {sys};
+    auto wrong_msg = [&](message_view &x) -> result<message> {
+        BOOST_ERROR("unexpected message" << x.content().stringify());
+        return sec::unexpected_message;
+    };
+    // layout
+    auto layout = soa_layout::of<soa_point>();
+    BOOST_REQUIRE_EQUAL(layout.fields().size(), 3u);
+    BOOST_CHECK_EQUAL(layout.fields()[1].offset, offsetof(soa_point, id));
+    BOOST_CHECK_EQUAL(layout.num_bytes(17), 32 * 12u);
+    // tests, with a size that is not a multiple of the plane alignment
+    constexpr size_t n = 37;
+    std::vector<soa_point> points;
+    for (size_t i = 0; i < n; ++i) {
+        points.push_back(soa_point {static_cast<float>(i), static_cast<int>(i) + 100, static_cast<float>(2 * i)});
+    }
+    auto w = mngr.spawn(prog, kn_soa, nd_range {dims {n}}, in_soa<soa_point> {}, out_soa<soa_point> {});
+    self->send(w, points);
+    self->receive(
+        [&](const std::vector<soa_point> &result) {
+            std::vector<float> expected_x;
+            std::vector<int> expected_id;
+            std::vector<float> expected_y;
+            for (auto &p : points) {
+                expected_x.push_back(p.x + 1.0f);
+                expected_id.push_back(p.id * 2);
+                expected_y.push_back(p.y * 3.0f);
+            }
+            std::vector<float> x;
+            std::vector<int> id;
+            std::vector<float> y;
+            for (auto &p : result) {
+                x.push_back(p.x);
+                id.push_back(p.id);
+                y.push_back(p.y);
+            }
+            check_vector_results("Testing in_soa and out_soa (x)", expected_x, x);
+            check_vector_results("Testing in_soa and out_soa (id)", expected_id, id);
+            check_vector_results("Testing in_soa and out_soa (y)", expected_y, y);
+        },
+        others >> wrong_msg);
+}
+
+void test_primitives(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing parallel primitives");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    auto opt = mngr.find_device(0);
+    BOOST_REQUIRE(opt);
+    auto dev = *opt;
+    scoped_actor self {sys};
+    auto wrong_msg = [&](message_view &x) -> result<message> {
+        BOOST_ERROR("unexpected message" << x.content().stringify());
+        return sec::unexpected_message;
+    };
+    using uvec = std::vector<cl_uint>;
+    // spans several groups and ends with a partial tile
+    constexpr size_t n = 10007;
+    auto input = make_iota_vector<int>(n);
+    // reduce
+    auto sum = mngr.spawn_reduce<int>(dev);
+    self->send(sum, input);
+    self->receive([&](int result) { BOOST_CHECK_EQUAL(result, std::accumulate(input.begin(), input.end(), 0)); },
+                  others >> wrong_msg);
+    auto maximum = mngr.spawn_reduce<int>(dev, max_op<int>());
+    self->send(maximum, input);
+    self->receive([&](int result) { BOOST_CHECK_EQUAL(result, static_cast<int>(n - 1)); }, others >> wrong_msg);
+    // scan
+    ivec inclusive(n);
+    std::partial_sum(input.begin(), input.end(), inclusive.begin());
+    ivec exclusive(n);
+    exclusive[0] = 0;
+    std::copy(inclusive.begin(), inclusive.end() - 1, exclusive.begin() + 1);
+    auto inclusive_scan = mngr.spawn_scan<int>(dev);
+    self->send(inclusive_scan, input);
+    self->receive([&](const ivec &result) { check_vector_results("Testing inclusive scan", inclusive, result); },
+                  others >> wrong_msg);
+    auto exclusive_scan = mngr.spawn_scan<int>(dev, sum_op(), true);
+    self->send(exclusive_scan, input);
+    self->receive([&](const ivec &result) { check_vector_results("Testing exclusive scan", exclusive, result); },
+                  others >> wrong_msg);
+    // compact
+    ivec multiples;
+    std::copy_if(input.begin(), input.end(), std::back_inserter(multiples), [](int x) { return x % 3 == 0; });
+    auto compact = mngr.spawn_compact<int>(dev, "x % 3 == 0");
+    self->send(compact, input);
+    self->receive([&](const ivec &result) { check_vector_results("Testing compaction", multiples, result); },
+                  others >> wrong_msg);
+    // sort
+    uvec keys(n);
+    cl_uint state = 42;
+    for (auto &key : keys) {
+        state = state * 1664525u + 1013904223u;
+        key = state;
+    }
+    auto sorted = keys;
+    std::sort(sorted.begin(), sorted.end());
+    auto sorter = mngr.spawn_sort<cl_uint>(dev);
+    self->send(sorter, keys);
+    self->receive([&](const uvec &result) { check_vector_results("Testing radix sort", sorted, result); },
+                  others >> wrong_msg);
+    // segmented variants, including an empty segment
+    uvec offsets {0, 5, 5, 100, static_cast<cl_uint>(n)};
+    ivec segment_sums;
+    ivec segment_scans;
+    for (size_t i = 0; i + 1 < offsets.size(); ++i) {
+        int acc = 0;
+        for (auto j = offsets[i]; j < offsets[i + 1]; ++j) {
+            acc += input[j];
+            segment_scans.push_back(acc);
+        }
+        segment_sums.push_back(acc);
+    }
+    auto segmented_reduce = mngr.spawn_segmented_reduce<int>(dev);
+    self->send(segmented_reduce, input, offsets);
+    self->receive([&](const ivec &result) { check_vector_results("Testing segmented reduce", segment_sums, result); },
+                  others >> wrong_msg);
+    auto segmented_scan = mngr.spawn_segmented_scan<int>(dev);
+    self->send(segmented_scan, input, offsets);
+    self->receive([&](const ivec &result) { check_vector_results("Testing segmented scan", segment_scans, result); },
+                  others >> wrong_msg);
+}
+
+void test_ntt(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing number-theoretic transform");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    auto opt = mngr.find_device(0);
+    BOOST_REQUIRE(opt);
+    auto dev = *opt;
+    scoped_actor self {sys};
+    auto wrong_msg = [&](message_view &x) -> result<message> {
+        BOOST_ERROR("unexpected message" << x.content().stringify());
+        return sec::unexpected_message;
+    };
+    using uvec = std::vector<cl_uint>;
+    using uref = mem_ref<cl_uint>;
+    using u64 = uint64_t;
+    auto mul_mod = [](u64 a, u64 b, u64 p) { return static_cast<u64>(static_cast<unsigned __int128>(a) * b % p); };
+    auto pow_mod = [&](u64 x, u64 e, u64 p) {
+        u64 result = 1;
+        for (; e > 0; e >>= 1, x = mul_mod(x, x, p)) {
+            if (e & 1) {
+                result = mul_mod(result, x, p);
+            }
+        }
+        return result;
+    };
+    auto to_limbs = [](const std::vector<u64> &xs, size_t limbs) {
+        uvec result;
+        for (auto x : xs) {
+            for (size_t i = 0; i < limbs; ++i) {
+                result.push_back(static_cast<cl_uint>(x >> (32 * i)));
+            }
+        }
+        return result;
+    };
+    auto test_field = [&](const char *title, u64 p, u64 root, size_t two_adicity, size_t log_n) {
+        size_t limbs = p >> 32 == 0 ? 1 : 2;
+        ntt_field field {to_limbs({p}, limbs), to_limbs({root}, limbs), two_adicity};
+        size_t n = size_t {1} << log_n;
+        std::vector<u64> xs(n);
+        u64 state = 42;
+        for (auto &x : xs) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            x = state % p;
+        }
+        // naive transform on the host
+        auto w = pow_mod(root, u64 {1} << (two_adicity - log_n), p);
+        std::vector<u64> expected(n);
+        for (size_t k = 0; k < n; ++k) {
+            u64 acc = 0;
+            auto wk = pow_mod(w, k, p);
+            u64 wjk = 1;
+            for (size_t j = 0; j < n; ++j) {
+                acc = static_cast<u64>((static_cast<unsigned __int128>(acc) + mul_mod(xs[j], wjk, p)) % p);
+                wjk = mul_mod(wjk, wk, p);
+            }
+            expected[k] = acc;
+        }
+        auto to_mont = mngr.spawn_ntt_convert(dev, field, true);
+        auto from_mont = mngr.spawn_ntt_convert(dev, field, false);
+        auto forward = from_mont * mngr.spawn_ntt(dev, field, log_n) * to_mont;
+        self->send(forward, to_limbs(xs, limbs));
+        self->receive([&](const uvec &result) { check_vector_results(title, to_limbs(expected, limbs), result); },
+                      others >> wrong_msg);
+        // the inverse transform restores the input
+        auto round_trip = from_mont * mngr.spawn_ntt(dev, field, log_n, true) * mngr.spawn_ntt(dev, field, log_n)
+                          * to_mont;
+        self->send(round_trip, to_limbs(xs, limbs));
+        self->receive([&](const uvec &result) { check_vector_results(title, to_limbs(xs, limbs), result); },
+                      others >> wrong_msg);
+        // the data may stay on the device before and after the transform
+        auto forward_ref = mngr.spawn_ntt_convert<mref>(dev, field, false) * mngr.spawn_ntt<mref>(dev, field, log_n)
+                           * mngr.spawn_ntt_convert<mref>(dev, field, true);
+        self->send(forward_ref, dev->global_argument(to_limbs(xs, limbs)));
+        self->receive(
+            [&](uref &result) {
+                auto data = result.data();
+                BOOST_REQUIRE(data);
+                check_vector_results(title, to_limbs(expected, limbs), *data);
+            },
+            others >> wrong_msg);
+    };
+    test_field("Testing NTT over a 30-bit field", 998244353, 15311432, 23, 12);
+    test_field("Testing NTT over the Goldilocks field", 0xFFFFFFFF00000001ull, 1753635133440165772ull, 32, 11);
+}
+
+void test_msm(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing multi-scalar multiplication");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    auto opt = mngr.find_device(0);
+    BOOST_REQUIRE(opt);
+    auto dev = *opt;
+    scoped_actor self {sys};
+    auto wrong_msg = [&](message_view &x) -> result<message> {
+        BOOST_ERROR("unexpected message" << x.content().stringify());
+        return sec::unexpected_message;
+    };
+    using uvec = std::vector<cl_uint>;
+    using u64 = uint64_t;
+    // y^2 = x^3 + 3 over a 30-bit prime with p = 3 mod 4
+    constexpr u64 p = 1000000007;
+    auto mul = [](u64 a, u64 b) { return a * b % p; };
+    auto pow = [&](u64 x, u64 e) {
+        u64 result = 1;
+        for (; e > 0; e >>= 1, x = mul(x, x)) {
+            if (e & 1) {
+                result = mul(result, x);
+            }
+        }
+        return result;
+    };
+    // affine points with (0, 0) as point at infinity
+    using point = std::pair<u64, u64>;
+    auto add = [&](point a, point b) -> point {
+        if (a == point {0, 0}) {
+            return b;
+        }
+        if (b == point {0, 0}) {
+            return a;
+        }
+        u64 slope;
+        if (a.first == b.first) {
+            if ((a.second + b.second) % p == 0) {
+                return {0, 0};
+            }
+            slope = mul(mul(3, mul(a.first, a.first)), pow(2 * a.second % p, p - 2));
+        } else {
+            slope = mul((b.second + p - a.second) % p, pow((b.first + p - a.first) % p, p - 2));
+        }
+        auto x = (mul(slope, slope) + 2 * p - a.first - b.first) % p;
+        return {x, (mul(slope, (a.first + p - x) % p) + p - a.second) % p};
+    };
+    auto scale = [&](point x, u64 k) {
+        point result {0, 0};
+        for (; k > 0; k >>= 1, x = add(x, x)) {
+            if (k & 1) {
+                result = add(result, x);
+            }
+        }
+        return result;
+    };
+    point generator {0, 0};
+    for (u64 x = 1; generator.first == 0; ++x) {
+        auto rhs = (mul(mul(x, x), x) + 3) % p;
+        auto y = pow(rhs, (p + 1) / 4);
+        if (mul(y, y) == rhs) {
+            generator = {x, y};
+        }
+    }
+    constexpr size_t n = 1000;
+    uvec points;
+    uvec scalars;
+    point expected {0, 0};
+    u64 state = 42;
+    for (size_t i = 0; i < n; ++i) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        // includes the point at infinity and repeated points
+        auto pt = i % 17 == 5 ? point {0, 0} : scale(generator, i % 13 == 3 ? 12345 : state >> 34);
+        auto k = static_cast<cl_uint>(state >> 2) & ((1u << 30) - 1);
+        points.push_back(static_cast<cl_uint>(pt.first));
+        points.push_back(static_cast<cl_uint>(pt.second));
+        scalars.push_back(k);
+        expected = add(expected, scale(pt, k));
+    }
+    uvec expected_result {static_cast<cl_uint>(expected.first), static_cast<cl_uint>(expected.second)};
+    msm_curve curve {{static_cast<cl_uint>(p)}, 30};
+    for (size_t window_bits : {size_t {0}, size_t {4}, size_t {11}}) {
+        auto msm = mngr.spawn_msm(dev, curve, n, window_bits);
+        self->send(msm, points, scalars);
+        self->receive([&](const uvec &result) { check_vector_results("Testing MSM", expected_result, result); },
+                      others >> wrong_msg);
+    }
+    // splitting the points across two devices yields the same result
+    auto split = mngr.spawn_msm(std::vector<device_ptr> {dev, dev}, curve, n);
+    self->request(split, infinite, points, scalars)
+        .receive([&](const uvec &result) { check_vector_results("Testing split MSM", expected_result, result); },
+                 [](error &) { BOOST_ERROR("split MSM failed"); });
+}
+
+void test_field(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing multi-precision field arithmetic");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    auto opt = mngr.find_device(0);
+    BOOST_REQUIRE(opt);
+    auto dev = *opt;
+    scoped_actor self {sys};
+    auto wrong_msg = [&](message_view &x) -> result<message> {
+        BOOST_ERROR("unexpected message" << x.content().stringify());
+        return sec::unexpected_message;
+    };
+    using uvec = std::vector<cl_uint>;
+    // the 254-bit base field of BN254
+    montgomery_field field {
+        {0xd87cfd47, 0x3c208c16, 0x6871ca8d, 0x97816a91, 0x8181585d, 0xb85045b6, 0xe131a029, 0x30644e72}};
+    auto limbs = field.size();
+    constexpr size_t n = 256;
+    uvec a;
+    uvec b;
+    uint64_t state = 42;
+    auto next = [&] {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return static_cast<cl_uint>(state >> 32);
+    };
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t l = 0; l < limbs; ++l) {
+            auto top = l + 1 == limbs;
+            a.push_back(top ? next() % field.modulus().back() : next());
+            b.push_back(top ? next() % field.modulus().back() : next());
+        }
+    }
+    // a in limb-major layout, b element by element
+    const char *kernels = R"__(
+kernel void actor_field_ops(global const uint* restrict a, global const uint* restrict b,
+                            global uint* restrict out) {
+  uint i = get_global_id(0);
+  uint n = get_global_size(0);
+  actor_fe x = actor_fe_load_soa(a, i, n);
+  actor_fe y = actor_fe_load(b, i);
+  actor_fe_store_soa(out, i, n, actor_fe_add(x, y));
+  actor_fe_store_soa(out + n * ACTOR_LIMBS, i, n, actor_fe_sub(x, y));
+  actor_fe_store_soa(out + 2 * n * ACTOR_LIMBS, i, n, actor_fe_mul(x, y));
+  actor_fe_store_soa(out + 3 * n * ACTOR_LIMBS, i, n, actor_fe_reduce(actor_fe_mul_wide(x, y)));
+}
+)__";
+    auto prog = mngr.create_program((field.library() + kernels).c_str(), field.options().c_str(), dev);
+    auto worker = mngr.spawn(prog, "actor_field_ops", nd_range {dims {n}}, opencl::in<cl_uint> {},
+                             opencl::in<cl_uint> {}, opencl::out<cl_uint> {4 * n * limbs});
+    std::vector<uvec> expected(4);
+    for (size_t i = 0; i < n; ++i) {
+        uvec x(a.begin() + i * limbs, a.begin() + (i + 1) * limbs);
+        uvec y(b.begin() + i * limbs, b.begin() + (i + 1) * limbs);
+        auto sum = field.add(x, y);
+        auto difference = field.sub(x, y);
+        auto product = field.mul(x, y);
+        expected[0].insert(expected[0].end(), sum.begin(), sum.end());
+        expected[1].insert(expected[1].end(), difference.begin(), difference.end());
+        expected[2].insert(expected[2].end(), product.begin(), product.end());
+        expected[3].insert(expected[3].end(), product.begin(), product.end());
+    }
+    self->send(worker, field.to_soa(a), b);
+    self->receive(
+        [&](const uvec &result) {
+            const char *titles[] = {"Testing field addition", "Testing field subtraction",
+                                    "Testing Montgomery multiplication", "Testing Montgomery reduction"};
+            for (size_t k = 0; k < 4; ++k) {
+                uvec part(result.begin() + k * n * limbs, result.begin() + (k + 1) * n * limbs);
+                check_vector_results(titles[k], expected[k], field.from_soa(part));
+            }
+        },
+        others >> wrong_msg);
+    // limb-major buffers round trip through the device
+    auto buf = field.soa_argument(*dev, a);
+    auto data = field.soa_data(buf);
+    BOOST_REQUIRE(data);
+    check_vector_results("Testing limb-major buffers", a, *data);
+}
+
+void test_merkle(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing Merkle trees");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    auto opt = mngr.find_device(0);
+    BOOST_REQUIRE(opt);
+    auto dev = *opt;
+    scoped_actor self {sys};
+    auto wrong_msg = [&](message_view &x) -> result<message> {
+        BOOST_ERROR("unexpected message" << x.content().stringify());
+        return sec::unexpected_message;
+    };
+    using uvec = std::vector<cl_uint>;
+    // a cheap hash over two-word nodes that is easy to mirror on the host
+    merkle_hash hash {"void actor_merkle_hash(const uint* left, const uint* right, uint* out) {\n"
+                      "  out[0] = left[0] * 31u + right[0] + 7u;\n"
+                      "  out[1] = left[1] ^ (right[1] << 1) ^ 0x9e3779b9u;\n"
+                      "}\n",
+                      2};
+    constexpr size_t n = 1024;
+    // all levels of the tree, leaves first
+    std::vector<uvec> levels {make_iota_vector<cl_uint>(2 * n)};
+    while (levels.back().size() > 2) {
+        auto &below = levels.back();
+        uvec above;
+        for (size_t i = 0; i < below.size(); i += 4) {
+            above.push_back(below[i] * 31u + below[i + 2] + 7u);
+            above.push_back(below[i + 1] ^ (below[i + 3] << 1) ^ 0x9e3779b9u);
+        }
+        levels.push_back(std::move(above));
+    }
+    auto &root = levels.back();
+    uvec indices {0, 5, 512, n - 1};
+    uvec paths;
+    for (auto index : indices) {
+        for (size_t level = 0; level + 1 < levels.size(); ++level) {
+            auto sibling = (index >> level) ^ 1;
+            paths.push_back(levels[level][2 * sibling]);
+            paths.push_back(levels[level][2 * sibling + 1]);
+        }
+    }
+    auto builder = mngr.spawn_merkle(dev, hash);
+    self->send(builder, levels.front());
+    self->receive([&](const uvec &result) { check_vector_results("Testing Merkle root", root, result); },
+                  others >> wrong_msg);
+    self->send(builder, levels.front(), indices);
+    self->receive(
+        [&](const uvec &result_root, const uvec &result_paths) {
+            check_vector_results("Testing Merkle root with paths", root, result_root);
+            check_vector_results("Testing Merkle paths", paths, result_paths);
+        },
+        others >> wrong_msg);
+    // leaves already on the device
+    self->send(builder, dev->global_argument(levels.front()));
+    self->receive([&](const uvec &result) { check_vector_results("Testing Merkle root from mem_ref", root, result); },
+                  others >> wrong_msg);
+    // SHA-256 over four zero leaves
+    auto sha256 = mngr.spawn_merkle(dev);
+    self->send(sha256, uvec(4 * 8, 0));
+    self->receive(
+        [&](const uvec &result) {
+            uvec expected {0xdb56114e, 0x00fdd4c1, 0xf85c892b, 0xf35ac9a8,
+                           0x9289aaec, 0xb1ebd0a9, 0x6cde606a, 0x748b5d71};
+            check_vector_results("Testing SHA-256 Merkle root", expected, result);
+        },
+        others >> wrong_msg);
+}
+
+void test_image(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing image arguments");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    auto opt = mngr.find_device(0);
+    BOOST_REQUIRE(opt);
+    auto dev = *opt;
+    if (!dev->image_support()) {
+        BOOST_TEST_MESSAGE("Device does not support images, skipping test");
+        return;
+    }
+    using fvec = std::vector<float>;
+    auto prog = mngr.create_program(image_source, "", dev);
+    scoped_actor self {sys};
+    auto wrong_msg = [&](message_view &x) -> result<message> {
+        BOOST_ERROR("unexpected message" << x.content().stringify());
+        return sec::unexpected_message;
+    };
+    // tests
+    constexpr size_t width = 4;
+    constexpr size_t height = 4;
+    auto fmt = make_image_format(CL_R, CL_FLOAT);
+    auto w = mngr.spawn(prog, kn_image, nd_range {dims {width, height}},
+                        in_image<float, 2, val> {dims {width, height}, fmt}, sampler {},
+                        out_image<float, 2> {dims {width, height}, fmt});
+    auto input = make_iota_vector<float>(width * height);
+    fvec expected;
+    for (auto x : input) {
+        expected.push_back(x * 2);
+    }
+    self->send(w, input);
+    self->receive(
+        [&](image_ref<float, 2> &result) {
+            BOOST_CHECK_EQUAL(result.size(), width * height);
+            auto data = result.data();
+            BOOST_REQUIRE(data);
+            BOOST_CHECK(*data == expected);
+            // the lower right quarter of the image
+            auto part = result.read_rect(image_region {{2, 2, 0}}, image_region {{2, 2, 1}});
+            BOOST_REQUIRE(part);
+            BOOST_CHECK(*part == (fvec {expected[10], expected[11], expected[14], expected[15]}));
+        },
+        others >> wrong_msg);
+}
+
+void test_remainder(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing remainder policies");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    auto opt = mngr.find_device(0);
+    BOOST_REQUIRE(opt);
+    auto dev = *opt;
+    auto prog = mngr.create_program(kernel_source, "", dev);
+    scoped_actor self {sys};
+    auto wrong_msg = [&](message_view &x) -> result<message> {
+        BOOST_ERROR("unexpected message" << x.content().stringify());
+        return sec::unexpected_message;
+    };
+    const size_t n = 1000;
+    const size_t group = 64;
+    auto input = make_iota_vector<int>(n);
+    ivec expected(n);
+    for (size_t i = 0; i < n; ++i) {
+        expected[i] = input[i] + static_cast<int>(i);
+    }
+    // tests
+    auto padded = mngr.spawn(prog, kn_checked, nd_range::padded(dims {n}, dims {group}), in<int> {}, out<int> {},
+                             real_size<cl_uint> {});
+    self->send(padded, input);
+    self->receive([&](const ivec &result) { check_vector_results("Testing padded ranges", expected, result); },
+                  others >> wrong_msg);
+    auto split = mngr.spawn(prog, kn_unchecked, nd_range::split(dims {n}, dims {group}), in<int> {}, out<int> {});
+    self->send(split, input);
+    self->receive([&](const ivec &result) { check_vector_results("Testing split ranges", expected, result); },
+                  others >> wrong_msg);
+    // results as references wait for all launches as well
+    auto split_ref =
+        mngr.spawn(prog, kn_unchecked, nd_range::split(dims {n}, dims {group}), in<int> {}, out<int, mref> {});
+    self->send(split_ref, input);
+    self->receive(
+        [&](iref &result) {
+            auto data = result.data();
+            BOOST_REQUIRE(data);
+            check_vector_results("Testing split ranges with references", expected, *data);
+        },
+        others >> wrong_msg);
+}
+
+void test_kernel_info(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing kernel info and occupancy");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    auto opt = mngr.find_device(0);
+    BOOST_REQUIRE(opt);
+    auto dev = *opt;
+    auto prog = mngr.create_program(kernel_source, "", dev);
+    // tests
+    auto names = prog->kernel_names();
+    BOOST_CHECK(std::find(names.begin(), names.end(), kn_matrix) != names.end());
+    BOOST_CHECK(!prog->info("no_such_kernel"));
+    auto info = prog->info(kn_matrix);
+    BOOST_REQUIRE(info);
+    BOOST_CHECK(info->work_group_size > 0);
+    BOOST_CHECK(info->work_group_size <= dev->max_work_group_size());
+    BOOST_CHECK(info->preferred_work_group_size_multiple > 0);
+    BOOST_CHECK_EQUAL(info->compile_work_group_size.size(), 3u);
+    // work-groups of the preferred multiple on every compute unit
+    kernel_info simd {256, {0, 0, 0}, 0, 0, 32};
+    size_t units = dev->max_compute_units();
+    auto full = estimate_occupancy(simd, *dev, nd_range {dims {32 * units}, {}, dims {32}});
+    BOOST_CHECK(full.fits);
+    BOOST_CHECK_EQUAL(full.occupancy, 1.0);
+    BOOST_CHECK(full.issues.empty());
+    // half of each SIMD unit idles
+    auto half = estimate_occupancy(simd, *dev, nd_range {dims {16 * units}, {}, dims {16}});
+    BOOST_CHECK(half.fits);
+    BOOST_CHECK_EQUAL(half.occupancy, 0.5);
+    // larger than the kernel allows
+    auto large = estimate_occupancy(simd, *dev, nd_range {dims {512}, {}, dims {512}});
+    BOOST_CHECK(!large.fits);
+    BOOST_CHECK(!large.issues.empty());
+    // global size not divisible by the local size
+    auto uneven = estimate_occupancy(simd, *dev, nd_range {dims {100}, {}, dims {32}});
+    BOOST_CHECK(!uneven.fits);
+    // the runtime picks the work-group size
+    auto any = estimate_occupancy(*info, *dev, nd_range {dims {matrix_size, matrix_size}});
+    BOOST_CHECK(any.fits);
+    BOOST_CHECK_EQUAL(any.occupancy, 1.0);
+}
+
+void test_metrics(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing runtime metrics");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    auto opt = mngr.find_device(0);
+    BOOST_REQUIRE(opt);
+    auto dev = *opt;
+    scoped_actor self {sys};
+    auto wrong_msg = [&](message_view &x) -> result<message> {
+        BOOST_ERROR("unexpected message" << x.content().stringify());
+        return sec::unexpected_message;
+    };
+    auto before = mngr.metrics();
+    BOOST_REQUIRE(!before.devices.empty());
+    auto prog = mngr.create_program(kernel_source, "", dev);
+    auto conf = opencl::nd_range {dims {matrix_size, matrix_size}};
+    auto worker = mngr.spawn(prog, kn_matrix, conf, in<int> {}, out<int> {});
+    // tests
+    const size_t num_messages = 3;
+    for (size_t i = 0; i < num_messages; ++i) {
+        self->send(worker, make_iota_vector<int>(matrix_size * matrix_size));
+        self->receive([](const ivec &) {}, others >> wrong_msg);
+    }
+    auto after = mngr.metrics();
+    auto &x = before.devices.front();
+    auto &y = after.devices.front();
+    auto num_bytes = num_messages * matrix_size * matrix_size * sizeof(int);
+    BOOST_CHECK_EQUAL(y.program_builds, x.program_builds + 1);
+    BOOST_CHECK_EQUAL(y.commands, x.commands + num_messages);
+    BOOST_CHECK_EQUAL(y.bytes_uploaded, x.bytes_uploaded + num_bytes);
+    BOOST_CHECK_EQUAL(y.bytes_downloaded, x.bytes_downloaded + num_bytes);
+    BOOST_CHECK_EQUAL(y.callbacks, x.callbacks + num_messages);
+    BOOST_CHECK(y.max_callback_latency <= y.callback_latency);
+    auto kernel = std::find_if(y.kernels.begin(), y.kernels.end(),
+                               [&](const kernel_metrics &k) { return k.id == worker.id(); });
+    BOOST_REQUIRE(kernel != y.kernels.end());
+    BOOST_CHECK_EQUAL(kernel->name, kn_matrix);
+    BOOST_CHECK_EQUAL(kernel->messages, num_messages);
+    // the facade did not exist in the first snapshot
+    BOOST_CHECK_EQUAL(after.message_rate(before, worker.id()), 0.0);
+    auto later = mngr.metrics();
+    BOOST_CHECK_EQUAL(later.message_rate(after, worker.id()), 0.0);
+}
+
+void test_elementwise(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing elementwise chains");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    auto opt = mngr.find_device(0);
+    BOOST_REQUIRE(opt);
+    auto dev = *opt;
+    scoped_actor self {sys};
+    auto wrong_msg = [&](message_view &x) -> result<message> {
+        BOOST_ERROR("unexpected message" << x.content().stringify());
+        return sec::unexpected_message;
+    };
+    const size_t n = 1000;
+    std::vector<elementwise_op> ops {scale_op("3"), offset_op("-100"), clamp_op("0", "2000"), {"x + (int) i"}};
+    auto input = make_iota_vector<int>(n);
+    ivec expected(n);
+    for (size_t i = 0; i < n; ++i) {
+        expected[i] = std::min(std::max(input[i] * 3 - 100, 0), 2000) + static_cast<int>(i);
+    }
+    // tests
+    auto before = mngr.metrics();
+    auto chain = mngr.spawn_elementwise<int>(dev, ops);
+    self->send(chain, input);
+    self->receive([&](const ivec &result) { check_vector_results("Testing elementwise values", expected, result); },
+                  others >> wrong_msg);
+    // the same chain reuses the program
+    auto chain_ref = mngr.spawn_elementwise<int, mref>(dev, ops);
+    auto after = mngr.metrics();
+    BOOST_CHECK_EQUAL(after.devices.front().program_builds, before.devices.front().program_builds + 1);
+    auto ref = dev->global_argument(input);
+    self->send(chain_ref, ref);
+    self->receive(
+        [&](iref &result) {
+            auto data = result.data();
+            BOOST_REQUIRE(data);
+            check_vector_results("Testing elementwise references", expected, *data);
+        },
+        others >> wrong_msg);
+}
+
+void test_host_kernels(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing host kernels");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    scoped_actor self {sys};
+    auto wrong_msg = [&](message_view &x) -> result<message> {
+        BOOST_ERROR("unexpected message" << x.content().stringify());
+        return sec::unexpected_message;
+    };
+    mngr.add_host_kernel(kn_unchecked, [](const host_args &args, size_t begin, size_t end) {
+        auto input = args.get<int>(0);
+        auto output = args.get<int>(1);
+        for (size_t i = begin; i < end; ++i) {
+            output[i] = input[i] + static_cast<int>(i);
+        }
+    });
+    mngr.add_host_kernel("host_scale", [](const host_args &args, size_t begin, size_t end) {
+        auto data = args.get<int>(0);
+        auto factor = args.value<int>(1);
+        for (size_t i = begin; i < end; ++i) {
+            data[i] *= factor;
+        }
+    });
+    // spans several chunks
+    const size_t n = 10 * host_min_chunk + 7;
+    auto input = make_iota_vector<int>(n);
+    ivec expected(n);
+    ivec scaled(n);
+    for (size_t i = 0; i < n; ++i) {
+        expected[i] = input[i] + static_cast<int>(i);
+        scaled[i] = input[i] * 3;
+    }
+    // tests
+    auto worker = mngr.spawn_host(kn_unchecked, nd_range {dims {n}}, in<int> {}, out<int> {});
+    self->send(worker, input);
+    self->receive([&](const ivec &result) { check_vector_results("Testing host kernel", expected, result); },
+                  others >> wrong_msg);
+    auto scale = mngr.spawn_host("host_scale", nd_range {dims {n}}, in_out<int> {}, priv<int> {3});
+    self->send(scale, input);
+    self->receive([&](const ivec &result) { check_vector_results("Testing host kernel in place", scaled, result); },
+                  others >> wrong_msg);
+    // picks the OpenCL kernel while a device exists
+    auto any = mngr.spawn_auto(kernel_source, kn_unchecked, nd_range {dims {n}}, in<int> {}, out<int> {});
+    self->send(any, input);
+    self->receive([&](const ivec &result) { check_vector_results("Testing spawn_auto", expected, result); },
+                  others >> wrong_msg);
+}
+
+void test_balanced(spawner &sys) {
+    BOOST_TEST_MESSAGE("Testing co-scheduling across devices");
+    // setup
+    auto &mngr = sys.opencl_manager();
+    auto opt = mngr.find_device(0);
+    BOOST_REQUIRE(opt);
+    auto dev = *opt;
+    scoped_actor self {sys};
+    auto wrong_msg = [&](message_view &x) -> result<message> {
+        BOOST_ERROR("unexpected message" << x.content().stringify());
+        return sec::unexpected_message;
+    };
+    mngr.add_host_kernel("host_triple", [](const host_args &args, size_t begin, size_t end) {
+        auto input = args.get<int>(0);
+        auto output = args.get<int>(1);
+        for (size_t i = begin; i < end; ++i) {
+            output[i] = input[i] * 3;
+        }
+    });
+    auto device_worker = mngr.spawn_elementwise<int>(dev, {scale_op("3")});
+    auto host_worker = mngr.spawn_host(
+        "host_triple", nd_range {dims {1}},
+        [](nd_range &range, message &msg) -> optional<message> {
+            range = nd_range {dims {msg.get_as<ivec>(0).size()}};
+            return msg;
+        },
+        in<int> {}, out<int> {});
+    auto balanced = mngr.spawn_balanced<int>({device_worker, host_worker}, {}, 1000);
+    const size_t n = 100000;
+    auto input = make_iota_vector<int>(n);
+    ivec expected(n);
+    for (size_t i = 0; i < n; ++i) {
+        expected[i] = input[i] * 3;
+    }
+    // tests
+    const size_t num_jobs = 3;
+    for (size_t i = 0; i < num_jobs; ++i) {
+        self->send(balanced, input);
+    }
+    for (size_t i = 0; i < num_jobs; ++i) {
+        self->receive([&](const ivec &result) { check_vector_results("Testing balanced jobs", expected, result); },
+                      others >> wrong_msg);
+    }
+    self->send(balanced, ivec {});
+    self->receive([&](const ivec &result) { BOOST_CHECK(result.empty()); }, others >> wrong_msg);
+}
+
 BOOST_AUTO_TEST_CASE(actor_facade_test) {
     spawner_config cfg;
     cfg.load<opencl::manager>().add_message_type<ivec>("int_vector").add_message_type<matrix_type>("square_matrix");
@@ -1032,5 +2370,24 @@ BOOST_AUTO_TEST_CASE(actor_facade_test) {
     test_inout(system);
     test_priv(system);
     test_local(system);
+    test_cached(system);
+    test_flush_batching(system);
+    test_stream(system);
+    test_stream_stage(system);
+    test_persistent(system);
+    test_image(system);
+    test_rect(system);
+    test_soa(system);
+    test_primitives(system);
+    test_ntt(system);
+    test_msm(system);
+    test_merkle(system);
+    test_field(system);
+    test_metrics(system);
+    test_kernel_info(system);
+    test_remainder(system);
+    test_elementwise(system);
+    test_host_kernels(system);
+    test_balanced(system);
     system.await_all_actors_done();
 }